@@ -19,6 +19,7 @@
 
 #include "config-miners.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <tracker-common.h>
@@ -27,10 +28,16 @@
 
 #ifdef HAVE_POSIX_FADVISE
 #include <fcntl.h>
+#include <sys/stat.h>
 #endif
 
 #define BATCH_SIZE 200
+#define BATCH_MAX_BYTES (4 * 1024 * 1024)
+#define BATCH_TIMEOUT_MS 1000
+#define DEFAULT_MAX_COMMITS 2
 #define THROTTLED_TIMEOUT_MS 10
+#define DEFAULT_MAX_JOBS 8
+#define PREFETCH_THREADS 2
 
 /**
  * SECTION:tracker-decorator
@@ -56,6 +63,12 @@ struct _TrackerDecoratorInfo {
 	gchar *mime_type;
 };
 
+typedef struct {
+	TrackerExtractInfo *info; /* Extracted data, NULL if extraction failed */
+	GFile *file;
+	gchar *hash; /* Extractor hash to store for failed files, or NULL */
+} CommitItem;
+
 struct _TrackerDecorator {
 	TrackerMiner parent_instance;
 
@@ -70,17 +83,22 @@ struct _TrackerDecorator {
 	TrackerSparqlStatement *delete_file;
 
 	TrackerSparqlCursor *cursor; /* Results of remaining_items_query */
-	TrackerDecoratorInfo *item; /* Pre-extracted info for the next element */
-	TrackerDecoratorInfo *next_item; /* Pre-extracted info for the next element */
+	GPtrArray *extracting; /* Array of TrackerDecoratorInfo being extracted */
+	GPtrArray *cancelled; /* Cancelled TrackerDecoratorInfo, still being extracted */
+	GQueue prefetched; /* Upcoming TrackerDecoratorInfo, being read ahead */
+	GHashTable *suspects; /* Files being extracted when a previous run crashed */
 
 	GFile *root;
+	GStrv graphs; /* Graphs handled by this extractor, NULL for all */
+	GStrv graph_iris; /* Expanded IRIs of the graphs handled */
 	GStrv priority_graphs;
 
-	GPtrArray *buffer; /* Array of TrackerExtractInfo */
-	GPtrArray *commit_buffer; /* Array of TrackerExtractInfo */
+	GPtrArray *buffer; /* Array of CommitItem */
+	GQueue pending_commits; /* Arrays of CommitItem, waiting to be committed */
+	gsize buffer_size; /* Estimated size of buffered text content */
+	gint64 buffer_time; /* Time the first item was buffered */
 	GTimer *timer;
 
-	TrackerBatch *batch;
 	TrackerSparqlStatement *remaining_items_query;
 	TrackerSparqlStatement *item_count_query;
 
@@ -88,14 +106,20 @@ struct _TrackerDecorator {
 	GCancellable *task_cancellable;
 
 	gint batch_size;
+	gint max_jobs;
+	gint prefetch_window;
+	guint max_commits;
+	guint n_commits; /* Batches being committed */
 	guint throttle_id;
+	guint commit_timeout_id;
+
+	GThreadPool *prefetch_pool;
 
 	guint throttled  : 1;
-	guint updating   : 1;
 	guint processing : 1;
 	guint querying   : 1;
-	guint extracting : 1;
 	guint needs_query_restart : 1;
+	guint needs_recount : 1;
 };
 
 enum {
@@ -103,6 +127,7 @@ enum {
 	PROP_EXTRACTOR,
 	PROP_PERSISTENCE,
 	PROP_ROOT,
+	PROP_GRAPHS,
 	N_PROPS,
 };
 
@@ -121,10 +146,12 @@ static void decorator_maybe_restart_query (TrackerDecorator *decorator);
 static gboolean decorator_check_commit (TrackerDecorator *decorator);
 static void decorator_get_next_file (TrackerDecorator *decorator);
 
-static void decorator_finish_current_item (TrackerDecorator *decorator);
+static void decorator_finish_item (TrackerDecorator     *decorator,
+                                   TrackerDecoratorInfo *info);
+static guint decorator_get_max_jobs (TrackerDecorator *decorator);
 
-static void tracker_decorator_update (TrackerDecorator   *decorator,
-                                      TrackerExtractInfo *info);
+static void decorator_buffer_item (TrackerDecorator *decorator,
+                                   CommitItem       *item);
 
 static void tracker_decorator_raise_error (TrackerDecorator *decorator,
                                            GFile            *file,
@@ -177,18 +204,17 @@ tracker_decorator_info_complete (TrackerDecoratorInfo *info,
                                  TrackerExtractInfo   *extract_info)
 {
 	TrackerDecorator *decorator = info->decorator;
+	CommitItem *item;
 
 	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Task for %s completed successfully",
 	                                    info->file_id));
 
-	if (!decorator->buffer) {
-		decorator->buffer =
-			g_ptr_array_new_with_free_func ((GDestroyNotify) tracker_extract_info_unref);
-	}
+	item = g_new0 (CommitItem, 1);
+	item->info = tracker_extract_info_ref (extract_info);
+	item->file = g_object_ref (tracker_extract_info_get_file (extract_info));
 
-	g_ptr_array_add (decorator->buffer, tracker_extract_info_ref (extract_info));
-	tracker_decorator_update (decorator, extract_info);
-	decorator_finish_current_item (decorator);
+	decorator_buffer_item (decorator, item);
+	decorator_finish_item (decorator, info);
 }
 
 static void
@@ -205,32 +231,106 @@ tracker_decorator_info_complete_error (TrackerDecoratorInfo *info,
 
 	tracker_decorator_raise_error (decorator, info->file,
 	                               error->message, NULL);
-	decorator_finish_current_item (decorator);
+	tracker_decorator_info_hint_needed (info, FALSE);
+	decorator_finish_item (decorator, info);
+}
+
+typedef struct {
+	gchar *path;
+	goffset head;
+	goffset tail;
+	gboolean needed;
+} PrefetchRequest;
+
+/* Parts of the file read ahead for the mimetypes whose extractor modules
+ * only look at a header, or a trailer (e.g. ID3v1 tags, MP4 moov atoms).
+ * A 0 head and tail means the whole file.
+ */
+static const struct {
+	const gchar *mime_prefix;
+	goffset head;
+	goffset tail;
+} prefetch_ranges[] = {
+	{ "image/svg", 0, 0 },
+	{ "image/", 256 * 1024, 0 },
+	{ "audio/mpeg", 256 * 1024, 128 },
+	{ "audio/", 256 * 1024, 256 * 1024 },
+	{ "video/", 256 * 1024, 256 * 1024 },
+};
+
+static void
+prefetch_request_free (PrefetchRequest *request)
+{
+	g_free (request->path);
+	g_free (request);
 }
 
 static void
-hint_file_needed (GFile    *file,
-                  gboolean  needed)
+prefetch_thread_func (gpointer data,
+                      gpointer user_data)
 {
+	PrefetchRequest *request = data;
 #ifdef HAVE_POSIX_FADVISE
-	g_autofree gchar *path = NULL;
+	struct stat st;
 	int fd;
 
+	fd = tracker_file_open_fd (request->path);
+
+	if (fd >= 0) {
+		if (!request->needed) {
+			posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+		} else if (request->head == 0 && request->tail == 0) {
+			posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+		} else {
+			posix_fadvise (fd, 0, request->head, POSIX_FADV_WILLNEED);
+
+			if (request->tail > 0 &&
+			    fstat (fd, &st) == 0 &&
+			    st.st_size > request->head) {
+				goffset offset;
+
+				offset = MAX (request->head, st.st_size - request->tail);
+				posix_fadvise (fd, offset, st.st_size - offset,
+				               POSIX_FADV_WILLNEED);
+			}
+		}
+
+		close (fd);
+	}
+#endif /* HAVE_POSIX_FADVISE */
+
+	prefetch_request_free (request);
+}
+
+static void
+hint_file_needed (TrackerDecorator *decorator,
+                  GFile            *file,
+                  const gchar      *mime_type,
+                  gboolean          needed)
+{
+#ifdef HAVE_POSIX_FADVISE
+	PrefetchRequest *request;
+	gchar *path;
+	guint i;
+
 	path = g_file_get_path (file);
 	if (!path)
 		return;
 
-	fd = tracker_file_open_fd (path);
+	request = g_new0 (PrefetchRequest, 1);
+	request->path = path;
+	request->needed = needed;
 
-	if (fd >= 0) {
-		if (posix_fadvise (fd, 0, 0,
-		                   needed ?
-		                   POSIX_FADV_WILLNEED :
-		                   POSIX_FADV_DONTNEED) < 0)
-			g_warning ("Could not mark file '%s' as needed: %m", path);
-
-		close (fd);
+	for (i = 0; needed && mime_type && i < G_N_ELEMENTS (prefetch_ranges); i++) {
+		if (g_str_has_prefix (mime_type, prefetch_ranges[i].mime_prefix)) {
+			request->head = prefetch_ranges[i].head;
+			request->tail = prefetch_ranges[i].tail;
+			break;
+		}
 	}
+
+	/* Done in a thread, opening files may block on slow filesystems */
+	g_thread_pool_push (decorator->prefetch_pool, request, NULL);
 #endif /* HAVE_POSIX_FADVISE */
 }
 
@@ -238,7 +338,7 @@ static void
 tracker_decorator_info_hint_needed (TrackerDecoratorInfo *info,
                                     gboolean              needed)
 {
-	hint_file_needed (info->file, needed);
+	hint_file_needed (info->decorator, info->file, info->mime_type, needed);
 }
 
 static void
@@ -276,17 +376,13 @@ decorator_update_state (TrackerDecorator *decorator,
 		g_object_set (decorator, "status", message, NULL);
 }
 
-static TrackerBatch *
-tracker_decorator_get_batch (TrackerDecorator *decorator)
+static void
+commit_item_free (CommitItem *item)
 {
-	if (!decorator->batch) {
-		TrackerSparqlConnection *conn;
-
-		conn = tracker_miner_get_connection (TRACKER_MINER (decorator));
-		decorator->batch = tracker_sparql_connection_create_batch (conn);
-	}
-
-	return decorator->batch;
+	g_clear_pointer (&item->info, tracker_extract_info_unref);
+	g_clear_object (&item->file);
+	g_free (item->hash);
+	g_free (item);
 }
 
 static void
@@ -298,22 +394,41 @@ tracker_decorator_items_available (TrackerDecorator *decorator)
 }
 
 static void
-tracker_decorator_update (TrackerDecorator   *decorator,
-                          TrackerExtractInfo *info)
+commit_item_add_to_batch (TrackerDecorator *decorator,
+                          CommitItem       *item,
+                          TrackerBatch     *batch)
 {
 	TrackerExtractRulesManager *rules_manager =
 		tracker_extract_get_rules_manager (decorator->extractor);
 	TrackerResource *resource;
 	const gchar *graph, *mime_type, *hash, *uri;
-	TrackerBatch *batch;
+	g_autofree gchar *file_uri = NULL;
+
+	if (!item->info) {
+		/* Extraction failed, only flag the file as handled */
+		file_uri = g_file_get_uri (item->file);
+
+		if (item->hash) {
+			tracker_batch_add_statement (batch,
+			                             decorator->update_hash,
+			                             "file", G_TYPE_STRING, file_uri,
+			                             "hash", G_TYPE_STRING, item->hash,
+			                             NULL);
+		} else {
+			tracker_batch_add_statement (batch,
+			                             decorator->delete_file,
+			                             "file", G_TYPE_STRING, file_uri,
+			                             NULL);
+		}
 
-	batch = tracker_decorator_get_batch (decorator);
+		return;
+	}
 
-	mime_type = tracker_extract_info_get_mimetype (info);
+	mime_type = tracker_extract_info_get_mimetype (item->info);
 	hash = tracker_extract_rules_manager_get_hash (rules_manager, mime_type);
-	graph = tracker_extract_info_get_graph (info);
-	resource = tracker_extract_info_get_resource (info);
-	uri = tracker_extract_info_get_file_id (info);
+	graph = tracker_extract_info_get_graph (item->info);
+	resource = tracker_extract_info_get_resource (item->info);
+	uri = tracker_extract_info_get_file_id (item->info);
 
 	tracker_batch_add_statement (batch,
 	                             decorator->update_hash,
@@ -333,12 +448,14 @@ tracker_decorator_raise_error (TrackerDecorator *decorator,
 {
 	g_autofree gchar *uri = NULL;
 	g_autoptr (GFileInfo) info = NULL;
-	TrackerBatch *batch;
-	const gchar *hash = NULL;
+	CommitItem *item;
 
 	uri = g_file_get_uri (file);
 	g_debug ("Extraction on file '%s' failed in previous execution, ignoring", uri);
 
+	item = g_new0 (CommitItem, 1);
+	item->file = g_object_ref (file);
+
 	info = g_file_query_info (file,
 	                          G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
 	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
@@ -351,83 +468,87 @@ tracker_decorator_raise_error (TrackerDecorator *decorator,
 
 		mimetype = g_file_info_get_attribute_string (info,
 		                                             G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
-		hash = tracker_extract_rules_manager_get_hash (rules_manager,
-		                                               mimetype);
+		item->hash = g_strdup (tracker_extract_rules_manager_get_hash (rules_manager,
+		                                                               mimetype));
 	}
 
-	batch = tracker_decorator_get_batch (decorator);
-
-	if (hash) {
-		tracker_batch_add_statement (batch,
-		                             decorator->update_hash,
-		                             "file", G_TYPE_STRING, uri,
-		                             "hash", G_TYPE_STRING, hash,
-		                             NULL);
-	} else {
-		tracker_batch_add_statement (batch,
-		                             decorator->delete_file,
-		                             "file", G_TYPE_STRING, uri,
-		                             NULL);
-	}
+	decorator_buffer_item (decorator, item);
 
 	g_signal_emit (decorator, signals[RAISE_ERROR], 0,
 	               file, message, extra_info);
 }
 
+typedef struct {
+	TrackerDecorator *decorator;
+	GPtrArray *items; /* Array of CommitItem */
+} CommitBatch;
+
+static void decorator_commit_items (TrackerDecorator *decorator,
+                                    GPtrArray        *items);
+
 static void
-retry_synchronously (TrackerDecorator *decorator,
-                     GPtrArray        *commit_buffer)
+commit_batch_free (CommitBatch *commit)
 {
-	guint i;
-
-	for (i = 0; i < commit_buffer->len; i++) {
-		g_autoptr (TrackerBatch) batch = NULL;
-		TrackerExtractInfo *info;
-		g_autoptr (GError) error = NULL;
+	g_ptr_array_unref (commit->items);
+	g_free (commit);
+}
 
-		info = g_ptr_array_index (commit_buffer, i);
+static void
+handle_failed_item (TrackerDecorator *decorator,
+                    CommitItem       *item,
+                    const GError     *error)
+{
+	g_autofree gchar *sparql = NULL;
+	TrackerResource *resource;
+	const gchar *graph;
 
-		tracker_decorator_update (decorator, info);
+	if (!item->info) {
+		g_autofree char *uri = NULL;
 
-		batch = g_steal_pointer (&decorator->batch);
+		uri = g_file_get_uri (item->file);
+		g_warning ("Could not handle error on '%s': %s",
+		           uri, error->message);
+		return;
+	}
 
-		if (batch)
-			tracker_batch_execute (batch, NULL, &error);
+	/* This is a SPARQL/ontology error, set the SPARQL query
+	 * as the the extra information.
+	 */
+	graph = tracker_extract_info_get_graph (item->info);
+	resource = tracker_extract_info_get_resource (item->info);
 
-		if (error) {
-			g_autofree gchar *sparql = NULL;
-			g_autoptr (GError) inner_error = NULL;
-			TrackerResource *resource;
-			const gchar *graph;
-			GFile *file;
+	if (resource) {
+		sparql = tracker_resource_print_sparql_update (resource,
+		                                               NULL,
+		                                               graph);
+	}
 
-			/* This is a SPARQL/ontology error, set the SPARQL query
-			 * as the the extra information.
-			 */
-			file = tracker_extract_info_get_file (info);
-			graph = tracker_extract_info_get_graph (info);
-			resource = tracker_extract_info_get_resource (info);
+	tracker_decorator_raise_error (decorator, item->file,
+	                               error->message, sparql);
+}
 
-			sparql = tracker_resource_print_sparql_update (resource,
-			                                               NULL,
-			                                               graph);
+static void
+decorator_bisect_items (TrackerDecorator *decorator,
+                        GPtrArray        *items)
+{
+	g_autoptr (GPtrArray) first = NULL, second = NULL;
+	guint i, half;
 
-			tracker_decorator_raise_error (decorator, file,
-			                               error->message, sparql);
+	half = items->len / 2;
+	first = g_ptr_array_new_full (half, (GDestroyNotify) commit_item_free);
+	second = g_ptr_array_new_full (items->len - half, (GDestroyNotify) commit_item_free);
 
-			batch = g_steal_pointer (&decorator->batch);
-			if (batch)
-				tracker_batch_execute (batch, NULL, &inner_error);
+	for (i = 0; i < items->len; i++) {
+		g_ptr_array_add (i < half ? first : second,
+		                 g_ptr_array_index (items, i));
+	}
 
-			if (inner_error) {
-				g_autofree char *uri = NULL;
+	/* Items were moved over */
+	g_ptr_array_set_free_func (items, NULL);
 
-				uri = g_file_get_uri (file);
-				g_warning ("Could not handle error on '%s': %s",
-				           uri, inner_error->message);
-			}
-		}
-	}
+	/* Committed ahead of buffered items, as commits in flight allow */
+	g_queue_push_head (&decorator->pending_commits, g_steal_pointer (&second));
+	g_queue_push_head (&decorator->pending_commits, g_steal_pointer (&first));
 }
 
 static void
@@ -436,69 +557,189 @@ decorator_commit_cb (GObject      *object,
                      gpointer      user_data)
 {
 	TrackerBatch *batch = TRACKER_BATCH (object);
-	TrackerDecorator *decorator = user_data;
+	CommitBatch *commit = user_data;
+	TrackerDecorator *decorator = commit->decorator;
 	g_autoptr (GError) error = NULL;
+	guint i;
 
 	tracker_batch_execute_finish (batch, result, &error);
 
-	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		commit_batch_free (commit);
 		return;
+	}
 
-	decorator->updating = FALSE;
+	decorator->n_commits--;
 
-	if (error && decorator->commit_buffer &&
+	if (error &&
 	    !g_error_matches (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_NO_SPACE) &&
 	    !g_error_matches (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_CORRUPT)) {
-		g_debug ("SPARQL error detected in batch, retrying one by one");
-		retry_synchronously (decorator, decorator->commit_buffer);
+		/* Find the failing items in O(log n) round trips */
+		if (commit->items->len > 1) {
+			g_debug ("SPARQL error detected in batch of %u items, bisecting",
+			         commit->items->len);
+			decorator_bisect_items (decorator, commit->items);
+		} else if (commit->items->len == 1) {
+			handle_failed_item (decorator,
+			                    g_ptr_array_index (commit->items, 0),
+			                    error);
+		}
+	} else if (!error) {
+		/* Data is stored, these pages are no longer needed */
+		for (i = 0; i < commit->items->len; i++) {
+			CommitItem *item = g_ptr_array_index (commit->items, i);
+
+			if (item->info)
+				hint_file_needed (decorator, item->file, NULL, FALSE);
+		}
 	}
 
-	g_clear_pointer (&decorator->commit_buffer, g_ptr_array_unref);
+	commit_batch_free (commit);
 
-	if (!decorator_check_commit (decorator) && decorator->needs_query_restart) {
+	if (!decorator_check_commit (decorator) &&
+	    decorator->n_commits == 0 &&
+	    decorator->needs_query_restart)
 		decorator_maybe_restart_query (decorator);
-		return;
-	}
+}
+
+static void
+decorator_commit_items (TrackerDecorator *decorator,
+                        GPtrArray        *items)
+{
+	g_autoptr (TrackerBatch) batch = NULL;
+	TrackerSparqlConnection *conn;
+	CommitBatch *commit;
+	guint i;
+
+	conn = tracker_miner_get_connection (TRACKER_MINER (decorator));
+	batch = tracker_sparql_connection_create_batch (conn);
+
+	for (i = 0; i < items->len; i++)
+		commit_item_add_to_batch (decorator, g_ptr_array_index (items, i), batch);
+
+	commit = g_new0 (CommitBatch, 1);
+	commit->decorator = decorator;
+	commit->items = g_ptr_array_ref (items);
+
+	decorator->n_commits++;
+	tracker_batch_execute_async (batch,
+	                             decorator->cancellable,
+	                             decorator_commit_cb,
+	                             commit);
 }
 
 static gboolean
 decorator_commit_info (TrackerDecorator *decorator)
 {
-	g_autoptr (TrackerBatch) batch = NULL;
+	g_autoptr (GPtrArray) items = NULL;
 
-	if (!decorator->batch)
-		return FALSE;
-	if (decorator->commit_buffer)
+	g_clear_handle_id (&decorator->commit_timeout_id, g_source_remove);
+
+	if (!decorator->buffer || decorator->buffer->len == 0)
 		return FALSE;
 
-	/* Move sparql buffer to commit buffer */
-	decorator->commit_buffer = g_steal_pointer (&decorator->buffer);
-	decorator->updating = TRUE;
+	items = g_steal_pointer (&decorator->buffer);
+	decorator->buffer_size = 0;
+
+	decorator_commit_items (decorator, items);
+	decorator_update_state (decorator, NULL, TRUE);
+
+	return TRUE;
+}
+
+static gboolean
+decorator_commit_pending (TrackerDecorator *decorator)
+{
+	gboolean committed = FALSE;
 
-	batch = g_steal_pointer (&decorator->batch);
+	while (decorator->n_commits < decorator->max_commits &&
+	       !g_queue_is_empty (&decorator->pending_commits)) {
+		g_autoptr (GPtrArray) items = NULL;
 
-	if (batch) {
-		tracker_batch_execute_async (batch,
-		                             decorator->cancellable,
-		                             decorator_commit_cb,
-		                             decorator);
-		decorator_update_state (decorator, NULL, TRUE);
+		items = g_queue_pop_head (&decorator->pending_commits);
+		decorator_commit_items (decorator, items);
+		committed = TRUE;
 	}
 
-	return TRUE;
+	return committed;
+}
+
+static gboolean
+commit_timeout_cb (gpointer user_data)
+{
+	TrackerDecorator *decorator = user_data;
+
+	decorator->commit_timeout_id = 0;
+	decorator_check_commit (decorator);
+
+	return G_SOURCE_REMOVE;
 }
 
 static gboolean
 decorator_check_commit (TrackerDecorator *decorator)
 {
-	if (!decorator->buffer ||
-	    (decorator->n_remaining_items > 0 &&
-	     decorator->buffer->len < BATCH_SIZE))
+	gboolean committed;
+
+	if (tracker_miner_is_paused (TRACKER_MINER (decorator)))
 		return FALSE;
 
+	/* Bisected batches go first */
+	committed = decorator_commit_pending (decorator);
+
+	if (!g_queue_is_empty (&decorator->pending_commits))
+		return committed;
+
+	if (!decorator->buffer || decorator->buffer->len == 0)
+		return committed;
+
+	/* Keep buffering while enough batches are in flight, finished
+	 * commits will pick the buffer up.
+	 */
+	if (decorator->n_commits >= decorator->max_commits)
+		return committed;
+
+	if (decorator->n_remaining_items > 0 &&
+	    decorator->buffer->len < BATCH_SIZE &&
+	    decorator->buffer_size < BATCH_MAX_BYTES &&
+	    g_get_monotonic_time () - decorator->buffer_time < BATCH_TIMEOUT_MS * 1000) {
+		if (!decorator->commit_timeout_id) {
+			decorator->commit_timeout_id =
+				g_timeout_add (BATCH_TIMEOUT_MS, commit_timeout_cb, decorator);
+		}
+
+		return committed;
+	}
+
 	return decorator_commit_info (decorator);
 }
 
+static void
+decorator_buffer_item (TrackerDecorator *decorator,
+                       CommitItem       *item)
+{
+	if (!decorator->buffer) {
+		decorator->buffer =
+			g_ptr_array_new_with_free_func ((GDestroyNotify) commit_item_free);
+		decorator->buffer_time = g_get_monotonic_time ();
+	}
+
+	g_ptr_array_add (decorator->buffer, item);
+
+	/* Text content makes up for most of the size of extracted data */
+	if (item->info) {
+		TrackerResource *resource;
+		const gchar *text;
+
+		resource = tracker_extract_info_get_resource (item->info);
+		text = resource ?
+			tracker_resource_get_first_string (resource, "nie:plainTextContent") :
+			NULL;
+
+		if (text)
+			decorator->buffer_size += strlen (text);
+	}
+}
+
 static void
 decorator_start (TrackerDecorator *decorator)
 {
@@ -513,6 +754,9 @@ decorator_start (TrackerDecorator *decorator)
 static void
 decorator_finish (TrackerDecorator *decorator)
 {
+	/* Suspects not extracted by now are no longer pending */
+	g_hash_table_remove_all (decorator->suspects);
+
 	decorator->processing = FALSE;
 	decorator->n_remaining_items = decorator->n_processed_items = 0;
 	g_signal_emit (decorator, signals[FINISHED], 0);
@@ -521,17 +765,28 @@ decorator_finish (TrackerDecorator *decorator)
 }
 
 static void
-decorator_clear_cache (TrackerDecorator *decorator)
+decorator_close_cursor (TrackerDecorator *decorator)
 {
-	decorator->n_remaining_items = 0;
-	g_clear_pointer (&decorator->next_item, tracker_decorator_info_free);
-
 	if (decorator->cursor) {
 		tracker_sparql_cursor_close (decorator->cursor);
 		g_clear_object (&decorator->cursor);
 	}
 }
 
+static void
+decorator_clear_cache (TrackerDecorator *decorator)
+{
+	TrackerDecoratorInfo *info;
+
+	/* Pages read ahead for these are no longer needed */
+	while ((info = g_queue_pop_head (&decorator->prefetched)) != NULL) {
+		tracker_decorator_info_hint_needed (info, FALSE);
+		tracker_decorator_info_free (info);
+	}
+
+	decorator_close_cursor (decorator);
+}
+
 static void
 decorator_rebuild_cache (TrackerDecorator *decorator)
 {
@@ -540,10 +795,10 @@ decorator_rebuild_cache (TrackerDecorator *decorator)
 }
 
 static void
-decorator_finish_current_item (TrackerDecorator *decorator)
+decorator_finish_item (TrackerDecorator     *decorator,
+                       TrackerDecoratorInfo *info)
 {
-	tracker_decorator_info_hint_needed (decorator->item, FALSE);
-	g_clear_pointer (&decorator->item, tracker_decorator_info_free);
+	g_hash_table_remove (decorator->suspects, info->file);
 
 	if (decorator->n_remaining_items > 0)
 		decorator->n_remaining_items--;
@@ -551,9 +806,10 @@ decorator_finish_current_item (TrackerDecorator *decorator)
 
 	decorator_check_commit (decorator);
 
-	if (!decorator->next_item) {
+	if (g_queue_is_empty (&decorator->prefetched) &&
+	    decorator->extracting->len == 0) {
 		decorator_finish (decorator);
-		if (!decorator->updating)
+		if (decorator->n_commits == 0)
 			decorator_rebuild_cache (decorator);
 	}
 }
@@ -577,18 +833,55 @@ load_statement (TrackerDecorator *decorator,
 	                                                                NULL);
 }
 
+static guint
+decorator_get_prefetch_window (TrackerDecorator *decorator)
+{
+	if (decorator->prefetch_window > 0)
+		return decorator->prefetch_window;
+
+	return decorator_get_max_jobs (decorator) * 2;
+}
+
 static void
-decorator_cache_next_item (TrackerDecorator *decorator)
+decorator_prefetch_items (TrackerDecorator *decorator)
 {
-	if (!decorator->cursor)
-		return;
+	TrackerDecoratorInfo *info;
+	guint window;
+
+	window = decorator_get_prefetch_window (decorator);
+
+	/* Keep the upcoming items in the page cache, so extraction does
+	 * not wait on their first read.
+	 */
+	while (decorator->cursor &&
+	       g_queue_get_length (&decorator->prefetched) < window) {
+		if (!tracker_sparql_cursor_next (decorator->cursor, NULL, NULL)) {
+			/* Only what was read from the cursor is left */
+			decorator->n_remaining_items =
+				g_queue_get_length (&decorator->prefetched) +
+				decorator->extracting->len;
+
+			if (g_queue_is_empty (&decorator->prefetched))
+				decorator_clear_cache (decorator);
+			else
+				decorator_close_cursor (decorator);
+			break;
+		}
 
-	if (tracker_sparql_cursor_next (decorator->cursor, NULL, NULL)) {
-		decorator->next_item = tracker_decorator_info_new (decorator,
-		                                                   decorator->cursor);
-		tracker_decorator_info_hint_needed (decorator->next_item, TRUE);
-	} else {
-		decorator_clear_cache (decorator);
+		info = tracker_decorator_info_new (decorator, decorator->cursor);
+		tracker_decorator_info_hint_needed (info, TRUE);
+		g_queue_push_tail (&decorator->prefetched, info);
+
+		/* The remaining item count fell behind, correct it for now
+		 * and do a full count next time.
+		 */
+		if ((gsize) decorator->n_remaining_items <
+		    g_queue_get_length (&decorator->prefetched) + decorator->extracting->len) {
+			decorator->n_remaining_items =
+				g_queue_get_length (&decorator->prefetched) +
+				decorator->extracting->len;
+			decorator->needs_recount = TRUE;
+		}
 	}
 }
 
@@ -618,36 +911,54 @@ query_items_cb (GObject      *object,
 	}
 
 	g_set_object (&decorator->cursor, cursor);
-	decorator_cache_next_item (decorator);
+	decorator_prefetch_items (decorator);
 
-	if (decorator->next_item && !decorator->processing) {
+	if (!g_queue_is_empty (&decorator->prefetched) && !decorator->processing) {
 		decorator_start (decorator);
-	} else if (!decorator->next_item) {
+	} else if (g_queue_is_empty (&decorator->prefetched)) {
 		decorator_finish (decorator);
 	} else if (!had_cursor) {
 		tracker_decorator_items_available (decorator);
 	}
 }
 
+static const gchar *graph_params[][4] = {
+	{ "tracker:Audio", "audioHigh", "audioLow", "audio" },
+	{ "tracker:Pictures", "picturesHigh", "picturesLow", "pictures" },
+	{ "tracker:Video", "videoHigh", "videoLow", "video" },
+	{ "tracker:Software", "softwareHigh", "softwareLow", "software" },
+	{ "tracker:Documents", "documentsHigh", "documentsLow", "documents" },
+};
+
+static gboolean
+decorator_handles_graph (TrackerDecorator *decorator,
+                         const gchar      *graph)
+{
+	return !decorator->graphs ||
+		g_strv_contains ((const gchar * const *) decorator->graphs, graph);
+}
+
 static void
 bind_graph_limits (TrackerDecorator *decorator,
                    gboolean          priority)
 {
-	const gchar *graphs[][3] = {
-		{ "tracker:Audio", "audioHigh", "audioLow" },
-		{ "tracker:Pictures", "picturesHigh", "picturesLow" },
-		{ "tracker:Video", "videoHigh", "videoLow" },
-		{ "tracker:Software", "softwareHigh", "softwareLow" },
-		{ "tracker:Documents", "documentsHigh", "documentsLow" },
-	};
 	guint i;
 
-	for (i = 0; i < G_N_ELEMENTS (graphs); i++) {
-		const gchar *graph = graphs[i][0];
-		const gchar *high_limit = graphs[i][1];
-		const gchar *low_limit = graphs[i][2];
+	for (i = 0; i < G_N_ELEMENTS (graph_params); i++) {
+		const gchar *graph = graph_params[i][0];
+		const gchar *high_limit = graph_params[i][1];
+		const gchar *low_limit = graph_params[i][2];
 		gboolean is_priority;
 
+		if (!decorator_handles_graph (decorator, graph)) {
+			/* Handled by another extractor process */
+			tracker_sparql_statement_bind_int (decorator->remaining_items_query,
+			                                   high_limit, 0);
+			tracker_sparql_statement_bind_int (decorator->remaining_items_query,
+			                                   low_limit, 0);
+			continue;
+		}
+
 		is_priority = decorator->priority_graphs &&
 			g_strv_contains ((const gchar * const *) decorator->priority_graphs, graph);
 
@@ -696,6 +1007,7 @@ count_remaining_items_cb (GObject      *object,
 
 	if (error) {
 		g_warning ("Could not get remaining item count: %s", error->message);
+		decorator->needs_recount = TRUE;
 		return;
 	}
 
@@ -719,20 +1031,41 @@ static void
 decorator_maybe_restart_query (TrackerDecorator *decorator)
 {
 	if (decorator->querying ||
-	    decorator->updating ||
-	    decorator->next_item) {
+	    decorator->n_commits > 0 ||
+	    !g_queue_is_empty (&decorator->prefetched) ||
+	    decorator->extracting->len > 0) {
 		decorator->needs_query_restart = TRUE;
 		return;
 	}
 
 	decorator->needs_query_restart = FALSE;
+
+	/* The remaining item count is otherwise kept up to date from
+	 * notifier events, only count on startup or if it drifted.
+	 */
+	if (!decorator->needs_recount) {
+		decorator_query_items (decorator);
+		return;
+	}
+
+	decorator->needs_recount = FALSE;
 	decorator->querying = TRUE;
 
 	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Counting items which still need processing"));
 
-	if (!decorator->item_count_query)
+	if (!decorator->item_count_query) {
+		guint i;
+
 		decorator->item_count_query = load_statement (decorator, "get-item-count.rq");
 
+		for (i = 0; i < G_N_ELEMENTS (graph_params); i++) {
+			tracker_sparql_statement_bind_boolean (decorator->item_count_query,
+			                                       graph_params[i][3],
+			                                       decorator_handles_graph (decorator,
+			                                                                graph_params[i][0]));
+		}
+	}
+
 	tracker_sparql_statement_execute_async (decorator->item_count_query,
 	                                        decorator->cancellable,
 	                                        count_remaining_items_cb,
@@ -789,6 +1122,9 @@ throttle_next_item_cb (gpointer user_data)
 static void
 throttle_next_item (TrackerDecorator *decorator)
 {
+	if (decorator->throttle_id)
+		return;
+
 	if (decorator->throttled) {
 		decorator->throttle_id =
 			g_timeout_add (THROTTLED_TIMEOUT_MS,
@@ -802,28 +1138,45 @@ throttle_next_item (TrackerDecorator *decorator)
 }
 
 static void
-get_metadata_cb (TrackerExtract   *extract,
-                 GAsyncResult     *result,
-                 TrackerDecorator *decorator)
+get_metadata_cb (TrackerExtract       *extract,
+                 GAsyncResult         *result,
+                 TrackerDecoratorInfo *item)
 {
+	TrackerDecorator *decorator;
 	g_autoptr (TrackerExtractInfo) info = NULL;
-	GError *error = NULL;
+	g_autoptr (GError) error = NULL;
 
 	info = tracker_extract_file_finish (extract, result, &error);
 
-	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+	/* The decorator forgot about cancelled items already, but
+	 * they are kept in the persistence file until done.
+	 */
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		decorator = item->decorator;
+
+		if (decorator &&
+		    g_ptr_array_remove_fast (decorator->cancelled, item)) {
+			tracker_extract_persistence_remove_file (decorator->persistence, item->file);
+			/* A thread got free */
+			throttle_next_item (decorator);
+		}
+
+		tracker_decorator_info_free (item);
 		return;
+	}
 
-	tracker_extract_persistence_set_file (decorator->persistence, NULL);
+	decorator = item->decorator;
+	tracker_extract_persistence_remove_file (decorator->persistence, item->file);
+	g_ptr_array_remove_fast (decorator->extracting, item);
 
 	if (error) {
-		tracker_decorator_info_complete_error (decorator->item, error);
+		tracker_decorator_info_complete_error (item, error);
 	} else {
 		ensure_data (decorator, info);
-		tracker_decorator_info_complete (decorator->item, info);
+		tracker_decorator_info_complete (item, info);
 	}
 
-	decorator->extracting = FALSE;
+	tracker_decorator_info_free (item);
 
 	throttle_next_item (decorator);
 }
@@ -831,65 +1184,87 @@ get_metadata_cb (TrackerExtract   *extract,
 static TrackerDecoratorInfo *
 tracker_decorator_next (TrackerDecorator  *decorator)
 {
+	TrackerDecoratorInfo *item;
+
 	g_return_val_if_fail (TRACKER_IS_DECORATOR (decorator), NULL);
 
-	decorator->item = g_steal_pointer (&decorator->next_item);
+	item = g_queue_pop_head (&decorator->prefetched);
 
-	if (decorator->item) {
+	if (item) {
 		TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Next item %s",
-		                                    decorator->item->file_id));
+		                                    item->file_id));
 	}
 
-	/* Preempt next item */
-	decorator_cache_next_item (decorator);
+	/* Preempt next items */
+	decorator_prefetch_items (decorator);
 
-	return decorator->item;
+	return item;
+}
+
+static guint
+decorator_get_max_jobs (TrackerDecorator *decorator)
+{
+	/* Go easy on battery. Also extract one file at a time while
+	 * the file that crashed a previous run is not known, so it is
+	 * the only one in flight if it crashes again.
+	 */
+	if (decorator->throttled ||
+	    g_hash_table_size (decorator->suspects) > 0)
+		return 1;
+
+	if (decorator->max_jobs > 0)
+		return decorator->max_jobs;
+
+	return CLAMP (g_get_num_processors () / 2, 1, DEFAULT_MAX_JOBS);
 }
 
 static void
 decorator_get_next_file (TrackerDecorator *decorator)
 {
 	TrackerDecoratorInfo *info;
-	g_autoptr (GError) error = NULL;
 
 	if (!tracker_miner_is_started (TRACKER_MINER (decorator)) ||
 	    tracker_miner_is_paused (TRACKER_MINER (decorator)))
 		return;
 
-	if (decorator->extracting)
-		return;
+	/* Cancelled extractions still take up a thread */
+	while (decorator->extracting->len + decorator->cancelled->len <
+	       decorator_get_max_jobs (decorator)) {
+		info = tracker_decorator_next (decorator);
 
-	info = tracker_decorator_next (decorator);
+		if (!info)
+			return;
 
-	if (!info)
-		return;
+		if (!g_file_has_uri_scheme (info->file, "file")) {
+			g_autoptr (GError) error = NULL;
 
-	if (!g_file_has_uri_scheme (info->file, "file")) {
-		error = g_error_new (TRACKER_DECORATOR_ERROR,
-		                     TRACKER_DECORATOR_ERROR_INVALID_FILE,
-		                     "URI '%s' is not native",
-		                     info->file_id);
-		tracker_decorator_info_complete_error (info, error);
-		decorator_get_next_file (decorator);
-		return;
-	}
+			error = g_error_new (TRACKER_DECORATOR_ERROR,
+			                     TRACKER_DECORATOR_ERROR_INVALID_FILE,
+			                     "URI '%s' is not native",
+			                     info->file_id);
+			tracker_decorator_info_complete_error (info, error);
+			tracker_decorator_info_free (info);
+			continue;
+		}
 
-	decorator->extracting = TRUE;
+		g_ptr_array_add (decorator->extracting, info);
 
-	TRACKER_NOTE (DECORATOR,
-	              g_message ("[Decorator] Extracting metadata for '%s'",
-	                         info->file_id));
-
-	tracker_extract_persistence_set_file (decorator->persistence, info->file);
-
-	tracker_extract_file (decorator->extractor,
-	                      info->file,
-	                      info->file_id,
-	                      info->content_id,
-	                      info->mime_type,
-	                      decorator->cancellable,
-	                      (GAsyncReadyCallback) get_metadata_cb,
-	                      decorator);
+		TRACKER_NOTE (DECORATOR,
+		              g_message ("[Decorator] Extracting metadata for '%s'",
+		                         info->file_id));
+
+		tracker_extract_persistence_add_file (decorator->persistence, info->file);
+
+		/* Item is owned by the callback */
+		tracker_extract_file (decorator->extractor,
+		                      info->file,
+		                      info->file_id,
+		                      info->content_id,
+		                      info->mime_type,
+		                      decorator->cancellable,
+		                      (GAsyncReadyCallback) get_metadata_cb,
+		                      info);
+	}
 }
 
 static void
@@ -910,6 +1285,9 @@ tracker_decorator_set_property (GObject      *object,
 	case PROP_ROOT:
 		decorator->root = g_value_dup_object (value);
 		break;
+	case PROP_GRAPHS:
+		decorator->graphs = g_value_dup_boxed (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 	}
@@ -922,16 +1300,29 @@ notifier_events_cb (TrackerDecorator *decorator,
                     GPtrArray        *events,
                     TrackerNotifier  *notifier)
 {
-	gboolean added = FALSE, deleted = FALSE;
+	gboolean added = FALSE, deleted = FALSE, counted;
 	gint i;
 
+	counted = graph && decorator->graph_iris &&
+		g_strv_contains ((const gchar * const *) decorator->graph_iris, graph);
+
 	for (i = 0; i < events->len; i++) {
 		TrackerNotifierEvent *event;
+		const gchar *urn;
 
 		event = g_ptr_array_index (events, i);
 
 		switch (tracker_notifier_event_get_event_type (event)) {
 		case TRACKER_NOTIFIER_EVENT_CREATE:
+			/* New files in content graphs are pending extraction,
+			 * other resources are created by the extractor itself.
+			 */
+			urn = tracker_notifier_event_get_urn (event);
+			if (counted && urn && g_str_has_prefix (urn, "file:"))
+				decorator->n_remaining_items++;
+
+			added = TRUE;
+			break;
 		case TRACKER_NOTIFIER_EVENT_UPDATE:
 			added = TRUE;
 			break;
@@ -947,6 +1338,34 @@ notifier_events_cb (TrackerDecorator *decorator,
 		decorator_maybe_restart_query (decorator);
 }
 
+static GStrv
+expand_graph_iris (TrackerDecorator        *decorator,
+                   TrackerSparqlConnection *conn)
+{
+	TrackerNamespaceManager *namespaces;
+	g_autoptr (GStrvBuilder) builder = NULL;
+	guint i;
+
+	namespaces = tracker_sparql_connection_get_namespace_manager (conn);
+	if (!namespaces)
+		return NULL;
+
+	builder = g_strv_builder_new ();
+
+	for (i = 0; i < G_N_ELEMENTS (graph_params); i++) {
+		g_autofree gchar *iri = NULL;
+
+		if (!decorator_handles_graph (decorator, graph_params[i][0]))
+			continue;
+
+		iri = tracker_namespace_manager_expand_uri (namespaces,
+		                                            graph_params[i][0]);
+		g_strv_builder_add (builder, iri);
+	}
+
+	return g_strv_builder_end (builder);
+}
+
 static void
 tracker_decorator_constructed (GObject *object)
 {
@@ -957,6 +1376,7 @@ tracker_decorator_constructed (GObject *object)
 
 	conn = tracker_miner_get_connection (TRACKER_MINER (decorator));
 	decorator->notifier = tracker_sparql_connection_create_notifier (conn);
+	decorator->graph_iris = expand_graph_iris (decorator, conn);
 	g_signal_connect_swapped (decorator->notifier, "events",
 	                          G_CALLBACK (notifier_events_cb),
 	                          decorator);
@@ -971,6 +1391,8 @@ static void
 tracker_decorator_finalize (GObject *object)
 {
 	TrackerDecorator *decorator;
+	TrackerDecoratorInfo *info;
+	guint i;
 
 	decorator = TRACKER_DECORATOR (object);
 
@@ -979,8 +1401,11 @@ tracker_decorator_finalize (GObject *object)
 	g_clear_object (&decorator->update_hash);
 	g_clear_object (&decorator->delete_file);
 	g_strfreev (decorator->priority_graphs);
+	g_strfreev (decorator->graphs);
+	g_strfreev (decorator->graph_iris);
 
 	g_clear_handle_id (&decorator->throttle_id, g_source_remove);
+	g_clear_handle_id (&decorator->commit_timeout_id, g_source_remove);
 	g_clear_object (&decorator->extractor);
 	g_clear_object (&decorator->persistence);
 
@@ -990,14 +1415,32 @@ tracker_decorator_finalize (GObject *object)
 	g_clear_object (&decorator->notifier);
 
 	g_clear_object (&decorator->cursor);
-	g_clear_pointer (&decorator->item, tracker_decorator_info_free);
-	g_clear_pointer (&decorator->next_item, tracker_decorator_info_free);
 
-	g_clear_object (&decorator->batch);
+	/* Items being extracted are freed by their callbacks */
+	for (i = 0; i < decorator->extracting->len; i++) {
+		info = g_ptr_array_index (decorator->extracting, i);
+		info->decorator = NULL;
+	}
+
+	for (i = 0; i < decorator->cancelled->len; i++) {
+		info = g_ptr_array_index (decorator->cancelled, i);
+		info->decorator = NULL;
+	}
+
+	g_clear_pointer (&decorator->extracting, g_ptr_array_unref);
+	g_clear_pointer (&decorator->cancelled, g_ptr_array_unref);
+	g_queue_clear_full (&decorator->prefetched,
+	                    (GDestroyNotify) tracker_decorator_info_free);
+	g_clear_pointer (&decorator->suspects, g_hash_table_unref);
+
+	/* Pending hints are of no use anymore */
+	g_thread_pool_free (decorator->prefetch_pool, TRUE, TRUE);
+
 	g_clear_object (&decorator->root);
 
 	g_clear_pointer (&decorator->buffer, g_ptr_array_unref);
-	g_clear_pointer (&decorator->commit_buffer, g_ptr_array_unref);
+	g_queue_clear_full (&decorator->pending_commits,
+	                    (GDestroyNotify) g_ptr_array_unref);
 	g_timer_destroy (decorator->timer);
 
 	G_OBJECT_CLASS (tracker_decorator_parent_class)->finalize (object);
@@ -1010,16 +1453,27 @@ tracker_decorator_paused (TrackerMiner *miner)
 
 	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Paused"));
 
-	if (decorator->querying || decorator->updating || decorator->extracting) {
+	if (decorator->querying || decorator->n_commits > 0 ||
+	    decorator->extracting->len > 0) {
 		g_cancellable_cancel (decorator->cancellable);
 		g_set_object (&decorator->cancellable, g_cancellable_new ());
 		decorator->querying = FALSE;
-		decorator->updating = FALSE;
-		decorator->extracting = FALSE;
+		decorator->n_commits = 0;
+
+		/* Cancelled items are freed by their callbacks. Modules
+		 * may still be running on them, so these are dropped from
+		 * the persistence file only as they finish.
+		 */
+		g_ptr_array_extend_and_steal (decorator->cancelled,
+		                              g_steal_pointer (&decorator->extracting));
+		decorator->extracting = g_ptr_array_new ();
 	}
 
+	/* Buffered items are kept, and committed after resuming */
+	g_clear_handle_id (&decorator->commit_timeout_id, g_source_remove);
 	g_clear_handle_id (&decorator->throttle_id, g_source_remove);
 	decorator_clear_cache (decorator);
+	decorator->needs_recount = TRUE;
 	g_timer_stop (decorator->timer);
 }
 
@@ -1029,6 +1483,7 @@ tracker_decorator_resumed (TrackerMiner *miner)
 	TrackerDecorator *decorator = TRACKER_DECORATOR (miner);
 
 	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Resumed"));
+	decorator_check_commit (decorator);
 	decorator_rebuild_cache (decorator);
 	g_timer_continue (decorator->timer);
 }
@@ -1040,6 +1495,7 @@ tracker_decorator_stopped (TrackerMiner *miner)
 
 	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Stopped"));
 	decorator_clear_cache (decorator);
+	decorator->needs_recount = TRUE;
 	g_timer_stop (decorator->timer);
 }
 
@@ -1047,18 +1503,27 @@ static void
 tracker_decorator_started (TrackerMiner *miner)
 {
 	TrackerDecorator *decorator = TRACKER_DECORATOR (miner);
-	GFile *file;
+	GList *files, *l;
 
 	TRACKER_NOTE (DECORATOR, g_message ("[Decorator] Started"));
 
-	file = tracker_extract_persistence_get_file (decorator->persistence);
+	files = tracker_extract_persistence_get_files (decorator->persistence);
 
-	if (file) {
-		tracker_decorator_raise_error (TRACKER_DECORATOR (miner), file,
+	if (files && !files->next) {
+		tracker_decorator_raise_error (TRACKER_DECORATOR (miner), files->data,
 		                               "Crash/hang handling file", NULL);
 		decorator_commit_info (decorator);
+	} else {
+		/* Several files were being extracted, any of them
+		 * could be at fault. Find out without blaming all.
+		 */
+		for (l = files; l; l = l->next)
+			g_hash_table_add (decorator->suspects, g_object_ref (l->data));
 	}
 
+	g_list_free_full (files, g_object_unref);
+	tracker_extract_persistence_clear (decorator->persistence);
+
 	decorator_rebuild_cache (decorator);
 	g_timer_start (decorator->timer);
 }
@@ -1097,6 +1562,12 @@ tracker_decorator_class_init (TrackerDecoratorClass *klass)
 		                     G_PARAM_WRITABLE |
 		                     G_PARAM_CONSTRUCT_ONLY |
 		                     G_PARAM_STATIC_STRINGS);
+	props[PROP_GRAPHS] =
+		g_param_spec_boxed ("graphs", NULL, NULL,
+		                    G_TYPE_STRV,
+		                    G_PARAM_WRITABLE |
+		                    G_PARAM_CONSTRUCT_ONLY |
+		                    G_PARAM_STATIC_STRINGS);
 
 	g_object_class_install_properties (object_class, N_PROPS, props);
 
@@ -1128,21 +1599,45 @@ tracker_decorator_class_init (TrackerDecoratorClass *klass)
 static void
 tracker_decorator_init (TrackerDecorator *decorator)
 {
+	const gchar *max_commits_envvar;
+
+	decorator->needs_recount = TRUE;
+
+	max_commits_envvar = g_getenv ("TRACKER_EXTRACT_MAX_COMMITS");
+	if (max_commits_envvar)
+		decorator->max_commits = MAX (atoi (max_commits_envvar), 1);
+	else
+		decorator->max_commits = DEFAULT_MAX_COMMITS;
+
 	decorator->timer = g_timer_new ();
 	decorator->cancellable = g_cancellable_new ();
+	decorator->extracting = g_ptr_array_new ();
+	decorator->cancelled = g_ptr_array_new ();
+	g_queue_init (&decorator->prefetched);
+	g_queue_init (&decorator->pending_commits);
+	decorator->prefetch_pool =
+		g_thread_pool_new_full (prefetch_thread_func, NULL,
+		                        (GDestroyNotify) prefetch_request_free,
+		                        PREFETCH_THREADS, FALSE, NULL);
+	decorator->suspects = g_hash_table_new_full (g_file_hash,
+	                                             (GEqualFunc) g_file_equal,
+	                                             g_object_unref,
+	                                             NULL);
 }
 
 TrackerDecorator *
 tracker_decorator_new (TrackerSparqlConnection   *connection,
                        TrackerExtract            *extract,
                        TrackerExtractPersistence *persistence,
-                       GFile                     *root)
+                       GFile                     *root,
+                       const gchar * const       *graphs)
 {
 	return g_object_new (TRACKER_TYPE_DECORATOR,
 			     "connection", connection,
 			     "extractor", extract,
 	                     "persistence", persistence,
 	                     "root", root,
+	                     "graphs", graphs,
 			     NULL);
 }
 
@@ -1162,6 +1657,27 @@ tracker_decorator_set_throttled (TrackerDecorator *decorator,
 	decorator->throttled = !!throttled;
 }
 
+void
+tracker_decorator_set_max_jobs (TrackerDecorator *decorator,
+                                gint              max_jobs)
+{
+	decorator->max_jobs = MAX (max_jobs, 0);
+
+	/* Fill in new slots, if any */
+	if (decorator->processing)
+		decorator_get_next_file (decorator);
+}
+
+void
+tracker_decorator_set_prefetch_window (TrackerDecorator *decorator,
+                                       gint              prefetch_window)
+{
+	decorator->prefetch_window = MAX (prefetch_window, 0);
+
+	if (decorator->processing)
+		decorator_prefetch_items (decorator);
+}
+
 void
 tracker_decorator_check_unextracted (TrackerDecorator *decorator)
 {
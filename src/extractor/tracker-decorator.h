@@ -37,7 +37,8 @@ G_DECLARE_FINAL_TYPE (TrackerDecorator,
 TrackerDecorator * tracker_decorator_new (TrackerSparqlConnection   *connection,
                                           TrackerExtract            *extract,
                                           TrackerExtractPersistence *persistence,
-                                          GFile                     *root);
+                                          GFile                     *root,
+                                          const gchar * const       *graphs);
 
 void tracker_decorator_set_priority_graphs (TrackerDecorator    *decorator,
                                             const gchar * const *graphs);
@@ -45,6 +46,12 @@ void tracker_decorator_set_priority_graphs (TrackerDecorator    *decorator,
 void tracker_decorator_set_throttled (TrackerDecorator *decorator,
                                       gboolean          throttled);
 
+void tracker_decorator_set_max_jobs (TrackerDecorator *decorator,
+                                     gint              max_jobs);
+
+void tracker_decorator_set_prefetch_window (TrackerDecorator *decorator,
+                                            gint              prefetch_window);
+
 void tracker_decorator_check_unextracted (TrackerDecorator *decorator);
 
 G_END_DECLS
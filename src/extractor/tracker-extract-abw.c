@@ -270,6 +270,12 @@ abw_sax_end_element_ns (void          *ctx,
 	}
 }
 
+G_MODULE_EXPORT gboolean
+tracker_extract_module_thread_safe (void)
+{
+	return TRUE;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
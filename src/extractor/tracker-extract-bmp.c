@@ -108,6 +108,12 @@ get_img_resolution (const GFile *file,
 	return TRUE;
 }
 
+G_MODULE_EXPORT gboolean
+tracker_extract_module_thread_safe (void)
+{
+	return TRUE;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
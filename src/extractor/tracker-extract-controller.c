@@ -110,6 +110,14 @@ update_extract_config (TrackerExtractController *controller,
 		    g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
 			tracker_extract_set_max_text (controller->extractor,
 			                              g_variant_get_int32 (value));
+		} else if (g_strcmp0 (key, "max-jobs") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			tracker_decorator_set_max_jobs (controller->decorator,
+			                                g_variant_get_int32 (value));
+		} else if (g_strcmp0 (key, "prefetch-window") == 0 &&
+		           g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+			tracker_decorator_set_prefetch_window (controller->decorator,
+			                                       g_variant_get_int32 (value));
 		} else if (g_strcmp0 (key, "on-battery") == 0 &&
 		           g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN)) {
 			tracker_decorator_set_throttled (controller->decorator,
@@ -258,6 +258,12 @@ process_desktop_file (TrackerResource  *resource,
 	return TRUE;
 }
 
+G_MODULE_EXPORT gboolean
+tracker_extract_module_thread_safe (void)
+{
+	return TRUE;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
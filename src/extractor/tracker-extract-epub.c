@@ -593,7 +593,7 @@ tracker_extract_module_init (GError **error)
 }
 
 static gboolean
-parse_xml_from_zip_sax (const gchar          *zip_uri,
+parse_xml_from_zip_sax (TrackerZipArchive    *archive,
                         const gchar          *member_name,
                         const xmlSAXHandler  *sax,
                         gpointer              user_data,
@@ -607,7 +607,7 @@ parse_xml_from_zip_sax (const gchar          *zip_uri,
 	gsize len;
 	gboolean ok = TRUE;
 
-	stream = tracker_zip_read_file (zip_uri, member_name, NULL, error);
+	stream = tracker_zip_archive_read_file (archive, member_name, NULL, error);
 	if (!stream)
 		return FALSE;
 
@@ -668,7 +668,7 @@ parse_xml_from_zip_sax (const gchar          *zip_uri,
 }
 
 static gchar *
-extract_opf_path (const gchar *uri)
+extract_opf_path (TrackerZipArchive *archive)
 {
 	g_autofree char *path = NULL;
 	g_autoptr(GError) error = NULL;
@@ -677,7 +677,7 @@ extract_opf_path (const gchar *uri)
 		.startElementNs = container_start_element_ns,
 	};
 
-	parse_xml_from_zip_sax (uri, "META-INF/container.xml", &sax, &path, &error);
+	parse_xml_from_zip_sax (archive, "META-INF/container.xml", &sax, &path, &error);
 
 	if (error) {
 		g_warning ("Could not get EPUB container.xml file: %s", error->message);
@@ -689,7 +689,7 @@ extract_opf_path (const gchar *uri)
 
 static gchar *
 extract_opf_contents (TrackerExtractInfo *info,
-                      const gchar        *uri,
+                      TrackerZipArchive  *archive,
                       const gchar        *content_prefix,
                       GList              *content_files)
 {
@@ -715,7 +715,7 @@ extract_opf_contents (TrackerExtractInfo *info,
 		else
 			path = g_build_filename (content_prefix, l->data, NULL);
 
-		parse_xml_from_zip_sax (uri, path, &sax, &content_data, &error);
+		parse_xml_from_zip_sax (archive, path, &sax, &content_data, &error);
 
 		if (error) {
 			g_warning ("Error extracting EPUB contents (%s): %s",
@@ -736,6 +736,7 @@ extract_opf_contents (TrackerExtractInfo *info,
 static TrackerResource *
 extract_opf (TrackerExtractInfo *info,
              const gchar        *uri,
+             TrackerZipArchive  *archive,
              const gchar        *opf_path)
 {
 	TrackerResource *ebook;
@@ -761,7 +762,7 @@ extract_opf (TrackerExtractInfo *info,
 
 	data = opf_data_new (uri, ebook);
 
-	parse_xml_from_zip_sax (uri, opf_path, &sax, data, &error);
+	parse_xml_from_zip_sax (archive, opf_path, &sax, data, &error);
 
 	if (error) {
 		g_warning ("Could not get EPUB '%s' file: %s\n", opf_path,
@@ -773,7 +774,7 @@ extract_opf (TrackerExtractInfo *info,
 	}
 
 	dirname = g_path_get_dirname (opf_path);
-	contents = extract_opf_contents (info, uri, dirname, data->pages);
+	contents = extract_opf_contents (info, archive, dirname, data->pages);
 	g_free (dirname);
 
 	if (contents && *contents) {
@@ -786,23 +787,34 @@ extract_opf (TrackerExtractInfo *info,
 	return ebook;
 }
 
+G_MODULE_EXPORT gboolean
+tracker_extract_module_thread_safe (void)
+{
+	return TRUE;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
 {
 	g_autoptr (TrackerResource) ebook = NULL;
+	g_autoptr (TrackerZipArchive) archive = NULL;
 	g_autofree char *opf_path = NULL, *uri = NULL;
 	GFile *file;
 
 	file = tracker_extract_info_get_file (info);
 	uri = g_file_get_uri (file);
 
-	opf_path = extract_opf_path (uri);
+	archive = tracker_zip_archive_open (uri, error);
+	if (!archive)
+		return FALSE;
+
+	opf_path = extract_opf_path (archive);
 
 	if (!opf_path)
 		return FALSE;
 
-	ebook = extract_opf (info, uri, opf_path);
+	ebook = extract_opf (info, uri, archive, opf_path);
 
 	tracker_extract_info_set_resource (info, ebook);
 
@@ -106,6 +106,12 @@ find_max_width_and_height (GFile   *file,
 	return TRUE;
 }
 
+G_MODULE_EXPORT gboolean
+tracker_extract_module_thread_safe (void)
+{
+	return TRUE;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
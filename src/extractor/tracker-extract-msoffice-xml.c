@@ -68,6 +68,7 @@ typedef enum {
 typedef struct {
 	/* Common constant stuff */
 	const gchar *uri;
+	TrackerZipArchive *archive;
 	MsOfficeXMLFileType file_type;
 
 	/* Tag type, reused by Content and Metadata parsers */
@@ -598,7 +599,7 @@ tracker_extract_module_init (GError **error)
 }
 
 static gboolean
-parse_xml_from_zip_sax (const gchar         *zip_uri,
+parse_xml_from_zip_sax (TrackerZipArchive   *archive,
                         const gchar         *member_name,
                         const xmlSAXHandler *sax,
                         gpointer             user_data,
@@ -612,7 +613,7 @@ parse_xml_from_zip_sax (const gchar         *zip_uri,
 	gsize len;
 	gboolean ok = TRUE;
 
-	stream = tracker_zip_read_file (zip_uri, member_name, NULL, error);
+	stream = tracker_zip_archive_read_file (archive, member_name, NULL, error);
 	if (!stream)
 		return FALSE;
 
@@ -713,7 +714,7 @@ xml_read (MsOfficeXMLParserInfo *parser_info,
 		return TRUE;
 	}
 
-	if (!parse_xml_from_zip_sax (parser_info->uri, xml_filename, &sax, parser_info, &error) && error) {
+	if (!parse_xml_from_zip_sax (parser_info->archive, xml_filename, &sax, parser_info, &error) && error) {
 		g_debug ("Parsing internal '%s' gave error: '%s'",
 		         xml_filename,
 		         error->message);
@@ -882,11 +883,18 @@ extract_content (MsOfficeXMLParserInfo *info)
 	}
 }
 
+G_MODULE_EXPORT gboolean
+tracker_extract_module_thread_safe (void)
+{
+	return TRUE;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
                               GError             **error)
 {
 	MsOfficeXMLParserInfo info = { 0 };
+	g_autoptr (TrackerZipArchive) archive = NULL;
 	MsOfficeXMLFileType file_type;
 	TrackerResource *metadata;
 	GError *inner_error = NULL;
@@ -926,7 +934,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 	info.bytes_pending = tracker_extract_info_get_max_text (extract_info);
 	info.text_buf = g_string_new ("");
 
-	if (!parse_xml_from_zip_sax (uri, "[Content_Types].xml", &sax, &info, &inner_error)) {
+	archive = tracker_zip_archive_open (uri, &inner_error);
+	info.archive = archive;
+
+	if (!archive ||
+	    !parse_xml_from_zip_sax (archive, "[Content_Types].xml", &sax, &info, &inner_error)) {
 		if (inner_error)
 			g_propagate_prefixed_error (error, inner_error, "Could not open:");
 		else
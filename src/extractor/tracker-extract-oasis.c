@@ -111,10 +111,10 @@ static void oasis_content_end_element_ns       (void          *ctx,
 static void oasis_content_characters           (void          *ctx,
                                              	const xmlChar *ch,
                                             	int            len);
-static void extract_oasis_content              (const gchar     *uri,
-                                                gulong           total_bytes,
-                                                ODTFileType      file_type,
-                                                TrackerResource *metadata);
+static void extract_oasis_content              (TrackerZipArchive *archive,
+                                                gulong             total_bytes,
+                                                ODTFileType        file_type,
+                                                TrackerResource   *metadata);
 
 G_MODULE_EXPORT gboolean
 tracker_extract_module_init (GError **error)
@@ -126,7 +126,7 @@ tracker_extract_module_init (GError **error)
 #define ZIP_XML_BUFFER_SIZE 8192
 
 static gboolean
-parse_xml_from_zip_sax (const gchar          *zip_uri,
+parse_xml_from_zip_sax (TrackerZipArchive    *archive,
                         const gchar          *member_name,
                         const xmlSAXHandler  *sax,
                         gpointer              user_data,
@@ -140,7 +140,7 @@ parse_xml_from_zip_sax (const gchar          *zip_uri,
 	gsize len;
 	gboolean ok = TRUE;
 
-	stream = tracker_zip_read_file (zip_uri, member_name, NULL, error);
+	stream = tracker_zip_archive_read_file (archive, member_name, NULL, error);
 	if (!stream)
 		return FALSE;
 
@@ -202,10 +202,10 @@ parse_xml_from_zip_sax (const gchar          *zip_uri,
 }
 
 static void
-extract_oasis_content (const gchar     *uri,
-                       gulong           total_bytes,
-                       ODTFileType      file_type,
-                       TrackerResource *metadata)
+extract_oasis_content (TrackerZipArchive *archive,
+                       gulong             total_bytes,
+                       ODTFileType        file_type,
+                       TrackerResource   *metadata)
 {
 	gchar *content = NULL;
 	ODTContentParseInfo info;
@@ -229,7 +229,7 @@ extract_oasis_content (const gchar     *uri,
 	info.bytes_pending = total_bytes;
 	info.limit_reached = FALSE;
 
-	parse_xml_from_zip_sax (uri, "content.xml", &sax, &info, &error);
+	parse_xml_from_zip_sax (archive, "content.xml", &sax, &info, &error);
 
 	if (info.limit_reached) {
 		g_clear_error (&error);
@@ -258,11 +258,18 @@ extract_oasis_content (const gchar     *uri,
 	g_queue_free (info.tag_stack);
 }
 
+G_MODULE_EXPORT gboolean
+tracker_extract_module_thread_safe (void)
+{
+	return TRUE;
+}
+
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
                               GError             **error)
 {
 	TrackerResource *metadata;
+	g_autoptr (TrackerZipArchive) archive = NULL;
 	ODTMetadataParseInfo info = { 0 };
 	ODTFileType file_type;
 	GFile *file;
@@ -300,7 +307,10 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 	info.uri = uri;
 	info.text_buf = g_string_new ("");
 
-	parse_xml_from_zip_sax (uri, "meta.xml", &sax, &info, NULL);
+	archive = tracker_zip_archive_open (uri, NULL);
+
+	if (archive)
+		parse_xml_from_zip_sax (archive, "meta.xml", &sax, &info, NULL);
 
 	if (g_ascii_strcasecmp (mime_used, "application/vnd.oasis.opendocument.text") == 0) {
 		file_type = FILE_TYPE_ODT;
@@ -316,10 +326,12 @@ tracker_extract_get_metadata (TrackerExtractInfo  *extract_info,
 	}
 
 	/* Extract content with the given limitations */
-	extract_oasis_content (uri,
-	                       tracker_extract_info_get_max_text (extract_info),
-	                       file_type,
-	                       metadata);
+	if (archive) {
+		extract_oasis_content (archive,
+		                       tracker_extract_info_get_max_text (extract_info),
+		                       file_type,
+		                       metadata);
+	}
 
 	if (info.text_buf)
  		g_string_free (info.text_buf, TRUE);
@@ -17,11 +17,22 @@
  * Boston, MA  02110-1301, USA.
  */
 
+#include "config-miners.h"
+
+#include <string.h>
+#include <unistd.h>
+
 #include "tracker-extract-persistence.h"
 
+/* The persistence file holds the paths of the files being
+ * extracted, each followed by a nul character, with an empty
+ * string terminating the list.
+ */
+
 struct _TrackerExtractPersistence
 {
 	GObject parent_instance;
+	GPtrArray *paths;
 	int fd;
 };
 
@@ -36,6 +47,8 @@ tracker_extract_persistence_finalize (GObject *object)
 	if (persistence->fd >= 0)
 		close (persistence->fd);
 
+	g_ptr_array_unref (persistence->paths);
+
 	G_OBJECT_CLASS (tracker_extract_persistence_parent_class)->finalize (object);
 }
 
@@ -51,6 +64,7 @@ static void
 tracker_extract_persistence_init (TrackerExtractPersistence *persistence)
 {
 	persistence->fd = -1;
+	persistence->paths = g_ptr_array_new_with_free_func (g_free);
 }
 
 TrackerExtractPersistence *
@@ -69,52 +83,121 @@ tracker_extract_persistence_set_fd (TrackerExtractPersistence *persistence,
 	persistence->fd = fd;
 }
 
-void
-tracker_extract_persistence_set_file (TrackerExtractPersistence *persistence,
-                                      GFile                     *file)
+static void
+write_paths (TrackerExtractPersistence *persistence)
 {
-	g_autofree gchar *path = NULL;
+	g_autoptr (GString) str = NULL;
 	ssize_t retval;
-	size_t len, written = 0;
+	size_t written = 0;
+	guint i;
 
-	g_return_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence));
-	g_return_if_fail (!file || G_IS_FILE (file));
+	if (persistence->fd < 0)
+		return;
 
-	if (file) {
-		path = g_file_get_path (file);
-	} else {
-		path = g_strdup ("");
-	}
+	str = g_string_new (NULL);
+
+	for (i = 0; i < persistence->paths->len; i++) {
+		const char *path = g_ptr_array_index (persistence->paths, i);
 
-	/* Write also the trailing \0 */
-	len = strlen (path) + 1;
+		/* Write also the trailing \0 */
+		g_string_append_len (str, path, strlen (path) + 1);
+	}
 
-	lseek (persistence->fd, 0, SEEK_SET);
+	g_string_append_c (str, '\0');
 
-	while (TRUE) {
-		retval = write (persistence->fd, &path[written], len - written);
-		if (retval < 0 || written + retval >= len)
+	while (written < str->len) {
+		retval = pwrite (persistence->fd, &str->str[written],
+		                 str->len - written, written);
+		if (retval <= 0)
 			break;
 
 		written += retval;
 	}
+
+	if (ftruncate (persistence->fd, written) < 0)
+		g_debug ("Could not truncate persistence file: %m");
 }
 
-GFile *
-tracker_extract_persistence_get_file (TrackerExtractPersistence *persistence)
+void
+tracker_extract_persistence_add_file (TrackerExtractPersistence *persistence,
+                                      GFile                     *file)
 {
-	gchar buf[2048];
-	int len;
+	char *path;
+
+	g_return_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence));
+	g_return_if_fail (G_IS_FILE (file));
+
+	path = g_file_get_path (file);
+	if (!path)
+		return;
+
+	g_ptr_array_add (persistence->paths, path);
+	write_paths (persistence);
+}
+
+void
+tracker_extract_persistence_remove_file (TrackerExtractPersistence *persistence,
+                                         GFile                     *file)
+{
+	const char *path;
+	guint i;
+
+	g_return_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence));
+	g_return_if_fail (G_IS_FILE (file));
+
+	path = g_file_peek_path (file);
+	if (!path)
+		return;
+
+	for (i = 0; i < persistence->paths->len; i++) {
+		if (g_strcmp0 (g_ptr_array_index (persistence->paths, i), path) == 0) {
+			g_ptr_array_remove_index_fast (persistence->paths, i);
+			write_paths (persistence);
+			return;
+		}
+	}
+}
+
+void
+tracker_extract_persistence_clear (TrackerExtractPersistence *persistence)
+{
+	g_return_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence));
+
+	g_ptr_array_set_size (persistence->paths, 0);
+	write_paths (persistence);
+}
+
+GList *
+tracker_extract_persistence_get_files (TrackerExtractPersistence *persistence)
+{
+	g_autoptr (GString) str = NULL;
+	GList *files = NULL;
+	gchar buf[4096];
+	gsize pos = 0;
+	ssize_t len;
 
 	g_return_val_if_fail (TRACKER_IS_EXTRACT_PERSISTENCE (persistence), NULL);
 
-	lseek (persistence->fd, 0, SEEK_SET);
-	len = read (persistence->fd, buf, sizeof (buf));
-	if (len <= 0)
-		return NULL;
-	if (buf[0] == '\0')
+	if (persistence->fd < 0)
 		return NULL;
 
-	buf[len - 1] = '\0';
-	return g_file_new_for_path (buf);
+	str = g_string_new (NULL);
+
+	while ((len = pread (persistence->fd, buf, sizeof (buf), str->len)) > 0)
+		g_string_append_len (str, buf, len);
+
+	while (pos < str->len && str->str[pos] != '\0') {
+		const char *path = &str->str[pos];
+		gsize path_len;
+
+		/* Last path may be truncated */
+		path_len = strnlen (path, str->len - pos);
+		if (pos + path_len >= str->len)
+			break;
+
+		files = g_list_prepend (files, g_file_new_for_path (path));
+		pos += path_len + 1;
+	}
+
+	return g_list_reverse (files);
 }
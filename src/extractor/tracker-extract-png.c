@@ -20,6 +20,9 @@
 
 #include "config-miners.h"
 
+#include <stdio.h>
+#include <string.h>
+
 #include <png.h>
 
 #include <tracker-common.h>
@@ -38,6 +41,24 @@
 #define RFC1123_DATE_FORMAT "%d %B %Y %H:%M:%S %z"
 #define CMS_PER_INCH        2.54
 
+#define PNG_SIGNATURE_SIZE    8
+#define PNG_CHUNK_HEADER_SIZE 8
+#define PNG_CHUNK_CRC_SIZE    4
+
+/* Feeds libpng with all the chunks in the file, except image data.
+ * IDAT chunks are seeked over, and a single empty IDAT header is
+ * emitted in place of IEND, so png_read_info() parses every metadata
+ * chunk in the file and stops there, without inflating any pixels.
+ */
+typedef struct {
+	FILE *f;
+	guchar header[PNG_CHUNK_HEADER_SIZE];
+	gsize header_pos;
+	gsize header_len;
+	goffset remaining;
+	gboolean finished;
+} PngChunkReader;
+
 typedef struct {
 	const gchar *author;
 	const gchar *creator;
@@ -164,11 +185,82 @@ raw_profile_new (const gchar *input,
 
 #endif /* defined(PNG_iTXt_SUPPORTED) && (defined(HAVE_EXEMPI) || defined(HAVE_GEXIV2)) */
 
+static gboolean
+png_chunk_reader_next (PngChunkReader *reader)
+{
+	guchar header[PNG_CHUNK_HEADER_SIZE];
+	guint32 length;
+
+	while (TRUE) {
+		if (fread (header, 1, sizeof (header), reader->f) != sizeof (header))
+			return FALSE;
+
+		length = ((guint32) header[0] << 24 | (guint32) header[1] << 16 |
+		          (guint32) header[2] << 8 | (guint32) header[3]);
+
+		if (length > PNG_UINT_31_MAX)
+			return FALSE;
+
+		if (memcmp (&header[4], "IDAT", 4) == 0) {
+			if (fseeko (reader->f, (off_t) length + PNG_CHUNK_CRC_SIZE, SEEK_CUR) < 0)
+				return FALSE;
+			continue;
+		}
+
+		if (memcmp (&header[4], "IEND", 4) == 0) {
+			static const guchar idat_header[] = { 0, 0, 0, 0, 'I', 'D', 'A', 'T' };
+
+			memcpy (reader->header, idat_header, sizeof (idat_header));
+			reader->remaining = 0;
+			reader->finished = TRUE;
+		} else {
+			memcpy (reader->header, header, sizeof (header));
+			reader->remaining = (goffset) length + PNG_CHUNK_CRC_SIZE;
+		}
+
+		reader->header_pos = 0;
+		reader->header_len = sizeof (reader->header);
+
+		return TRUE;
+	}
+}
+
+static void
+png_chunk_reader_read (png_structp png_ptr,
+                       png_bytep   data,
+                       png_size_t  length)
+{
+	PngChunkReader *reader = png_get_io_ptr (png_ptr);
+
+	while (length > 0) {
+		gsize n;
+
+		if (reader->header_pos < reader->header_len) {
+			n = MIN (length, reader->header_len - reader->header_pos);
+			memcpy (data, &reader->header[reader->header_pos], n);
+			reader->header_pos += n;
+		} else if (reader->remaining > 0) {
+			n = MIN ((goffset) length, reader->remaining);
+
+			if (fread (data, 1, n, reader->f) != n)
+				png_error (png_ptr, "Read error");
+
+			reader->remaining -= n;
+		} else if (reader->finished || !png_chunk_reader_next (reader)) {
+			png_error (png_ptr, "Read error");
+		} else {
+			continue;
+		}
+
+		data += n;
+		length -= n;
+	}
+}
+
 static void
 read_metadata (TrackerResource      *metadata,
                png_structp           png_ptr,
                png_infop             info_ptr,
-               png_infop             end_ptr,
                GFile                *file,
                const gchar          *uri)
 {
@@ -179,154 +271,147 @@ read_metadata (TrackerResource      *metadata,
 #ifdef HAVE_EXEMPI
 	TrackerXmpData *xd = NULL;
 #endif
-	png_infop info_ptrs[2];
 	png_textp text_ptr;
-	gint info_index;
 	gint num_text;
 	gint i;
 	gint found;
 
-	info_ptrs[0] = info_ptr;
-	info_ptrs[1] = end_ptr;
+	if ((found = png_get_text (png_ptr, info_ptr, &text_ptr, &num_text)) < 1) {
+		g_debug ("Calling png_get_text() returned %d (< 1)", found);
+		num_text = 0;
+	}
 
-	for (info_index = 0; info_index < 2; info_index++) {
-		if ((found = png_get_text (png_ptr, info_ptrs[info_index], &text_ptr, &num_text)) < 1) {
-			g_debug ("Calling png_get_text() returned %d (< 1)", found);
+	for (i = 0; i < num_text; i++) {
+		if (!text_ptr[i].key || !text_ptr[i].text || text_ptr[i].text[0] == '\0') {
 			continue;
 		}
 
-		for (i = 0; i < num_text; i++) {
-			if (!text_ptr[i].key || !text_ptr[i].text || text_ptr[i].text[0] == '\0') {
-				continue;
-			}
-
 #if defined(HAVE_EXEMPI) && defined(PNG_iTXt_SUPPORTED)
-			if (g_strcmp0 ("XML:com.adobe.xmp", text_ptr[i].key) == 0) {
-				/* ATM tracker_extract_xmp_read supports setting xd
-				 * multiple times, keep it that way as here it's
-				 * theoretically possible that the function gets
-				 * called multiple times
-				 */
-				xd = tracker_xmp_new (text_ptr[i].text,
-				                      text_ptr[i].itxt_length,
-				                      uri);
+		if (g_strcmp0 ("XML:com.adobe.xmp", text_ptr[i].key) == 0) {
+			/* ATM tracker_extract_xmp_read supports setting xd
+			 * multiple times, keep it that way as here it's
+			 * theoretically possible that the function gets
+			 * called multiple times
+			 */
+			xd = tracker_xmp_new (text_ptr[i].text,
+			                      text_ptr[i].itxt_length,
+			                      uri);
 
-				continue;
-			}
+			continue;
+		}
 
-			if (!xd && g_strcmp0 ("Raw profile type xmp", text_ptr[i].key) == 0) {
-				gchar *xmp_buffer;
-				guint xmp_buffer_length = 0;
-				guint input_len;
+		if (!xd && g_strcmp0 ("Raw profile type xmp", text_ptr[i].key) == 0) {
+			gchar *xmp_buffer;
+			guint xmp_buffer_length = 0;
+			guint input_len;
 
-				if (text_ptr[i].text_length) {
-					input_len = text_ptr[i].text_length;
-				} else {
-					input_len = text_ptr[i].itxt_length;
-				}
+			if (text_ptr[i].text_length) {
+				input_len = text_ptr[i].text_length;
+			} else {
+				input_len = text_ptr[i].itxt_length;
+			}
 
-				xmp_buffer = raw_profile_new (text_ptr[i].text,
-				                              input_len,
-				                              &xmp_buffer_length);
+			xmp_buffer = raw_profile_new (text_ptr[i].text,
+			                              input_len,
+			                              &xmp_buffer_length);
 
-				if (xmp_buffer) {
-					xd = tracker_xmp_new (xmp_buffer,
-					                      xmp_buffer_length,
-					                      uri);
-				}
+			if (xmp_buffer) {
+				xd = tracker_xmp_new (xmp_buffer,
+				                      xmp_buffer_length,
+				                      uri);
+			}
 
-				g_free (xmp_buffer);
+			g_free (xmp_buffer);
 
-				continue;
-			}
+			continue;
+		}
 #endif /*HAVE_EXEMPI && PNG_iTXt_SUPPORTED */
 
 #if defined(HAVE_GEXIV2) && defined(PNG_iTXt_SUPPORTED)
-			if (!ed && g_strcmp0 ("Raw profile type exif", text_ptr[i].key) == 0) {
-				gchar *exif_buffer;
-				guint exif_buffer_length = 0;
-				guint input_len;
-
-				if (text_ptr[i].text_length) {
-					input_len = text_ptr[i].text_length;
-				} else {
-					input_len = text_ptr[i].itxt_length;
-				}
-
-				exif_buffer = raw_profile_new (text_ptr[i].text,
-				                               input_len,
-				                               &exif_buffer_length);
+		if (!ed && g_strcmp0 ("Raw profile type exif", text_ptr[i].key) == 0) {
+			gchar *exif_buffer;
+			guint exif_buffer_length = 0;
+			guint input_len;
+
+			if (text_ptr[i].text_length) {
+				input_len = text_ptr[i].text_length;
+			} else {
+				input_len = text_ptr[i].itxt_length;
+			}
 
-				if (exif_buffer) {
-					ed = tracker_exif_new (exif_buffer,
-					                       exif_buffer_length,
-					                       uri);
+			exif_buffer = raw_profile_new (text_ptr[i].text,
+			                               input_len,
+			                               &exif_buffer_length);
 
-					if (!ed) {
-						GExiv2Metadata *metadata;
+			if (exif_buffer) {
+				ed = tracker_exif_new (exif_buffer,
+				                       exif_buffer_length,
+				                       uri);
 
-						metadata = gexiv2_metadata_new ();
-						if (gexiv2_metadata_open_path (metadata,
-						                               g_file_peek_path (file),
-						                               NULL)) {
-							ed = tracker_exif_new_from_metadata (metadata);
-						}
+				if (!ed) {
+					GExiv2Metadata *metadata;
 
-						g_clear_object (&metadata);
+					metadata = gexiv2_metadata_new ();
+					if (gexiv2_metadata_open_path (metadata,
+					                               g_file_peek_path (file),
+					                               NULL)) {
+						ed = tracker_exif_new_from_metadata (metadata);
 					}
+
+					g_clear_object (&metadata);
 				}
+			}
 
-				g_free (exif_buffer);
+			g_free (exif_buffer);
 
-				continue;
-			}
+			continue;
+		}
 #endif /* HAVE_GEXIV2 && PNG_iTXt_SUPPORTED */
 
-			if (g_strcmp0 (text_ptr[i].key, "Author") == 0) {
-				pd.author = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Author") == 0) {
+			pd.author = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Creator") == 0) {
-				pd.creator = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Creator") == 0) {
+			pd.creator = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Description") == 0) {
-				pd.description = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Description") == 0) {
+			pd.description = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Comment") == 0) {
-				pd.comment = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Comment") == 0) {
+			pd.comment = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Copyright") == 0) {
-				pd.copyright = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Copyright") == 0) {
+			pd.copyright = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Creation Time") == 0) {
-				g_clear_pointer (&pd.creation_time, g_free);
-				pd.creation_time = rfc1123_to_iso8601_date (text_ptr[i].text);
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Creation Time") == 0) {
+			g_clear_pointer (&pd.creation_time, g_free);
+			pd.creation_time = rfc1123_to_iso8601_date (text_ptr[i].text);
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Title") == 0) {
-				pd.title = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Title") == 0) {
+			pd.title = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0 (text_ptr[i].key, "Disclaimer") == 0) {
-				pd.disclaimer = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0 (text_ptr[i].key, "Disclaimer") == 0) {
+			pd.disclaimer = text_ptr[i].text;
+			continue;
+		}
 
-			if (g_strcmp0(text_ptr[i].key, "Software") == 0) {
-				pd.software = text_ptr[i].text;
-				continue;
-			}
+		if (g_strcmp0(text_ptr[i].key, "Software") == 0) {
+			pd.software = text_ptr[i].text;
+			continue;
 		}
 	}
 
@@ -451,13 +536,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
                               GError             **error)
 {
 	TrackerResource *metadata;
+	PngChunkReader reader = { 0 };
 	goffset size;
 	FILE *f;
 	png_structp png_ptr;
 	png_infop info_ptr;
-	png_infop end_ptr;
-	png_bytep row_data;
-	guint row;
 	png_uint_32 width, height;
 	gint bit_depth, color_type;
 	gint interlace_type, compression_type, filter_type;
@@ -500,20 +583,15 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		return FALSE;
 	}
 
-	end_ptr = png_create_info_struct (png_ptr);
-	if (!end_ptr) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
-		tracker_file_close (f, FALSE);
-		return FALSE;
-	}
-
 	if (setjmp (png_jmpbuf (png_ptr))) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
+		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
 		tracker_file_close (f, FALSE);
 		return FALSE;
 	}
 
-	png_init_io (png_ptr, f);
+	reader.f = f;
+	reader.remaining = PNG_SIGNATURE_SIZE;
+	png_set_read_fn (png_ptr, &reader, png_chunk_reader_read);
 	png_read_info (png_ptr, info_ptr);
 
 	if (!png_get_IHDR (png_ptr,
@@ -525,21 +603,11 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 	                   &interlace_type,
 	                   &compression_type,
 	                   &filter_type)) {
-		png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
+		png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
 		tracker_file_close (f, FALSE);
 		return FALSE;
 	}
 
-	/* Read the image. FIXME We should be able to skip this step and
-	 * just get the info from the end. This causes some errors atm.
-	 */
-	row_data = png_malloc (png_ptr, png_get_rowbytes (png_ptr, info_ptr));
-	for (row = 0; row < height; row++)
-		png_read_row (png_ptr, row_data, NULL);
-	png_free (png_ptr, row_data);
-
-	png_read_end (png_ptr, end_ptr);
-
 	resource_uri = tracker_extract_info_get_content_id (info, NULL);
 	metadata = tracker_resource_new (resource_uri);
 	g_free (resource_uri);
@@ -549,7 +617,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 
 	uri = g_file_get_uri (file);
 
-	read_metadata (metadata, png_ptr, info_ptr, end_ptr, file, uri);
+	read_metadata (metadata, png_ptr, info_ptr, file, uri);
 	g_free (uri);
 
 	tracker_resource_set_int64 (metadata, "nfo:width", width);
@@ -560,7 +628,7 @@ tracker_extract_get_metadata (TrackerExtractInfo  *info,
 		tracker_resource_set_string (metadata, "nmm:dlnaMime", dlna_mimetype);
 	}
 
-	png_destroy_read_struct (&png_ptr, &info_ptr, &end_ptr);
+	png_destroy_read_struct (&png_ptr, &info_ptr, NULL);
 	tracker_file_close (f, FALSE);
 
 	tracker_extract_info_set_resource (info, metadata);
@@ -35,10 +35,15 @@ G_DEFINE_QUARK (TrackerExtractError, tracker_extract_error)
 
 #define DEFAULT_MAX_TEXT 1048576
 
+/* Upper bound of concurrent extractions, the decorator
+ * decides how many of these are actually used.
+ */
+#define MAX_EXTRACT_THREADS 32
+
 static gint deadline_seconds = -1;
 
 typedef struct {
-	GTimer *elapsed;
+	gint64 elapsed;
 	gint extracted_count;
 	gint failed_count;
 } StatisticsData;
@@ -52,12 +57,12 @@ struct _TrackerExtract {
 
 	gint max_text;
 
-	GMainContext *thread_context;
-	GMainLoop *thread_loop;
-
-	GThread *task_thread;
+	GThreadPool *task_pool;
+	GThreadPool *serial_pool; /* For modules that are not thread-safe */
 
+	GMutex statistics_mutex;
 	GTimer *total_elapsed;
+	guint n_running_tasks;
 
 	gint unhandled_count;
 };
@@ -73,19 +78,14 @@ typedef struct {
 
 	TrackerExtractMetadataFunc func;
 	GModule *module;
+	gboolean thread_safe;
 
+	GMainContext *context;
 	GSource *deadline;
 } TrackerExtractTaskData;
 
 G_DEFINE_TYPE(TrackerExtract, tracker_extract, G_TYPE_OBJECT)
 
-static void
-statistics_data_free (StatisticsData *data)
-{
-	g_timer_destroy (data->elapsed);
-	g_free (data);
-}
-
 static void
 tracker_extract_init (TrackerExtract *extract)
 {
@@ -98,14 +98,14 @@ tracker_extract_init (TrackerExtract *extract)
 	extract->module_manager = tracker_module_manager_new ();
 
 	extract->max_text = DEFAULT_MAX_TEXT;
+	g_mutex_init (&extract->statistics_mutex);
 
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
 		extract->total_elapsed = g_timer_new ();
 		g_timer_stop (extract->total_elapsed);
 		extract->statistics_data =
-			g_hash_table_new_full (NULL, NULL, NULL,
-			                       (GDestroyNotify) statistics_data_free);
+			g_hash_table_new_full (NULL, NULL, NULL, g_free);
 	}
 #endif
 }
@@ -136,12 +136,15 @@ log_statistics (GObject *object)
 				name = g_module_name (module);
 				name_without_path = strrchr (name, G_DIR_SEPARATOR) + 1;
 
+				/* Extractions may run in parallel, so this
+				 * may add up to more than 100% of the time.
+				 */
 				g_message ("    Module:'%s', extracted:%d, failures:%d, elapsed: %.2fs (%.2f%% of total)",
 				           name_without_path,
 				           data->extracted_count,
 				           data->failed_count,
-					   g_timer_elapsed (data->elapsed, NULL),
-					   (g_timer_elapsed (data->elapsed, NULL) / total_elapsed) * 100);
+				           (gdouble) data->elapsed / G_USEC_PER_SEC,
+				           ((gdouble) data->elapsed / G_USEC_PER_SEC / total_elapsed) * 100);
 			}
 		}
 
@@ -162,16 +165,11 @@ tracker_extract_finalize (GObject *object)
 {
 	TrackerExtract *extract = TRACKER_EXTRACT (object);
 
-	if (extract->thread_loop) {
-		g_main_loop_quit (extract->thread_loop);
-		g_main_loop_unref (extract->thread_loop);
-	}
-
-	if (extract->task_thread)
-		g_thread_join (extract->task_thread);
-
-	if (extract->thread_context)
-		g_main_context_unref (extract->thread_context);
+	/* Drop queued tasks, and wait for the running ones */
+	if (extract->task_pool)
+		g_thread_pool_free (extract->task_pool, TRUE, TRUE);
+	if (extract->serial_pool)
+		g_thread_pool_free (extract->serial_pool, TRUE, TRUE);
 
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
@@ -181,6 +179,7 @@ tracker_extract_finalize (GObject *object)
 	}
 #endif
 
+	g_mutex_clear (&extract->statistics_mutex);
 	g_clear_object (&extract->module_manager);
 
 	G_OBJECT_CLASS (tracker_extract_parent_class)->finalize (object);
@@ -287,25 +286,11 @@ extract_task_data_new (TrackerExtract *extract,
 		                                 module_path,
 		                                 &task->func,
 		                                 &task->module,
+		                                 &task->thread_safe,
 		                                 NULL);
 	}
 
-	if (!RUNNING_ON_VALGRIND) {
-		if (deadline_seconds < 0) {
-			const gchar *deadline_envvar;
-
-			deadline_envvar = g_getenv ("TRACKER_EXTRACT_DEADLINE");
-			if (deadline_envvar)
-				deadline_seconds = atoi (deadline_envvar);
-			else
-				deadline_seconds = DEFAULT_DEADLINE_SECONDS;
-		}
-		task->deadline =
-			g_timeout_source_new_seconds (deadline_seconds);
-		g_source_set_callback (task->deadline, task_deadline_cb, task, NULL);
-		g_source_attach (task->deadline,
-		                 g_main_context_get_thread_default ());
-	}
+	task->context = g_main_context_ref_thread_default ();
 
 	return task;
 }
@@ -318,6 +303,8 @@ extract_task_data_free (TrackerExtractTaskData *data)
 		g_source_unref (data->deadline);
 	}
 
+	g_main_context_unref (data->context);
+
 	g_clear_object (&data->file);
 	g_free (data->mimetype);
 	g_free (data->file_id);
@@ -327,6 +314,31 @@ extract_task_data_free (TrackerExtractTaskData *data)
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (TrackerExtractTaskData, extract_task_data_free)
 
+static void
+extract_task_data_start_deadline (TrackerExtractTaskData *task)
+{
+	if (RUNNING_ON_VALGRIND)
+		return;
+
+	if (deadline_seconds < 0) {
+		const gchar *deadline_envvar;
+
+		deadline_envvar = g_getenv ("TRACKER_EXTRACT_DEADLINE");
+		if (deadline_envvar)
+			deadline_seconds = atoi (deadline_envvar);
+		else
+			deadline_seconds = DEFAULT_DEADLINE_SECONDS;
+	}
+
+	/* Started when extraction begins, tasks may wait for a
+	 * previous file handled by the same module.
+	 */
+	task->deadline =
+		g_timeout_source_new_seconds (deadline_seconds);
+	g_source_set_callback (task->deadline, task_deadline_cb, task, NULL);
+	g_source_attach (task->deadline, task->context);
+}
+
 static gboolean
 get_metadata (GTask *task)
 {
@@ -335,26 +347,18 @@ get_metadata (GTask *task)
 	TrackerExtractInfo *info;
 	GError *error = NULL;
 	gboolean success = FALSE;
+#ifdef G_ENABLE_DEBUG
+	gint64 start_time = 0;
+#endif
 
 	if (g_task_return_error_if_cancelled (task))
 		return FALSE;
 
+	extract_task_data_start_deadline (data);
+
 #ifdef G_ENABLE_DEBUG
-	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
-		StatisticsData *stats_data;
-
-		stats_data = g_hash_table_lookup (extract->statistics_data,
-						  data->module);
-		if (!stats_data) {
-			stats_data = g_new0 (StatisticsData, 1);
-			stats_data->elapsed = g_timer_new ();
-			g_hash_table_insert (extract->statistics_data,
-					     data->module,
-					     stats_data);
-		} else {
-			g_timer_continue (stats_data->elapsed);
-		}
-	}
+	if (TRACKER_DEBUG_CHECK (STATISTICS))
+		start_time = g_get_monotonic_time ();
 #endif
 
 	if (get_file_metadata (data, &info, &error)) {
@@ -375,13 +379,21 @@ get_metadata (GTask *task)
 
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
+		g_mutex_lock (&extract->statistics_mutex);
+
 		if (data->module) {
 			StatisticsData *stats_data;
 
 			stats_data = g_hash_table_lookup (extract->statistics_data,
 			                                  data->module);
-			g_timer_stop (stats_data->elapsed);
+			if (!stats_data) {
+				stats_data = g_new0 (StatisticsData, 1);
+				g_hash_table_insert (extract->statistics_data,
+				                     data->module,
+				                     stats_data);
+			}
 
+			stats_data->elapsed += g_get_monotonic_time () - start_time;
 			stats_data->extracted_count++;
 
 			if (!success) {
@@ -390,6 +402,8 @@ get_metadata (GTask *task)
 		} else {
 			extract->unhandled_count++;
 		}
+
+		g_mutex_unlock (&extract->statistics_mutex);
 	}
 #endif
 
@@ -399,31 +413,22 @@ get_metadata (GTask *task)
 	return FALSE;
 }
 
-static gboolean
-handle_task_in_thread (gpointer user_data)
+static void
+metadata_thread_func (gpointer data,
+                      gpointer user_data)
 {
-	g_autoptr (GTask) task = user_data;
+	g_autoptr (GTask) task = data;
+	g_autoptr (GMainContext) context = NULL;
 
-	get_metadata (task);
-
-	return G_SOURCE_REMOVE;
-}
-
-
-static gpointer
-metadata_thread_func (GMainLoop *loop)
-{
-	GMainContext *context;
-
-	context = g_main_loop_get_context (loop);
+	/* Give every extraction its own thread-default context,
+	 * for modules running their own main loops.
+	 */
+	context = g_main_context_new ();
 	g_main_context_push_thread_default (context);
 
-	g_main_loop_run (loop);
+	get_metadata (task);
 
 	g_main_context_pop_thread_default (context);
-	g_main_loop_unref (loop);
-
-	return NULL;
 }
 
 void
@@ -439,6 +444,7 @@ tracker_extract_file (TrackerExtract      *extract,
 	g_autoptr (GTask) task = NULL;
 	g_autoptr (GError) error = NULL;
 	TrackerExtractTaskData *data;
+	GThreadPool **pool;
 	const char *graph;
 
 	g_return_if_fail (TRACKER_IS_EXTRACT (extract));
@@ -469,34 +475,39 @@ tracker_extract_file (TrackerExtract      *extract,
 	}
 
 	task = g_task_new (extract, cancellable, cb, user_data);
+	g_task_set_source_tag (task, tracker_extract_file);
 	data = extract_task_data_new (extract, file, file_id, content_id, mimetype, graph);
 	g_task_set_task_data (task, data, (GDestroyNotify) extract_task_data_free);
 
 #ifdef G_ENABLE_DEBUG
 	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
-		g_timer_continue (extract->total_elapsed);
+		if (extract->n_running_tasks == 0)
+			g_timer_continue (extract->total_elapsed);
 	}
 #endif
 
-	if (!extract->task_thread) {
-		extract->thread_context = g_main_context_new ();
-		extract->thread_loop = g_main_loop_new (extract->thread_context, FALSE);
+	/* Balanced in tracker_extract_file_finish() */
+	extract->n_running_tasks++;
 
-		extract->task_thread =
-			g_thread_try_new ("single",
-					  (GThreadFunc) metadata_thread_func,
-					  g_main_loop_ref (extract->thread_loop),
-					  &error);
-		if (!extract->task_thread) {
-			g_task_return_error (task, error);
+	/* Modules that are not known to be thread-safe get
+	 * their files extracted one at a time.
+	 */
+	pool = data->thread_safe ? &extract->task_pool : &extract->serial_pool;
+
+	if (!*pool) {
+		*pool = g_thread_pool_new_full (metadata_thread_func,
+		                                extract,
+		                                (GDestroyNotify) g_object_unref,
+		                                data->thread_safe ? MAX_EXTRACT_THREADS : 1,
+		                                FALSE,
+		                                &error);
+		if (!*pool) {
+			g_task_return_error (task, g_steal_pointer (&error));
 			return;
 		}
-
 	}
 
-	g_main_context_invoke (extract->thread_context,
-	                       handle_task_in_thread,
-	                       g_steal_pointer (&task));
+	g_thread_pool_push (*pool, g_steal_pointer (&task), NULL);
 }
 
 TrackerExtractInfo *
@@ -533,6 +544,8 @@ tracker_extract_file_sync (TrackerExtract  *object,
 	                              file_id, content_id,
 	                              mimetype, graph);
 
+	extract_task_data_start_deadline (task);
+
 	if (!get_file_metadata (task, &info, error))
 		return NULL;
 
@@ -548,11 +561,16 @@ tracker_extract_file_finish (TrackerExtract  *extract,
 	g_return_val_if_fail (G_IS_ASYNC_RESULT (res), NULL);
 	g_return_val_if_fail (!error || !*error, NULL);
 
+	if (g_task_get_source_tag (G_TASK (res)) == tracker_extract_file) {
+		extract->n_running_tasks--;
+
 #ifdef G_ENABLE_DEBUG
-	if (TRACKER_DEBUG_CHECK (STATISTICS)) {
-		g_timer_stop (extract->total_elapsed);
-	}
+		if (TRACKER_DEBUG_CHECK (STATISTICS)) {
+			if (extract->n_running_tasks == 0)
+				g_timer_stop (extract->total_elapsed);
+		}
 #endif
+	}
 
 	return g_task_propagate_pointer (G_TASK (res), error);
 }
@@ -63,6 +63,7 @@ static TrackerSparqlConnection *conn;
 
 static gchar *filename;
 static char *root;
+static char **graphs;
 static gchar *mime_type;
 static gchar *output_format_name;
 static gboolean version;
@@ -89,6 +90,10 @@ static GOptionEntry entries[] = {
 	  G_OPTION_ARG_FILENAME, &root,
 	  N_("Filesystem root of the extracted data"),
 	  N_("FILE") },
+	{ "graph", 0, 0,
+	  G_OPTION_ARG_STRING_ARRAY, &graphs,
+	  N_("Only extract files in this graph (may be given multiple times)"),
+	  N_("GRAPH") },
 	{ "version", 'V', 0,
 	  G_OPTION_ARG_NONE, &version,
 	  N_("Displays version information"),
@@ -381,7 +386,8 @@ do_main (int argc, char *argv[])
 	persistence = tracker_extract_persistence_new ();
 
 	decorator = tracker_decorator_new (sparql_connection,
-	                                   extract, persistence, root_file);
+	                                   extract, persistence, root_file,
+	                                   (const gchar * const *) graphs);
 
 	controller = tracker_extract_controller_new (decorator,
 	                                             extract,
@@ -26,9 +26,11 @@
 #define EXTRACTOR_FUNCTION "tracker_extract_get_metadata"
 #define INIT_FUNCTION      "tracker_extract_module_init"
 #define SHUTDOWN_FUNCTION  "tracker_extract_module_shutdown"
+#define THREAD_SAFE_FUNCTION "tracker_extract_module_thread_safe"
 
 typedef gboolean (* TrackerExtractInitFunc) (GError **error);
 typedef void (* TrackerExtractShutdownFunc) (void);
+typedef gboolean (* TrackerExtractThreadSafeFunc) (void);
 
 typedef struct
 {
@@ -36,6 +38,7 @@ typedef struct
 	TrackerExtractInitFunc init_func;
 	TrackerExtractShutdownFunc shutdown_func;
 	TrackerExtractMetadataFunc extract_func;
+	gboolean thread_safe;
 } TrackerExtractModule;
 
 struct _TrackerModuleManager
@@ -55,6 +58,7 @@ tracker_extract_module_new (const char  *module_path,
 	GModule *module;
 	TrackerExtractInitFunc init_func;
 	TrackerExtractShutdownFunc shutdown_func;
+	TrackerExtractThreadSafeFunc thread_safe_func;
 	TrackerExtractMetadataFunc extract_func;
 
 	/* Load the module */
@@ -82,6 +86,7 @@ tracker_extract_module_new (const char  *module_path,
 
 	g_module_symbol (module, INIT_FUNCTION, (gpointer *) &init_func);
 	g_module_symbol (module, SHUTDOWN_FUNCTION, (gpointer *) &shutdown_func);
+	g_module_symbol (module, THREAD_SAFE_FUNCTION, (gpointer *) &thread_safe_func);
 
 	if (init_func && !init_func (error))
 		return NULL;
@@ -92,6 +97,7 @@ tracker_extract_module_new (const char  *module_path,
 		.init_func = init_func,
 		.shutdown_func = shutdown_func,
 		.extract_func = extract_func,
+		.thread_safe = thread_safe_func && thread_safe_func (),
 	};
 
 	return extract_module;
@@ -170,6 +176,7 @@ tracker_module_manager_get_func (TrackerModuleManager        *manager,
                                  const char                  *module_path,
                                  TrackerExtractMetadataFunc  *func_out,
                                  GModule                    **module_out,
+                                 gboolean                    *thread_safe_out,
                                  GError                     **error)
 {
 	TrackerExtractModule *module;
@@ -181,6 +188,8 @@ tracker_module_manager_get_func (TrackerModuleManager        *manager,
 		*func_out = module->extract_func;
 	if (module_out)
 		*module_out = module->module;
+	if (thread_safe_out)
+		*thread_safe_out = module->thread_safe;
 
 	return TRUE;
 }
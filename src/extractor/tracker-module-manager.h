@@ -38,4 +38,5 @@ gboolean tracker_module_manager_get_func (TrackerModuleManager        *manager,
                                           const char                  *module_path,
                                           TrackerExtractMetadataFunc  *func_out,
                                           GModule                    **module_out,
+                                          gboolean                    *thread_safe_out,
                                           GError                     **error);
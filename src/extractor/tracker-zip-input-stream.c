@@ -27,10 +27,20 @@
 
 #include "tracker-zip-input-stream.h"
 
+/* An open archive, with its members indexed by name. Streams
+ * for its members hold a reference on it.
+ */
+struct _TrackerZipArchive {
+	gint ref_count;
+	gchar *filename;
+	zip_t *zip;
+	GHashTable *members;
+};
+
 struct _TrackerZipInputStream {
 	GInputStream parent_instance;
 
-	zip_t *zip;
+	TrackerZipArchive *archive;
 	zip_file_t *zfile;
 
 	zip_uint64_t size;
@@ -111,10 +121,7 @@ tracker_zip_input_stream_close (GInputStream  *stream,
 			self->zfile = NULL;
 		}
 
-		if (self->zip) {
-			zip_close (self->zip);
-			self->zip = NULL;
-		}
+		g_clear_pointer (&self->archive, tracker_zip_archive_unref);
 
 		self->closed = TRUE;
 	}
@@ -145,58 +152,146 @@ tracker_zip_input_stream_init (TrackerZipInputStream *self)
 {
 }
 
-GInputStream *
-tracker_zip_read_file (const gchar   *zip_file_uri,
-                       const gchar   *member_name,
-                       GCancellable  *cancellable,
-                       GError       **error)
+TrackerZipArchive *
+tracker_zip_archive_open (const gchar  *zip_file_uri,
+                          GError      **error)
 {
 	g_autofree gchar *filename = NULL;
+	TrackerZipArchive *archive;
 	zip_t *zip = NULL;
-	zip_file_t *zfile = NULL;
-	zip_stat_t st;
+	zip_int64_t n_entries, i;
 	int errcode = 0;
-	zip_error_t *ze = NULL;
-	const char *msg = NULL;
-	TrackerZipInputStream *self = NULL;
 
 	g_return_val_if_fail (zip_file_uri != NULL, NULL);
-	g_return_val_if_fail (member_name != NULL, NULL);
 
 	filename = g_filename_from_uri (zip_file_uri, NULL, error);
 	if (!filename)
 		return NULL;
 
-	zip = zip_open (filename, 0, &errcode);
+	zip = zip_open (filename, ZIP_RDONLY, &errcode);
 	if (!zip) {
 		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
 		             "Failed to open zip '%s' (libzip errcode=%d)", filename, errcode);
 		return NULL;
 	}
 
+	archive = g_new0 (TrackerZipArchive, 1);
+	archive->ref_count = 1;
+	archive->filename = g_steal_pointer (&filename);
+	archive->zip = zip;
+	archive->members = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                          g_free, NULL);
+
+	/* Index member names once, so looking them up does not need
+	 * going through the central directory again.
+	 */
+	n_entries = zip_get_num_entries (zip, 0);
+
+	for (i = 0; i < n_entries; i++) {
+		const char *name;
+
+		name = zip_get_name (zip, i, 0);
+		if (!name)
+			continue;
+
+		/* Keep the first entry with a given name, as libzip does */
+		if (!g_hash_table_contains (archive->members, name)) {
+			g_hash_table_insert (archive->members,
+			                     g_strdup (name),
+			                     GSIZE_TO_POINTER ((gsize) i));
+		}
+	}
+
+	return archive;
+}
+
+TrackerZipArchive *
+tracker_zip_archive_ref (TrackerZipArchive *archive)
+{
+	g_atomic_int_inc (&archive->ref_count);
+
+	return archive;
+}
+
+void
+tracker_zip_archive_unref (TrackerZipArchive *archive)
+{
+	if (!g_atomic_int_dec_and_test (&archive->ref_count))
+		return;
+
+	zip_close (archive->zip);
+	g_hash_table_unref (archive->members);
+	g_free (archive->filename);
+	g_free (archive);
+}
+
+GInputStream *
+tracker_zip_archive_read_file (TrackerZipArchive  *archive,
+                               const gchar        *member_name,
+                               GCancellable       *cancellable,
+                               GError            **error)
+{
+	TrackerZipInputStream *self = NULL;
+	zip_file_t *zfile = NULL;
+	zip_stat_t st;
+	zip_error_t *ze = NULL;
+	const char *msg = NULL;
+	gpointer value;
+	zip_uint64_t index;
+
+	g_return_val_if_fail (archive != NULL, NULL);
+	g_return_val_if_fail (member_name != NULL, NULL);
+
+	if (!g_hash_table_lookup_extended (archive->members, member_name,
+	                                   NULL, &value)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+		             "No member '%s' in zip '%s'", member_name, archive->filename);
+		return NULL;
+	}
+
+	index = (zip_uint64_t) GPOINTER_TO_SIZE (value);
+
 	zip_stat_init (&st);
-	if (zip_stat (zip, member_name, 0, &st) != 0) {
-		zip_close (zip);
+	if (zip_stat_index (archive->zip, index, 0, &st) != 0) {
 		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
-		             "No member '%s' in zip '%s'", member_name, filename);
+		             "No member '%s' in zip '%s'", member_name, archive->filename);
 		return NULL;
 	}
 
-	zfile = zip_fopen (zip, member_name, 0);
+	zfile = zip_fopen_index (archive->zip, index, 0);
 	if (!zfile) {
-		ze = zip_get_error (zip);
+		ze = zip_get_error (archive->zip);
 		msg = ze ? zip_error_strerror (ze) : "Unknown libzip error";
-		zip_close (zip);
 		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
-		             "Failed to open member '%s' in zip '%s': %s", member_name, filename, msg);
+		             "Failed to open member '%s' in zip '%s': %s",
+		             member_name, archive->filename, msg);
 		return NULL;
 	}
 
 	self = g_object_new (TRACKER_TYPE_ZIP_INPUT_STREAM, NULL);
-	self->zip = zip;
+	self->archive = tracker_zip_archive_ref (archive);
 	self->zfile = zfile;
 	self->size = st.size;
 	self->pos = 0;
 
 	return G_INPUT_STREAM (self);
 }
+
+GInputStream *
+tracker_zip_read_file (const gchar   *zip_file_uri,
+                       const gchar   *member_name,
+                       GCancellable  *cancellable,
+                       GError       **error)
+{
+	g_autoptr (TrackerZipArchive) archive = NULL;
+
+	g_return_val_if_fail (zip_file_uri != NULL, NULL);
+	g_return_val_if_fail (member_name != NULL, NULL);
+
+	archive = tracker_zip_archive_open (zip_file_uri, error);
+	if (!archive)
+		return NULL;
+
+	return tracker_zip_archive_read_file (archive, member_name,
+	                                      cancellable, error);
+}
@@ -33,6 +33,22 @@ G_DECLARE_FINAL_TYPE (TrackerZipInputStream,
                       ZIP_INPUT_STREAM,
                       GInputStream)
 
+typedef struct _TrackerZipArchive TrackerZipArchive;
+
+TrackerZipArchive * tracker_zip_archive_open (const gchar  *zip_file_uri,
+                                              GError      **error);
+
+TrackerZipArchive * tracker_zip_archive_ref (TrackerZipArchive *archive);
+
+void tracker_zip_archive_unref (TrackerZipArchive *archive);
+
+GInputStream * tracker_zip_archive_read_file (TrackerZipArchive  *archive,
+                                              const gchar        *member_name,
+                                              GCancellable       *cancellable,
+                                              GError            **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (TrackerZipArchive, tracker_zip_archive_unref)
+
 GInputStream * tracker_zip_read_file (const gchar   *zip_file_uri,
                                       const gchar   *member_name,
                                       GCancellable  *cancellable,
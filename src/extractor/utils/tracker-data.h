@@ -43,6 +43,11 @@ G_BEGIN_DECLS
 gboolean tracker_extract_module_init     (GError **error);
 gboolean tracker_extract_module_shutdown (void);
 
+/* Modules returning TRUE may extract several files at once,
+ * others get all their files extracted one at a time.
+ */
+gboolean tracker_extract_module_thread_safe (void);
+
 /**
  * tracker_extract_get_metadata:
  * @info: a #TrackerExtractInfo object
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2026, The GNOME Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+#include "tracker-directory-reader.h"
+
+/* Native directory reader for the crawler. Directories are opened
+ * with openat(), read with getdents64() and their children stat'ed
+ * with statx() relative to the directory fd, only asking for the
+ * fields in INDEXER_FILE_ATTRIBUTES. This avoids most of the per-file
+ * overhead of GFileEnumerator.
+ */
+
+#define DIRENT_BUFFER_SIZE (32 * 1024)
+#define MAX_READER_THREADS 8
+
+#define STATX_FIELDS (STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_INO | \
+                      STATX_ATIME | STATX_MTIME | STATX_BTIME)
+
+struct _TrackerDirectoryReader {
+	GThreadPool *pool;
+};
+
+static GHashTable *
+read_hidden_file (int dir_fd)
+{
+	GHashTable *hidden = NULL;
+	g_autoptr (GString) str = NULL;
+	char buf[4096];
+	gssize len;
+	char **lines;
+	int fd, i;
+
+	/* Same as GIO, names listed in .hidden are hidden files */
+	fd = openat (dir_fd, ".hidden", O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+	if (fd < 0)
+		return NULL;
+
+	str = g_string_new (NULL);
+
+	while ((len = read (fd, buf, sizeof (buf))) > 0)
+		g_string_append_len (str, buf, len);
+
+	close (fd);
+
+	lines = g_strsplit (str->str, "\n", -1);
+	hidden = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (i = 0; lines[i]; i++) {
+		if (*lines[i])
+			g_hash_table_add (hidden, g_steal_pointer (&lines[i]));
+		else
+			g_free (lines[i]);
+	}
+
+	g_free (lines);
+
+	return hidden;
+}
+
+static GFileType
+file_type_from_mode (mode_t mode)
+{
+	if (S_ISREG (mode))
+		return G_FILE_TYPE_REGULAR;
+	else if (S_ISDIR (mode))
+		return G_FILE_TYPE_DIRECTORY;
+	else if (S_ISLNK (mode))
+		return G_FILE_TYPE_SYMBOLIC_LINK;
+	else
+		return G_FILE_TYPE_SPECIAL;
+}
+
+static GFileInfo *
+create_file_info (const char         *name,
+                  const struct statx *stx,
+                  const struct statx *parent_stx,
+                  GHashTable         *hidden)
+{
+	GFileInfo *info;
+	g_autofree char *display_name = NULL, *fs_id = NULL;
+	gboolean is_hidden;
+
+	info = g_file_info_new ();
+	display_name = g_filename_display_name (name);
+	is_hidden = name[0] == '.' ||
+		(hidden && g_hash_table_contains (hidden, name));
+
+	g_file_info_set_name (info, name);
+	g_file_info_set_display_name (info, display_name);
+	g_file_info_set_file_type (info, file_type_from_mode (stx->stx_mode));
+	g_file_info_set_size (info, stx->stx_size);
+	g_file_info_set_is_hidden (info, is_hidden);
+	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT,
+	                                   stx->stx_dev_major != parent_stx->stx_dev_major ||
+	                                   stx->stx_dev_minor != parent_stx->stx_dev_minor);
+
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+	                                  stx->stx_mtime.tv_sec);
+	g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+	                                  stx->stx_mtime.tv_nsec / 1000);
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_ACCESS,
+	                                  stx->stx_atime.tv_sec);
+
+	/* Same format as GIO */
+	fs_id = g_strdup_printf ("l%" G_GUINT64_FORMAT,
+	                         (guint64) makedev (stx->stx_dev_major,
+	                                            stx->stx_dev_minor));
+	g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM, fs_id);
+	g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE,
+	                                  stx->stx_ino);
+
+	if (stx->stx_mask & STATX_BTIME) {
+		g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CREATED,
+		                                  stx->stx_btime.tv_sec);
+		g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CREATED_USEC,
+		                                  stx->stx_btime.tv_nsec / 1000);
+	}
+
+	return info;
+}
+
+static GPtrArray *
+read_directory (const char    *path,
+                GCancellable  *cancellable,
+                GError       **error)
+{
+	g_autoptr (GPtrArray) names = NULL;
+	g_autoptr (GPtrArray) infos = NULL;
+	g_autoptr (GHashTable) hidden = NULL;
+	g_autofree char *buf = NULL;
+	struct statx parent_stx;
+	gboolean has_hidden_file = FALSE;
+	gssize len;
+	guint i;
+	int fd;
+
+	fd = openat (AT_FDCWD, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		goto error;
+
+	if (statx (fd, "", AT_EMPTY_PATH, STATX_TYPE, &parent_stx) < 0)
+		goto error;
+
+	buf = g_malloc (DIRENT_BUFFER_SIZE);
+	names = g_ptr_array_new_with_free_func (g_free);
+
+	while ((len = getdents64 (fd, buf, DIRENT_BUFFER_SIZE)) > 0) {
+		gssize pos = 0;
+
+		while (pos < len) {
+			struct dirent64 *entry = (struct dirent64 *) &buf[pos];
+
+			pos += entry->d_reclen;
+
+			if (strcmp (entry->d_name, ".") == 0 ||
+			    strcmp (entry->d_name, "..") == 0)
+				continue;
+
+			if (strcmp (entry->d_name, ".hidden") == 0)
+				has_hidden_file = TRUE;
+
+			g_ptr_array_add (names, g_strdup (entry->d_name));
+		}
+
+		if (g_cancellable_is_cancelled (cancellable))
+			break;
+	}
+
+	if (len < 0)
+		goto error;
+
+	if (has_hidden_file)
+		hidden = read_hidden_file (fd);
+
+	infos = g_ptr_array_new_full (names->len, g_object_unref);
+
+	for (i = 0; i < names->len; i++) {
+		const char *name = g_ptr_array_index (names, i);
+		struct statx stx;
+
+		if (i % 100 == 0 && g_cancellable_is_cancelled (cancellable))
+			break;
+
+		/* Files may be gone already, or be inaccessible, skip those */
+		if (statx (fd, name,
+		           AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+		           STATX_FIELDS, &stx) < 0)
+			continue;
+
+		g_ptr_array_add (infos,
+		                 create_file_info (name, &stx, &parent_stx, hidden));
+	}
+
+	close (fd);
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		return NULL;
+
+	return g_steal_pointer (&infos);
+
+ error:
+	{
+		int saved_errno = errno;
+
+		if (fd >= 0)
+			close (fd);
+
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (saved_errno),
+		             "Could not read directory '%s': %s",
+		             path, g_strerror (saved_errno));
+		return NULL;
+	}
+}
+
+static void
+read_thread_func (gpointer data,
+                  gpointer user_data)
+{
+	GTask *task = data;
+	GPtrArray *infos;
+	GError *error = NULL;
+
+	infos = read_directory (g_task_get_task_data (task),
+	                        g_task_get_cancellable (task),
+	                        &error);
+
+	if (infos)
+		g_task_return_pointer (task, infos, (GDestroyNotify) g_ptr_array_unref);
+	else
+		g_task_return_error (task, error);
+
+	g_object_unref (task);
+}
+
+TrackerDirectoryReader *
+tracker_directory_reader_new (void)
+{
+	TrackerDirectoryReader *reader;
+	struct statx stx;
+
+	/* Fall back to GIO if statx() is not available at runtime */
+	if (statx (AT_FDCWD, "/", AT_SYMLINK_NOFOLLOW, STATX_TYPE, &stx) < 0 &&
+	    errno == ENOSYS)
+		return NULL;
+
+	reader = g_new0 (TrackerDirectoryReader, 1);
+	reader->pool = g_thread_pool_new (read_thread_func, reader,
+	                                  CLAMP (g_get_num_processors (),
+	                                         1, MAX_READER_THREADS),
+	                                  FALSE, NULL);
+	return reader;
+}
+
+void
+tracker_directory_reader_free (TrackerDirectoryReader *reader)
+{
+	/* Let pending reads run, so their tasks get a return value */
+	g_thread_pool_free (reader->pool, FALSE, TRUE);
+	g_free (reader);
+}
+
+void
+tracker_directory_reader_read_async (TrackerDirectoryReader *reader,
+                                     GFile                  *directory,
+                                     GCancellable           *cancellable,
+                                     GAsyncReadyCallback     callback,
+                                     gpointer                user_data)
+{
+	GTask *task;
+
+	task = g_task_new (directory, cancellable, callback, user_data);
+	g_task_set_source_tag (task, tracker_directory_reader_read_async);
+	g_task_set_task_data (task, g_file_get_path (directory), g_free);
+
+	if (!g_task_get_task_data (task)) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+		                         "Not a local directory");
+		g_object_unref (task);
+		return;
+	}
+
+	g_thread_pool_push (reader->pool, task, NULL);
+}
+
+GPtrArray *
+tracker_directory_reader_read_finish (GAsyncResult  *result,
+                                      GError       **error)
+{
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026, The GNOME Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_DIRECTORY_READER_H__
+#define __TRACKER_DIRECTORY_READER_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerDirectoryReader TrackerDirectoryReader;
+
+TrackerDirectoryReader * tracker_directory_reader_new (void);
+
+void tracker_directory_reader_free (TrackerDirectoryReader *reader);
+
+void tracker_directory_reader_read_async (TrackerDirectoryReader *reader,
+                                          GFile                  *directory,
+                                          GCancellable           *cancellable,
+                                          GAsyncReadyCallback     callback,
+                                          gpointer                user_data);
+
+GPtrArray * tracker_directory_reader_read_finish (GAsyncResult  *result,
+                                                  GError       **error);
+
+G_END_DECLS
+
+#endif /* __TRACKER_DIRECTORY_READER_H__ */
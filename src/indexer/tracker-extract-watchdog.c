@@ -49,24 +49,87 @@ enum {
 
 static GParamSpec *props[N_PROPS] = { 0, };
 
-struct _TrackerExtractWatchdog {
-	GObject parent_class;
-	TrackerSparqlConnection *sparql_conn;
+typedef struct {
+	const gchar *name;
+	const gchar *graphs[3];
+} ExtractorGroup;
+
+/* Extractor modules are split across several processes, based on the
+ * graph their rules put the extracted data in. This keeps the heavy
+ * document and media modules (poppler, gstreamer, libav, ...) apart from
+ * each other and from the light ones, so a crash or a file going over the
+ * deadline only restarts the process handling that group.
+ */
+static const ExtractorGroup extractor_groups[] = {
+	{ "documents", { "tracker:Documents", NULL } },
+	{ "media", { "tracker:Audio", "tracker:Video", NULL } },
+	{ "other", { "tracker:Pictures", "tracker:Software", NULL } },
+};
+
+typedef struct {
+	TrackerExtractWatchdog *watchdog;
+	const ExtractorGroup *group;
 	GSubprocessLauncher *launcher;
 	GSubprocess *extract_process;
 	GCancellable *cancellable;
 	GDBusConnection *conn;
 	TrackerEndpoint *endpoint;
 	TrackerFilesInterface *files_interface;
-	TrackerIndexingTree *indexing_tree;
-	GFile *root;
 	guint progress_signal_id;
 	guint error_signal_id;
 	int persistence_fd;
+	gchar *status;
+	gdouble progress;
+	gint remaining;
+} ExtractorWorker;
+
+struct _TrackerExtractWatchdog {
+	GObject parent_class;
+	TrackerSparqlConnection *sparql_conn;
+	TrackerIndexingTree *indexing_tree;
+	GFile *root;
+	ExtractorWorker workers[G_N_ELEMENTS (extractor_groups)];
 };
 
 G_DEFINE_TYPE (TrackerExtractWatchdog, tracker_extract_watchdog, G_TYPE_OBJECT)
 
+static void
+emit_status (TrackerExtractWatchdog *watchdog)
+{
+	const gchar *status = NULL;
+	gdouble progress = 0;
+	gint remaining = 0, n_busy = 0;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (watchdog->workers); i++) {
+		ExtractorWorker *worker = &watchdog->workers[i];
+
+		if (!worker->extract_process)
+			continue;
+		if (g_strcmp0 (worker->status, "Idle") == 0)
+			continue;
+
+		n_busy++;
+
+		/* Started, but did not report status yet */
+		if (!worker->status)
+			continue;
+
+		if (!status)
+			status = worker->status;
+
+		progress += worker->progress;
+		remaining = MAX (remaining, worker->remaining);
+	}
+
+	if (n_busy == 0) {
+		g_signal_emit (watchdog, signals[STATUS], 0, "Idle", 1.0, 0);
+	} else if (status) {
+		g_signal_emit (watchdog, signals[STATUS], 0,
+		               status, progress / n_busy, remaining);
+	}
+}
+
 static void
 on_extract_progress_cb (GDBusConnection *conn,
                         const gchar     *sender_name,
@@ -76,15 +139,20 @@ on_extract_progress_cb (GDBusConnection *conn,
                         GVariant        *parameters,
                         gpointer         user_data)
 {
-	TrackerExtractWatchdog *watchdog = user_data;
+	ExtractorWorker *worker = user_data;
 	const gchar *status;
 	gdouble progress;
 	gint32 remaining;
 
 	g_variant_get (parameters, "(&sdi)",
 	               &status, &progress, &remaining);
-	g_signal_emit (watchdog, signals[STATUS], 0,
-	               status, progress, (gint) remaining);
+
+	g_free (worker->status);
+	worker->status = g_strdup (status);
+	worker->progress = progress;
+	worker->remaining = remaining;
+
+	emit_status (worker->watchdog);
 }
 
 static void
@@ -96,7 +164,7 @@ on_extract_error_cb (GDBusConnection *conn,
                      GVariant        *parameters,
                      gpointer         user_data)
 {
-	TrackerExtractWatchdog *watchdog = user_data;
+	ExtractorWorker *worker = user_data;
 	g_autoptr (GVariant) uri = NULL, message = NULL, extra = NULL, child = NULL;
 	GVariantIter iter;
 	GVariant *value;
@@ -120,7 +188,7 @@ on_extract_error_cb (GDBusConnection *conn,
 	if (g_variant_is_of_type (uri, G_VARIANT_TYPE_STRING) &&
 	    g_variant_is_of_type (message, G_VARIANT_TYPE_STRING) &&
 	    (!extra || g_variant_is_of_type (extra, G_VARIANT_TYPE_STRING))) {
-		g_signal_emit (watchdog, signals[ERROR], 0,
+		g_signal_emit (worker->watchdog, signals[ERROR], 0,
 		               g_variant_get_string (uri, NULL),
 		               g_variant_get_string (message, NULL),
 		               extra ? g_variant_get_string (extra, NULL) : NULL);
@@ -128,29 +196,39 @@ on_extract_error_cb (GDBusConnection *conn,
 }
 
 static void
-clear_process_state (TrackerExtractWatchdog *watchdog)
+clear_process_state (ExtractorWorker *worker)
 {
-	if (watchdog->cancellable)
-		g_cancellable_cancel (watchdog->cancellable);
+	if (worker->cancellable)
+		g_cancellable_cancel (worker->cancellable);
 
-	if (watchdog->conn && watchdog->progress_signal_id) {
-		g_dbus_connection_signal_unsubscribe (watchdog->conn,
-		                                      watchdog->progress_signal_id);
-		watchdog->progress_signal_id = 0;
+	if (worker->conn && worker->progress_signal_id) {
+		g_dbus_connection_signal_unsubscribe (worker->conn,
+		                                      worker->progress_signal_id);
+		worker->progress_signal_id = 0;
 	}
 
-	if (watchdog->conn && watchdog->error_signal_id) {
-		g_dbus_connection_signal_unsubscribe (watchdog->conn,
-		                                      watchdog->error_signal_id);
-		watchdog->error_signal_id = 0;
+	if (worker->conn && worker->error_signal_id) {
+		g_dbus_connection_signal_unsubscribe (worker->conn,
+		                                      worker->error_signal_id);
+		worker->error_signal_id = 0;
 	}
 
-	g_clear_object (&watchdog->cancellable);
-	g_clear_object (&watchdog->extract_process);
-	g_clear_object (&watchdog->files_interface);
-	g_clear_object (&watchdog->endpoint);
-	g_clear_object (&watchdog->launcher);
-	g_clear_object (&watchdog->conn);
+	g_clear_object (&worker->cancellable);
+	g_clear_object (&worker->extract_process);
+	g_clear_object (&worker->files_interface);
+	g_clear_object (&worker->endpoint);
+	g_clear_object (&worker->launcher);
+	g_clear_object (&worker->conn);
+	g_clear_pointer (&worker->status, g_free);
+}
+
+static void
+terminate_worker (ExtractorWorker *worker)
+{
+	if (worker->extract_process) {
+		g_subprocess_send_signal (worker->extract_process, SIGTERM);
+		clear_process_state (worker);
+	}
 }
 
 static void
@@ -158,13 +236,13 @@ indexed_directory_removed_cb (TrackerIndexingTree    *tree,
                               GFile                  *file,
                               TrackerExtractWatchdog *watchdog)
 {
-	/* Terminate extractor process, so it can abandon activity early on
+	guint i;
+
+	/* Terminate extractor processes, so they can abandon activity early on
 	 * pre-unmount.
 	 */
-	if (watchdog->extract_process) {
-		g_subprocess_send_signal (watchdog->extract_process, SIGTERM);
-		clear_process_state (watchdog);
-	}
+	for (i = 0; i < G_N_ELEMENTS (watchdog->workers); i++)
+		terminate_worker (&watchdog->workers[i]);
 }
 
 static void
@@ -182,14 +260,17 @@ static void
 tracker_extract_watchdog_finalize (GObject *object)
 {
 	TrackerExtractWatchdog *watchdog = TRACKER_EXTRACT_WATCHDOG (object);
+	guint i;
 
-	if (watchdog->extract_process)
-		g_subprocess_send_signal (watchdog->extract_process, SIGTERM);
+	for (i = 0; i < G_N_ELEMENTS (watchdog->workers); i++) {
+		ExtractorWorker *worker = &watchdog->workers[i];
 
-	clear_process_state (watchdog);
+		terminate_worker (worker);
+		clear_process_state (worker);
 
-	if (watchdog->persistence_fd)
-		close (watchdog->persistence_fd);
+		if (worker->persistence_fd >= 0)
+			close (worker->persistence_fd);
+	}
 
 	g_signal_handlers_disconnect_by_func (watchdog->indexing_tree,
 	                                      indexed_directory_removed_cb,
@@ -283,8 +364,15 @@ tracker_extract_watchdog_class_init (TrackerExtractWatchdogClass *klass)
 static void
 tracker_extract_watchdog_init (TrackerExtractWatchdog *watchdog)
 {
-	watchdog->cancellable = g_cancellable_new ();
-	watchdog->persistence_fd = -1;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (watchdog->workers); i++) {
+		ExtractorWorker *worker = &watchdog->workers[i];
+
+		worker->watchdog = watchdog;
+		worker->group = &extractor_groups[i];
+		worker->persistence_fd = -1;
+	}
 }
 
 TrackerExtractWatchdog *
@@ -304,20 +392,20 @@ on_new_connection_cb (GObject      *object,
                       GAsyncResult *res,
                       gpointer      user_data)
 {
-	TrackerExtractWatchdog *watchdog = user_data;
+	ExtractorWorker *worker = user_data;
 	g_autoptr (GError) error = NULL;
 
-	watchdog->conn = g_dbus_connection_new_finish (res, &error);
-	if (!watchdog->conn) {
+	worker->conn = g_dbus_connection_new_finish (res, &error);
+	if (!worker->conn) {
 		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			g_warning ("Could not create peer-to-peer D-Bus connection: %s", error->message);
 		return;
 	}
 
 	/* Create an endpoint for this peer-to-peer connection */
-	watchdog->endpoint =
-		TRACKER_ENDPOINT (tracker_endpoint_dbus_new (watchdog->sparql_conn,
-		                                             watchdog->conn,
+	worker->endpoint =
+		TRACKER_ENDPOINT (tracker_endpoint_dbus_new (worker->watchdog->sparql_conn,
+		                                             worker->conn,
 		                                             NULL, NULL,
 		                                             &error));
 	if (error) {
@@ -326,11 +414,11 @@ on_new_connection_cb (GObject      *object,
 	}
 
 	/* Disallow access to further endpoints */
-	tracker_endpoint_set_allowed_services (watchdog->endpoint,
+	tracker_endpoint_set_allowed_services (worker->endpoint,
 	                                       (const gchar *[]) { NULL });
 
-	watchdog->progress_signal_id =
-		g_dbus_connection_signal_subscribe (watchdog->conn,
+	worker->progress_signal_id =
+		g_dbus_connection_signal_subscribe (worker->conn,
 		                                    NULL,
 		                                    "org.freedesktop.Tracker3.Extract",
 		                                    "Progress",
@@ -338,10 +426,10 @@ on_new_connection_cb (GObject      *object,
 		                                    NULL,
 		                                    G_DBUS_SIGNAL_FLAGS_NONE,
 		                                    on_extract_progress_cb,
-		                                    watchdog,
+		                                    worker,
 		                                    NULL);
-	watchdog->error_signal_id =
-		g_dbus_connection_signal_subscribe (watchdog->conn,
+	worker->error_signal_id =
+		g_dbus_connection_signal_subscribe (worker->conn,
 		                                    NULL,
 		                                    "org.freedesktop.Tracker3.Extract",
 		                                    "Error",
@@ -349,21 +437,21 @@ on_new_connection_cb (GObject      *object,
 		                                    NULL,
 		                                    G_DBUS_SIGNAL_FLAGS_NONE,
 		                                    on_extract_error_cb,
-		                                    watchdog,
+		                                    worker,
 		                                    NULL);
 
-	if (watchdog->persistence_fd >= 0) {
-		watchdog->files_interface =
-			tracker_files_interface_new_with_fd (watchdog->conn,
-			                                     watchdog->persistence_fd);
+	if (worker->persistence_fd >= 0) {
+		worker->files_interface =
+			tracker_files_interface_new_with_fd (worker->conn,
+			                                     worker->persistence_fd);
 	} else {
-		watchdog->files_interface =
-			tracker_files_interface_new (watchdog->conn);
-		watchdog->persistence_fd =
-			tracker_files_interface_dup_fd (watchdog->files_interface);
+		worker->files_interface =
+			tracker_files_interface_new (worker->conn);
+		worker->persistence_fd =
+			tracker_files_interface_dup_fd (worker->files_interface);
 	}
 
-	g_dbus_connection_start_message_processing (watchdog->conn);
+	g_dbus_connection_start_message_processing (worker->conn);
 }
 
 static void
@@ -371,20 +459,22 @@ wait_check_async_cb (GObject      *object,
                      GAsyncResult *res,
                      gpointer      user_data)
 {
-	TrackerExtractWatchdog *watchdog = user_data;
+	ExtractorWorker *worker = user_data;
+	TrackerExtractWatchdog *watchdog = worker->watchdog;
 	g_autoptr (GError) error = NULL;
 
-	if (!g_subprocess_wait_check_finish (watchdog->extract_process,
+	if (!g_subprocess_wait_check_finish (G_SUBPROCESS (object),
 	                                     res, &error)) {
 		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
 			return;
 
-		g_warning ("Extractor subprocess died unexpectedly: %s", error->message);
-		clear_process_state (watchdog);
+		g_warning ("Extractor subprocess for %s died unexpectedly: %s",
+		           worker->group->name, error->message);
+		clear_process_state (worker);
 		g_signal_emit (watchdog, signals[LOST], 0);
 	} else {
-		g_signal_emit (watchdog, signals[STATUS], 0, "Idle", 1.0, 0);
-		clear_process_state (watchdog);
+		clear_process_state (worker);
+		emit_status (watchdog);
 	}
 }
 
@@ -425,17 +515,17 @@ extractor_child_setup (gpointer user_data)
 }
 
 static gboolean
-setup_context (TrackerExtractWatchdog  *watchdog,
-               GError                 **error)
+setup_context (ExtractorWorker  *worker,
+               GError         **error)
 {
 	g_autoptr (GSocket) socket = NULL;
 	g_autoptr (GIOStream) stream = NULL;
 	g_autofree gchar *guid = NULL;
 	int fd_pair[2];
 
-	clear_process_state (watchdog);
+	clear_process_state (worker);
 
-	watchdog->cancellable = g_cancellable_new ();
+	worker->cancellable = g_cancellable_new ();
 
 	if (socketpair (AF_LOCAL, SOCK_STREAM, 0, fd_pair)) {
 		g_set_error (error,
@@ -445,15 +535,15 @@ setup_context (TrackerExtractWatchdog  *watchdog,
 		return FALSE;
 	}
 
-	watchdog->launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
-	g_subprocess_launcher_take_fd (watchdog->launcher, fd_pair[1], REMOTE_FD_NUMBER);
-	g_subprocess_launcher_setenv (watchdog->launcher,
+	worker->launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
+	g_subprocess_launcher_take_fd (worker->launcher, fd_pair[1], REMOTE_FD_NUMBER);
+	g_subprocess_launcher_setenv (worker->launcher,
 	                              "GVFS_REMOTE_VOLUME_MONITOR_IGNORE", "1",
 	                              TRUE);
 
-	g_subprocess_launcher_set_child_setup (watchdog->launcher,
+	g_subprocess_launcher_set_child_setup (worker->launcher,
 	                                       extractor_child_setup,
-	                                       get_indexed_folders (watchdog),
+	                                       get_indexed_folders (worker->watchdog),
 	                                       (GDestroyNotify) g_strfreev);
 
 	socket = g_socket_new_from_fd (fd_pair[0], error);
@@ -472,8 +562,8 @@ setup_context (TrackerExtractWatchdog  *watchdog,
 	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER |
 	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_ALLOW_ANONYMOUS |
 	                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_REQUIRE_SAME_USER,
-	                       NULL, watchdog->cancellable,
-	                       on_new_connection_cb, watchdog);
+	                       NULL, worker->cancellable,
+	                       on_new_connection_cb, worker);
 
 	return TRUE;
 }
@@ -492,18 +582,20 @@ on_check_finished (GObject      *object,
 		g_warning ("Could not ask extractor to update: %s", error->message);
 }
 
-void
-tracker_extract_watchdog_ensure_started (TrackerExtractWatchdog *watchdog)
+static void
+ensure_worker_started (ExtractorWorker *worker)
 {
+	TrackerExtractWatchdog *watchdog = worker->watchdog;
 	g_autoptr (GError) error = NULL;
 	g_autofree gchar *current_dir = NULL;
 	g_autoptr (GStrvBuilder) strv_builder = NULL;
 	g_auto (GStrv) arguments = NULL;
 	const gchar *extract_path;
+	guint i;
 
-	if (watchdog->extract_process) {
-		if (watchdog->conn) {
-			g_dbus_connection_call (watchdog->conn,
+	if (worker->extract_process) {
+		if (worker->conn) {
+			g_dbus_connection_call (worker->conn,
 			                        NULL,
 			                        "/org/freedesktop/Tracker3/Extract",
 			                        "org.freedesktop.Tracker3.Extract",
@@ -513,13 +605,13 @@ tracker_extract_watchdog_ensure_started (TrackerExtractWatchdog *watchdog)
 			                        -1,
 			                        NULL,
 			                        on_check_finished,
-			                        watchdog);
+			                        worker);
 		}
 
 		return;
 	}
 
-	if (!setup_context (watchdog, &error)) {
+	if (!setup_context (worker, &error)) {
 		g_critical ("Could not setup context to spawn metadata extractor: %s", error->message);
 		return;
 	}
@@ -544,18 +636,33 @@ tracker_extract_watchdog_ensure_started (TrackerExtractWatchdog *watchdog)
 		                         NULL);
 	}
 
+	for (i = 0; worker->group->graphs[i]; i++) {
+		g_strv_builder_add_many (strv_builder,
+		                         "--graph", worker->group->graphs[i],
+		                         NULL);
+	}
+
 	arguments = g_strv_builder_end (strv_builder);
 
-	watchdog->extract_process =
-		g_subprocess_launcher_spawnv (watchdog->launcher,
+	worker->extract_process =
+		g_subprocess_launcher_spawnv (worker->launcher,
 		                              (const char * const *) arguments,
 		                              &error);
 
-	if (watchdog->extract_process) {
-		g_subprocess_wait_check_async (watchdog->extract_process,
-		                               watchdog->cancellable,
-		                               wait_check_async_cb, watchdog);
+	if (worker->extract_process) {
+		g_subprocess_wait_check_async (worker->extract_process,
+		                               worker->cancellable,
+		                               wait_check_async_cb, worker);
 	} else {
 		g_warning ("Could not launch metadata extractor: %s", error->message);
 	}
 }
+
+void
+tracker_extract_watchdog_ensure_started (TrackerExtractWatchdog *watchdog)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (watchdog->workers); i++)
+		ensure_worker_started (&watchdog->workers[i]);
+}
@@ -27,6 +27,10 @@
 #include "tracker-monitor-glib.h"
 #include "tracker-utils.h"
 
+#ifdef HAVE_NATIVE_CRAWLER
+#include "tracker-directory-reader.h"
+#endif
+
 #include <tinysparql.h>
 
 enum {
@@ -56,6 +60,7 @@ typedef enum
 	TRACKER_ROOT_FLAG_NONE = 0,
 	TRACKER_ROOT_FLAG_IGNORE_ROOT_FILE = 1 << 0,
 	TRACKER_ROOT_FLAG_FULL_CHECK = 1 << 1,
+	TRACKER_ROOT_FLAG_PRIORITY = 1 << 2,
 } TrackerRootFlags;
 
 static guint signals[LAST_SIGNAL] = { 0 };
@@ -68,28 +73,49 @@ enum {
 	FILE_STATE_EXTRACTOR_UPDATE,
 };
 
+/* Allocated from the TrackerIndexRoot file data chunks, and linked
+ * to its queue through the embedded list node.
+ */
 typedef struct {
-	GList *node;
+	GList link;
 	GFile *file;
+	gint64 store_mtime;
+	gint64 disk_mtime;
 	guint in_disk : 1;
 	guint in_store : 1;
 	guint is_dir_in_disk : 1;
 	guint is_dir_in_store : 1;
+	guint extractor_outdated : 1;
 	guint state : 3;
-	GDateTime *store_mtime;
-	GDateTime *disk_mtime;
-	gchar *extractor_hash;
-	gchar *current_hash;
 } TrackerFileData;
 
+typedef struct _TrackerStatBatch TrackerStatBatch;
+
+/* Contents of a directory, as read by the native directory reader */
+typedef struct {
+	GFile *directory;
+	GPtrArray *infos;
+	GError *error;
+	guint pos;
+	guint finished : 1;
+	guint waiting : 1;
+} TrackerDirectoryRead;
+
 typedef struct {
 	TrackerFileNotifier *notifier;
 	TrackerSparqlCursor *cursor;
+	TrackerStatBatch *stat_batch;
 	GFile *root;
 	GFileEnumerator *enumerator;
+	TrackerDirectoryRead *current_read;
+	GHashTable *directory_reads;
 	GCancellable *cancellable;
 	GHashTable *cache;
+	GHashTable *known_files;
 	GQueue queue;
+	GPtrArray *file_data_chunks;
+	GQueue free_file_data;
+	guint file_data_chunk_pos;
 	GQueue deleted_dirs;
 	GFile *current_dir;
 	GQueue *pending_dirs;
@@ -118,7 +144,7 @@ struct _TrackerFileNotifier
 
 	TrackerSparqlStatement *content_query;
 	TrackerSparqlStatement *deleted_query;
-	TrackerSparqlStatement *file_exists_query;
+	TrackerSparqlStatement *folder_children_query;
 
 	/* List of pending directory
 	 * trees to get data from
@@ -126,13 +152,55 @@ struct _TrackerFileNotifier
 	GList *pending_index_roots;
 	TrackerIndexRoot *current_index_root;
 
+	/* Pool of threads querying file info for cursor contents */
+	GThreadPool *stat_pool;
+
+#ifdef HAVE_NATIVE_CRAWLER
+	TrackerDirectoryReader *directory_reader;
+#endif
+
 	guint stopped : 1;
 	guint high_water : 1;
 	guint active : 1;
+	guint crawled : 1;
+	guint emitting_live : 1;
 };
 
 #define N_CURSOR_BATCH_ITEMS 200
 #define N_ENUMERATOR_BATCH_ITEMS 200
+#define N_STAT_JOB_ITEMS 25
+#define MAX_STAT_THREADS 16
+#define MAX_PREFETCHED_DIRS 8
+#define FILE_DATA_CHUNK_SIZE 256
+
+/* Store information about a file, as obtained from the
+ * get-index-root-content.rq cursor.
+ */
+typedef struct {
+	GFile *file;
+	GFileInfo *info;
+	gint64 store_mtime;
+	guint is_dir : 1;
+	guint extractor_outdated : 1;
+} TrackerCursorItem;
+
+/* A batch of cursor items whose filesystem info is queried in
+ * the stat thread pool. Results are handled in cursor order once
+ * all jobs are done.
+ */
+struct _TrackerStatBatch {
+	TrackerIndexRoot *root;
+	GCancellable *cancellable; /* Cancelled when the index root is freed */
+	GMainContext *context;
+	GArray *items;
+	gint n_pending_jobs;
+};
+
+typedef struct {
+	TrackerStatBatch *batch;
+	guint first;
+	guint last;
+} TrackerStatJob;
 
 static gboolean tracker_index_root_query_contents (TrackerIndexRoot *root);
 static gboolean tracker_index_root_crawl_next (TrackerIndexRoot *root);
@@ -141,8 +209,8 @@ static void tracker_index_root_continue (TrackerIndexRoot *root);
 
 static TrackerSparqlStatement * sparql_contents_ensure_statement (TrackerFileNotifier  *notifier,
                                                                   GError              **error);
-static TrackerSparqlStatement * sparql_file_exists_ensure_statement (TrackerFileNotifier  *notifier,
-                                                                     GError              **error);
+static TrackerSparqlStatement * sparql_folder_children_ensure_statement (TrackerFileNotifier  *notifier,
+                                                                         GError              **error);
 
 G_DEFINE_TYPE (TrackerFileNotifier, tracker_file_notifier, G_TYPE_OBJECT)
 
@@ -176,15 +244,53 @@ tracker_file_notifier_set_property (GObject      *object,
 	}
 }
 
+static TrackerFileData *
+tracker_index_root_alloc_file_data (TrackerIndexRoot *root)
+{
+	TrackerFileData *file_data;
+	GList *link;
+
+	link = g_queue_pop_head_link (&root->free_file_data);
+
+	if (link) {
+		file_data = link->data;
+	} else {
+		TrackerFileData *chunk = NULL;
+
+		if (root->file_data_chunks->len > 0 &&
+		    root->file_data_chunk_pos < FILE_DATA_CHUNK_SIZE) {
+			chunk = g_ptr_array_index (root->file_data_chunks,
+			                           root->file_data_chunks->len - 1);
+		} else {
+			chunk = g_new (TrackerFileData, FILE_DATA_CHUNK_SIZE);
+			g_ptr_array_add (root->file_data_chunks, chunk);
+			root->file_data_chunk_pos = 0;
+		}
+
+		file_data = &chunk[root->file_data_chunk_pos++];
+	}
+
+	memset (file_data, 0, sizeof (TrackerFileData));
+	file_data->link.data = file_data;
+
+	return file_data;
+}
+
 static void
-file_data_free (TrackerFileData *file_data)
+tracker_index_root_release_file_data (TrackerIndexRoot *root,
+                                      TrackerFileData  *file_data)
+{
+	/* Drops the file reference too */
+	g_hash_table_remove (root->cache, file_data->file);
+	file_data->file = NULL;
+	g_queue_push_head_link (&root->free_file_data, &file_data->link);
+}
+
+static gint64
+file_info_get_mtime (GFileInfo *info)
 {
-	g_object_unref (file_data->file);
-	g_clear_pointer (&file_data->store_mtime, g_date_time_unref);
-	g_clear_pointer (&file_data->disk_mtime, g_date_time_unref);
-	g_free (file_data->extractor_hash);
-	g_free (file_data->current_hash);
-	g_slice_free (TrackerFileData, file_data);
+	return (g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+	        g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
 }
 
 static TrackerIndexRoot *
@@ -207,14 +313,42 @@ tracker_index_root_new (TrackerFileNotifier   *notifier,
 
 	g_queue_init (&data->deleted_dirs);
 	g_queue_init (&data->queue);
+	g_queue_init (&data->free_file_data);
+	data->file_data_chunks = g_ptr_array_new_with_free_func (g_free);
 	data->cache = g_hash_table_new_full (g_file_hash,
 	                                     (GEqualFunc) g_file_equal,
-	                                     NULL,
-	                                     (GDestroyNotify) file_data_free);
+	                                     g_object_unref,
+	                                     NULL);
+	data->known_files = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                           g_free, NULL);
+	data->directory_reads = g_hash_table_new_full (g_file_hash,
+	                                               (GEqualFunc) g_file_equal,
+	                                               NULL,
+	                                               (GDestroyNotify) directory_read_free);
 
 	return data;
 }
 
+static TrackerDirectoryRead *
+directory_read_new (GFile *directory)
+{
+	TrackerDirectoryRead *read;
+
+	read = g_new0 (TrackerDirectoryRead, 1);
+	read->directory = g_object_ref (directory);
+
+	return read;
+}
+
+static void
+directory_read_free (TrackerDirectoryRead *read)
+{
+	g_object_unref (read->directory);
+	g_clear_pointer (&read->infos, g_ptr_array_unref);
+	g_clear_error (&read->error);
+	g_free (read);
+}
+
 static void
 tracker_index_root_free (TrackerIndexRoot *data)
 {
@@ -231,28 +365,29 @@ tracker_index_root_free (TrackerIndexRoot *data)
 	g_queue_free_full (data->pending_dirs, (GDestroyNotify) g_object_unref);
 	g_queue_free_full (data->pending_finish_dirs, (GDestroyNotify) g_object_unref);
 	g_timer_destroy (data->timer);
-	g_queue_clear (&data->queue);
 	g_queue_clear_full (&data->deleted_dirs, g_object_unref);
+	/* File data is embedded in the chunks, freed all at once */
 	g_hash_table_destroy (data->cache);
+	g_ptr_array_unref (data->file_data_chunks);
+	g_hash_table_destroy (data->known_files);
+	g_hash_table_destroy (data->directory_reads);
+	g_clear_pointer (&data->current_read, directory_read_free);
 	g_clear_object (&data->enumerator);
 	g_clear_object (&data->current_dir);
 	g_clear_object (&data->cursor);
 	g_clear_handle_id (&data->cursor_idle_id, g_source_remove);
+	/* Batch in flight, if any, is freed after the cancellation */
+	if (data->stat_batch)
+		g_cancellable_cancel (data->stat_batch->cancellable);
+	data->stat_batch = NULL;
 	g_clear_object (&data->cancellable);
 	g_object_unref (data->root);
 	g_free (data);
 }
 
 static void
-tracker_index_root_close_folder (TrackerIndexRoot *root)
+tracker_index_root_notify_finished_dirs (TrackerIndexRoot *root)
 {
-	GFile *container;
-
-	g_assert (root->enumerator != NULL);
-	container = g_file_enumerator_get_container (root->enumerator);
-	g_queue_push_head (root->pending_finish_dirs, g_object_ref (container));
-	g_clear_object (&root->enumerator);
-
 	/* Check the folders that can be notified already via
 	 * ::directory-finished, i.e. those that don't have any child
 	 * folder pending crawling.
@@ -277,6 +412,21 @@ tracker_index_root_close_folder (TrackerIndexRoot *root)
 	}
 }
 
+static void
+tracker_index_root_close_folder (TrackerIndexRoot *root)
+{
+	GFile *container;
+
+	g_assert (root->enumerator != NULL || root->current_read != NULL);
+	container = root->current_dir;
+	g_queue_push_head (root->pending_finish_dirs, g_object_ref (container));
+	g_clear_object (&root->enumerator);
+	g_clear_pointer (&root->current_read, directory_read_free);
+	g_hash_table_remove_all (root->known_files);
+
+	tracker_index_root_notify_finished_dirs (root);
+}
+
 static gboolean
 check_file (TrackerFileNotifier *notifier,
             GFile               *file,
@@ -336,6 +486,49 @@ check_directory_contents (TrackerFileNotifier *notifier,
 	return process;
 }
 
+static gboolean
+check_directory_listing (TrackerFileNotifier *notifier,
+                         GFile               *directory,
+                         GPtrArray           *infos)
+{
+	gboolean process = TRUE;
+	guint i;
+
+	/* Same as check_directory_contents(), but looks for the
+	 * files triggering content filters in the directory listing,
+	 * instead of probing the filesystem for them.
+	 */
+	if (tracker_indexing_tree_file_is_root (notifier->indexing_tree, directory))
+		return TRUE;
+
+	for (i = 0; i < infos->len && process; i++) {
+		GFileInfo *info = g_ptr_array_index (infos, i);
+
+		process = !tracker_indexing_tree_basename_matches_filter (notifier->indexing_tree,
+		                                                          TRACKER_FILTER_PARENT_DIRECTORY,
+		                                                          g_file_info_get_name (info));
+	}
+
+	tracker_indexing_tree_set_parent_is_indexable (notifier->indexing_tree,
+	                                               directory, process);
+
+	if (notifier->monitor && !process)
+		tracker_monitor_remove (notifier->monitor, directory);
+
+	return process;
+}
+
+static gboolean
+tracker_index_root_reads_natively (TrackerIndexRoot *root,
+                                   GFile            *directory)
+{
+#ifdef HAVE_NATIVE_CRAWLER
+	return root->notifier->directory_reader && g_file_is_native (directory);
+#else
+	return FALSE;
+#endif
+}
+
 static gboolean
 tracker_file_notifier_notify (TrackerFileNotifier *notifier,
                               TrackerFileData     *file_data,
@@ -384,6 +577,7 @@ notifier_check_next_root (TrackerFileNotifier *notifier)
 		g_clear_pointer (&notifier->current_index_root, tracker_index_root_free);
 	}
 
+	notifier->crawled = TRUE;
 	g_signal_emit (notifier, signals[FINISHED], 0);
 	return FALSE;
 }
@@ -392,10 +586,12 @@ static void
 tracker_index_root_notify_changes (TrackerIndexRoot *root)
 {
 	TrackerFileData *data;
+	GList *link;
 
-	while ((data = g_queue_pop_tail (&root->queue)) != NULL) {
+	while ((link = g_queue_pop_tail_link (&root->queue)) != NULL) {
+		data = link->data;
 		tracker_file_notifier_notify (root->notifier, data, NULL);
-		g_hash_table_remove (root->cache, data->file);
+		tracker_index_root_release_file_data (root, data);
 	}
 }
 
@@ -406,9 +602,9 @@ update_state (TrackerFileData *data)
 
 	if (data->in_disk) {
 		if (data->in_store) {
-			if (!g_date_time_equal (data->store_mtime, data->disk_mtime)) {
+			if (data->store_mtime != data->disk_mtime) {
 				data->state = FILE_STATE_UPDATE;
-			} else if (g_strcmp0 (data->extractor_hash, data->current_hash) != 0) {
+			} else if (data->extractor_outdated) {
 				data->state = FILE_STATE_EXTRACTOR_UPDATE;
 			}
 		} else {
@@ -429,12 +625,10 @@ ensure_file_data (TrackerIndexRoot *root,
 
 	file_data = g_hash_table_lookup (root->cache, file);
 	if (!file_data) {
-		file_data = g_slice_new0 (TrackerFileData);
+		file_data = tracker_index_root_alloc_file_data (root);
 		file_data->file = g_object_ref (file);
 		g_hash_table_insert (root->cache, file_data->file, file_data);
-		file_data->node = g_list_alloc ();
-		file_data->node->data = file_data;
-		g_queue_push_head_link (&root->queue, file_data->node);
+		g_queue_push_head_link (&root->queue, &file_data->link);
 	}
 
 	return file_data;
@@ -444,15 +638,14 @@ static TrackerFileData *
 _insert_disk_info (TrackerIndexRoot *root,
                    GFile            *file,
                    GFileType         file_type,
-                   GDateTime        *datetime)
+                   gint64            mtime)
 {
 	TrackerFileData *file_data;
 
 	file_data = ensure_file_data (root, file);
 	file_data->in_disk = TRUE;
 	file_data->is_dir_in_disk = file_type == G_FILE_TYPE_DIRECTORY;
-	g_clear_pointer (&file_data->disk_mtime, g_date_time_unref);
-	file_data->disk_mtime = g_date_time_ref (datetime);
+	file_data->disk_mtime = mtime;
 	update_state (file_data);
 
 	return file_data;
@@ -462,25 +655,16 @@ static TrackerFileData *
 _insert_store_info (TrackerIndexRoot *root,
                     GFile            *file,
                     GFileType         file_type,
-                    const gchar      *extractor_hash,
-                    const gchar      *mimetype,
-                    GDateTime        *datetime)
+                    gboolean          extractor_outdated,
+                    gint64            mtime)
 {
-	TrackerFileNotifier *notifier = root->notifier;
 	TrackerFileData *file_data;
-	const char *current_hash = NULL;
-
-	if (mimetype) {
-		current_hash = tracker_extract_rules_manager_get_hash (notifier->rules_manager,
-		                                                       mimetype);
-	}
 
 	file_data = ensure_file_data (root, file);
 	file_data->in_store = TRUE;
 	file_data->is_dir_in_store = file_type == G_FILE_TYPE_DIRECTORY;
-	file_data->extractor_hash = g_strdup (extractor_hash);
-	file_data->current_hash = g_strdup (current_hash);
-	file_data->store_mtime = g_date_time_ref (datetime);
+	file_data->extractor_outdated = !!extractor_outdated;
+	file_data->store_mtime = mtime;
 	update_state (file_data);
 
 	return file_data;
@@ -504,22 +688,23 @@ handle_file_from_filesystem (TrackerIndexRoot *root,
 {
 	TrackerFileData *file_data;
 	GFileType file_type;
-	g_autoptr (GDateTime) datetime = NULL;
 
 	file_type = g_file_info_get_file_type (info);
-	datetime = g_file_info_get_modification_date_time (info);
 	file_data = _insert_disk_info (root,
 	                               file,
 	                               file_type,
-	                               datetime);
+	                               file_info_get_mtime (info));
 
 	if (file_type == G_FILE_TYPE_DIRECTORY &&
 	    file_data->state == FILE_STATE_CREATE &&
 	    (root->flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0 &&
 	    !g_file_equal (file, root->current_dir) &&
-	    check_directory_contents (root->notifier, file) &&
-	    !g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT)) {
-		/* Queue child dirs for later processing */
+	    !g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_UNIX_IS_MOUNTPOINT) &&
+	    (tracker_index_root_reads_natively (root, file) ||
+	     check_directory_contents (root->notifier, file))) {
+		/* Queue child dirs for later processing, natively read
+		 * directories check their contents once listed.
+		 */
 		g_queue_push_head (root->pending_dirs, g_object_ref (file));
 	}
 
@@ -529,36 +714,52 @@ handle_file_from_filesystem (TrackerIndexRoot *root,
 		root->files_updated++;
 
 	tracker_file_notifier_notify (root->notifier, file_data, info);
-	g_queue_delete_link (&root->queue, file_data->node);
-	g_hash_table_remove (root->cache, file);
+	g_queue_unlink (&root->queue, &file_data->link);
+	tracker_index_root_release_file_data (root, file_data);
 }
 
 static gboolean
-notifier_query_file_exists (TrackerFileNotifier  *notifier,
-                            GFile                *file)
+tracker_index_root_file_is_known (TrackerIndexRoot *root,
+                                  GFile            *file)
 {
-	TrackerSparqlStatement *stmt;
-	g_autoptr (TrackerSparqlCursor) cursor = NULL;
 	g_autofree char *uri = NULL;
-	gboolean exists;
 
-	stmt = sparql_file_exists_ensure_statement (notifier, NULL);
-	if (!stmt)
+	if (g_hash_table_size (root->known_files) == 0)
 		return FALSE;
 
-	uri = tracker_file_notifier_get_file_resource_uri (notifier, file);
-	tracker_sparql_statement_bind_string (stmt, "file", uri);
-	cursor = tracker_sparql_statement_execute (stmt, NULL, NULL);
+	uri = tracker_file_notifier_get_file_resource_uri (root->notifier, file);
 
-	if (!cursor)
-		return FALSE;
-	if (!tracker_sparql_cursor_next (cursor, NULL, NULL))
+	return g_hash_table_contains (root->known_files, uri);
+}
+
+static gboolean
+tracker_index_root_handle_child (TrackerIndexRoot *root,
+                                 GFile            *file,
+                                 GFileInfo        *info)
+{
+	GFileType file_type;
+
+	/* When a folder is updated, we did already process all
+	 * updated/deleted files in it through the DB cursor loop.
+	 * There is only new files left to be processed. In the case
+	 * of newly indexed folders, all files will be new.
+	 */
+	if (tracker_index_root_file_is_known (root, file))
 		return FALSE;
 
-	exists = tracker_sparql_cursor_get_boolean (cursor, 0);
-	tracker_sparql_cursor_close (cursor);
+	file_type = g_file_info_get_file_type (info);
+	root->files_found++;
+
+	if ((file_type == G_FILE_TYPE_DIRECTORY &&
+	     !check_directory (root->notifier, file, info)) ||
+	    !check_file (root->notifier, file, info)) {
+		root->files_ignored++;
+		return TRUE;
+	}
+
+	handle_file_from_filesystem (root, file, info);
 
-	return exists;
+	return TRUE;
 }
 
 static void
@@ -596,32 +797,12 @@ enumerator_next_files_cb (GObject      *object,
 
 	for (l = infos; l; l = l->next) {
 		GFileInfo *info = l->data;
-		GFileType file_type;
 		g_autoptr (GFile) file = NULL;
 
 		file = g_file_enumerator_get_child (G_FILE_ENUMERATOR (object), info);
 
-		/* When a folder is updated, we did already process all
-		 * updated/deleted files in it through the DB cursor loop.
-		 * There is only new files left to be processed. In the case
-		 * of newly indexed folders, all files will be new.
-		 */
-		if (notifier_query_file_exists (root->notifier, file))
-			continue;
-
-		file_type = g_file_info_get_file_type (info);
-		n_files++;
-
-		root->files_found++;
-
-		if ((file_type == G_FILE_TYPE_DIRECTORY &&
-		     !check_directory (root->notifier, file, info)) ||
-		    !check_file (root->notifier, file, info)) {
-				root->files_ignored++;
-				continue;
-		}
-
-		handle_file_from_filesystem (root, file, info);
+		if (tracker_index_root_handle_child (root, file, info))
+			n_files++;
 	}
 
 	g_list_free_full (infos, g_object_unref);
@@ -636,6 +817,152 @@ enumerator_next_files_cb (GObject      *object,
 	tracker_index_root_continue (root);
 }
 
+static void
+tracker_index_root_handle_directory_read (TrackerIndexRoot *root)
+{
+	TrackerDirectoryRead *read = root->current_read;
+
+	if (read->error) {
+		if (!g_error_matches (read->error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+		    !g_error_matches (read->error, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED)) {
+			g_autofree gchar *uri = NULL;
+
+			uri = g_file_get_uri (read->directory);
+			g_warning ("Got error crawling '%s': %s\n",
+			           uri, read->error->message);
+		}
+
+		/* Same as failed enumerations, folder is not finished */
+		g_clear_pointer (&root->current_read, directory_read_free);
+		tracker_index_root_continue (root);
+		return;
+	}
+
+	if (read->pos == 0 &&
+	    !check_directory_listing (root->notifier, read->directory, read->infos)) {
+		/* Directory contents triggered a content filter, skip
+		 * the folder as if it had not been queued for crawling.
+		 */
+		g_clear_pointer (&root->current_read, directory_read_free);
+		g_hash_table_remove_all (root->known_files);
+		tracker_index_root_notify_finished_dirs (root);
+		tracker_index_root_continue (root);
+		return;
+	}
+
+	while (read->pos < read->infos->len) {
+		guint last = MIN (read->pos + N_ENUMERATOR_BATCH_ITEMS,
+		                  read->infos->len);
+
+		for (; read->pos < last; read->pos++) {
+			GFileInfo *info = g_ptr_array_index (read->infos, read->pos);
+			g_autoptr (GFile) file = NULL;
+
+			file = g_file_get_child (read->directory,
+			                         g_file_info_get_name (info));
+			tracker_index_root_handle_child (root, file, info);
+		}
+
+		if (read->pos < read->infos->len &&
+		    check_high_water (root->notifier))
+			return;
+	}
+
+	tracker_index_root_close_folder (root);
+	tracker_index_root_continue (root);
+}
+
+static gboolean
+tracker_index_root_next_files (TrackerIndexRoot *root)
+{
+	if (root->enumerator) {
+		g_file_enumerator_next_files_async (root->enumerator,
+		                                    N_ENUMERATOR_BATCH_ITEMS,
+		                                    G_PRIORITY_DEFAULT,
+		                                    root->cancellable,
+		                                    enumerator_next_files_cb,
+		                                    root);
+		return TRUE;
+	} else if (root->current_read) {
+		/* Process the directory contents once read */
+		if (root->current_read->finished)
+			tracker_index_root_handle_directory_read (root);
+		else
+			root->current_read->waiting = TRUE;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+query_known_files_cb (GObject      *object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+	TrackerIndexRoot *root;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GError) error = NULL;
+
+	cursor = tracker_sparql_statement_execute_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                                  res, &error);
+
+	if (!cursor) {
+		/* Caller already commanded the way to continue */
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			return;
+
+		g_warning ("Could not query known folder contents: %s\n",
+		           error->message);
+	}
+
+	root = user_data;
+
+	/* The folder was dropped from crawling meanwhile, whoever
+	 * did that already commanded the way to continue.
+	 */
+	if (!root->enumerator && !root->current_read)
+		return;
+
+	while (cursor && tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		g_hash_table_add (root->known_files,
+		                  g_strdup (tracker_sparql_cursor_get_string (cursor, 0, NULL)));
+	}
+
+	if (cursor)
+		tracker_sparql_cursor_close (cursor);
+
+	tracker_index_root_next_files (root);
+}
+
+static void
+tracker_index_root_query_known_files (TrackerIndexRoot *root,
+                                      GFile            *directory)
+{
+	TrackerSparqlStatement *stmt;
+	g_autofree char *uri = NULL;
+
+	g_hash_table_remove_all (root->known_files);
+
+	/* Fetch the folder contents that are already in the store in
+	 * a single query, instead of checking for every enumerated child.
+	 */
+	stmt = sparql_folder_children_ensure_statement (root->notifier, NULL);
+
+	if (!stmt) {
+		tracker_index_root_next_files (root);
+		return;
+	}
+
+	uri = tracker_file_notifier_get_file_resource_uri (root->notifier, directory);
+	tracker_sparql_statement_bind_string (stmt, "parent", uri);
+	tracker_sparql_statement_execute_async (stmt,
+	                                        root->cancellable,
+	                                        query_known_files_cb,
+	                                        root);
+}
+
 static void
 enumerate_children_cb (GObject      *object,
                        GAsyncResult *res,
@@ -667,12 +994,108 @@ enumerate_children_cb (GObject      *object,
 
 	root = user_data;
 	g_set_object (&root->enumerator, enumerator);
-	g_file_enumerator_next_files_async (root->enumerator,
-	                                    N_ENUMERATOR_BATCH_ITEMS,
-	                                    G_PRIORITY_DEFAULT,
-	                                    root->cancellable,
-	                                    enumerator_next_files_cb,
-	                                    root);
+	tracker_index_root_query_known_files (root, G_FILE (object));
+}
+
+#ifdef HAVE_NATIVE_CRAWLER
+static void
+directory_read_cb (GObject      *object,
+                   GAsyncResult *res,
+                   gpointer      user_data)
+{
+	TrackerIndexRoot *root;
+	TrackerDirectoryRead *read;
+	g_autoptr (GPtrArray) infos = NULL;
+	g_autoptr (GError) error = NULL;
+
+	infos = tracker_directory_reader_read_finish (res, &error);
+
+	/* Caller already commanded the way to continue */
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		return;
+
+	root = user_data;
+
+	if (root->current_read &&
+	    g_file_equal (root->current_read->directory, G_FILE (object)))
+		read = root->current_read;
+	else
+		read = g_hash_table_lookup (root->directory_reads, object);
+
+	/* Directory might be gone from the crawling queue */
+	if (!read || read->finished)
+		return;
+
+	read->infos = g_steal_pointer (&infos);
+	read->error = g_steal_pointer (&error);
+	read->finished = TRUE;
+
+	if (read == root->current_read && read->waiting)
+		tracker_index_root_handle_directory_read (root);
+}
+
+static TrackerDirectoryRead *
+tracker_index_root_read_directory (TrackerIndexRoot *root,
+                                   GFile            *directory)
+{
+	TrackerDirectoryRead *read;
+
+	read = g_hash_table_lookup (root->directory_reads, directory);
+	if (read)
+		return read;
+
+	/* Monitor the folder before reading it, so changes
+	 * happening while it is read ahead are not missed.
+	 */
+	if (root->notifier->monitor)
+		tracker_monitor_add (root->notifier->monitor, directory);
+
+	read = directory_read_new (directory);
+	g_hash_table_insert (root->directory_reads, read->directory, read);
+	tracker_directory_reader_read_async (root->notifier->directory_reader,
+	                                     directory,
+	                                     root->cancellable,
+	                                     directory_read_cb,
+	                                     root);
+	return read;
+}
+#endif
+
+static void
+tracker_index_root_enumerate (TrackerIndexRoot *root,
+                              GFile            *directory)
+{
+#ifdef HAVE_NATIVE_CRAWLER
+	if (tracker_index_root_reads_natively (root, directory)) {
+		GList *l;
+
+		root->current_read = tracker_index_root_read_directory (root, directory);
+		g_hash_table_steal (root->directory_reads, directory);
+
+		/* Read ahead the next folders in the crawling queue, so
+		 * they are read in parallel to the current one. Nothing
+		 * is read ahead while the consumer is catching up.
+		 */
+		for (l = root->pending_dirs->head;
+		     l && !root->notifier->high_water &&
+		     g_hash_table_size (root->directory_reads) < MAX_PREFETCHED_DIRS;
+		     l = l->next) {
+			if (g_file_is_native (l->data))
+				tracker_index_root_read_directory (root, l->data);
+		}
+
+		tracker_index_root_query_known_files (root, directory);
+		return;
+	}
+#endif
+
+	g_file_enumerate_children_async (directory,
+	                                 INDEXER_FILE_ATTRIBUTES,
+	                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+	                                 G_PRIORITY_DEFAULT,
+	                                 root->cancellable,
+	                                 enumerate_children_cb,
+	                                 root);
 }
 
 static void
@@ -708,14 +1131,7 @@ query_root_info_cb (GObject      *object,
 
 	root->files_found++;
 	handle_file_from_filesystem (root, G_FILE (object), info);
-
-	g_file_enumerate_children_async (G_FILE (object),
-	                                 INDEXER_FILE_ATTRIBUTES,
-	                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-	                                 G_PRIORITY_DEFAULT,
-	                                 root->cancellable,
-	                                 enumerate_children_cb,
-	                                 root);
+	tracker_index_root_enumerate (root, G_FILE (object));
 }
 
 static gboolean
@@ -754,13 +1170,7 @@ tracker_index_root_crawl_next (TrackerIndexRoot *root)
 		                         query_root_info_cb,
 		                         root);
 	} else {
-		g_file_enumerate_children_async (directory,
-		                                 INDEXER_FILE_ATTRIBUTES,
-		                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-		                                 G_PRIORITY_DEFAULT,
-		                                 root->cancellable,
-		                                 enumerate_children_cb,
-		                                 root);
+		tracker_index_root_enumerate (root, directory);
 	}
 
 	return TRUE;
@@ -769,16 +1179,7 @@ tracker_index_root_crawl_next (TrackerIndexRoot *root)
 static gboolean
 tracker_index_root_continue_current_folder (TrackerIndexRoot *root)
 {
-	if (!root->enumerator)
-		return FALSE;
-
-	g_file_enumerator_next_files_async (root->enumerator,
-	                                    N_ENUMERATOR_BATCH_ITEMS,
-	                                    G_PRIORITY_DEFAULT,
-	                                    root->cancellable,
-	                                    enumerator_next_files_cb,
-	                                    root);
-	return TRUE;
+	return tracker_index_root_next_files (root);
 }
 
 static void
@@ -810,6 +1211,7 @@ tracker_index_root_remove_directory (TrackerIndexRoot *root,
 
 		if (g_file_equal (file, directory) ||
 		    g_file_has_prefix (file, directory)) {
+			g_hash_table_remove (root->directory_reads, file);
 			g_object_unref (file);
 			g_queue_delete_link (root->pending_dirs, l);
 		}
@@ -817,7 +1219,7 @@ tracker_index_root_remove_directory (TrackerIndexRoot *root,
 		l = next;
 	}
 
-	if (root->enumerator && root->current_dir &&
+	if ((root->enumerator || root->current_read) && root->current_dir &&
 	    (g_file_equal (root->current_dir, directory) ||
 	     g_file_has_prefix (root->current_dir, directory))) {
 		/* Cancel enumerator */
@@ -827,8 +1229,13 @@ tracker_index_root_remove_directory (TrackerIndexRoot *root,
 		g_set_object (&root->cancellable, g_cancellable_new ());
 		g_cancellable_cancel (old);
 
+		/* Reads ahead were also cancelled */
+		g_hash_table_remove_all (root->directory_reads);
+
 		g_clear_object (&root->enumerator);
+		g_clear_pointer (&root->current_read, directory_read_free);
 		g_clear_object (&root->current_dir);
+		g_hash_table_remove_all (root->known_files);
 
 		if (!check_high_water (root->notifier))
 			tracker_index_root_continue (root);
@@ -844,15 +1251,15 @@ file_notifier_current_root_check_remove_directory (TrackerFileNotifier *notifier
 }
 
 static TrackerSparqlStatement *
-sparql_file_exists_ensure_statement (TrackerFileNotifier  *notifier,
-                                     GError              **error)
+sparql_folder_children_ensure_statement (TrackerFileNotifier  *notifier,
+                                         GError              **error)
 {
-	if (notifier->file_exists_query)
-		return notifier->file_exists_query;
+	if (notifier->folder_children_query)
+		return notifier->folder_children_query;
 
-	notifier->file_exists_query =
-		tracker_load_statement (notifier->connection, "ask-file-exists.rq", error);
-	return notifier->file_exists_query;
+	notifier->folder_children_query =
+		tracker_load_statement (notifier->connection, "get-folder-children.rq", error);
+	return notifier->folder_children_query;
 }
 
 static TrackerSparqlStatement *
@@ -890,43 +1297,46 @@ file_is_equal_or_descendant (gconstpointer a,
 }
 
 static void
-handle_file_from_cursor (TrackerIndexRoot    *root,
-                         TrackerSparqlCursor *cursor)
+cursor_item_clear (TrackerCursorItem *item)
+{
+	g_clear_object (&item->file);
+	g_clear_object (&item->info);
+}
+
+static void
+stat_batch_free (TrackerStatBatch *batch)
+{
+	g_array_unref (batch->items);
+	g_main_context_unref (batch->context);
+	g_object_unref (batch->cancellable);
+	g_free (batch);
+}
+
+static void
+handle_file_from_cursor (TrackerIndexRoot  *root,
+                         TrackerCursorItem *item)
 {
 	TrackerFileNotifier *notifier;
-	const gchar *folder_urn, *uri;
 	GFileType file_type;
-	g_autoptr (GFile) file = NULL;
-	g_autoptr (GDateTime) store_mtime = NULL;
-	g_autoptr (GFileInfo) info = NULL;
+	GFile *file = item->file;
+	GFileInfo *info = item->info;
 	TrackerFileData *file_data;
 
 	notifier = root->notifier;
-	uri = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-
-	if (notifier->root)
-		file = tracker_file_resolve_relative_uri (notifier->root, uri);
-	else
-		file = g_file_new_for_uri (uri);
 
 	/* If the file is contained in a deleted dir, skip it */
 	if (g_queue_find_custom (&root->deleted_dirs, file,
 	                         file_is_equal_or_descendant))
 		return;
 
-	/* Get stored info */
-	folder_urn = tracker_sparql_cursor_get_string (cursor, 1, NULL);
-	store_mtime = tracker_sparql_cursor_get_datetime (cursor, 2);
-
-	file_type = folder_urn ? G_FILE_TYPE_DIRECTORY : G_FILE_TYPE_UNKNOWN;
+	file_type = item->is_dir ? G_FILE_TYPE_DIRECTORY : G_FILE_TYPE_UNKNOWN;
 	root->files_found++;
 
 	file_data = _insert_store_info (root,
 	                                file,
 	                                file_type,
-	                                tracker_sparql_cursor_get_string (cursor, 3, NULL),
-	                                tracker_sparql_cursor_get_string (cursor, 4, NULL),
-	                                store_mtime);
+	                                item->extractor_outdated,
+	                                item->store_mtime);
 
 	if (notifier->monitor &&
 	    file_type == G_FILE_TYPE_DIRECTORY) {
@@ -934,27 +1344,19 @@ handle_file_from_cursor (TrackerIndexRoot    *root,
 		tracker_monitor_add (notifier->monitor, file);
 	}
 
-	/* Query fs info in place */
-	info = g_file_query_info (file, INDEXER_FILE_ATTRIBUTES,
-	                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-	                          NULL, NULL);
-
 	if (info &&
 	    ((file_type == G_FILE_TYPE_DIRECTORY &&
 	      check_directory_contents (notifier, file) &&
 	      check_directory (notifier, file, info)) ||
 	     (file_type != G_FILE_TYPE_DIRECTORY &&
 	      check_file (notifier, file, info)))) {
-		g_autoptr (GDateTime) disk_mtime = NULL;
 		GFileType file_type;
 
 		file_type = g_file_info_get_file_type (info);
-		disk_mtime = g_file_info_get_modification_date_time (info);
-
 		_insert_disk_info (root,
 		                   file,
 		                   file_type,
-		                   disk_mtime);
+		                   file_info_get_mtime (info));
 	}
 
 	if (file_data->state == FILE_STATE_DELETE &&
@@ -986,8 +1388,183 @@ handle_file_from_cursor (TrackerIndexRoot    *root,
 	}
 
 	tracker_file_notifier_notify (notifier, file_data, info);
-	g_queue_delete_link (&root->queue, file_data->node);
-	g_hash_table_remove (root->cache, file);
+	g_queue_unlink (&root->queue, &file_data->link);
+	tracker_index_root_release_file_data (root, file_data);
+}
+
+static gboolean
+stat_batch_done (TrackerStatBatch *batch)
+{
+	TrackerIndexRoot *root;
+	guint i;
+
+	/* The index root is gone */
+	if (g_cancellable_is_cancelled (batch->cancellable))
+		return G_SOURCE_REMOVE;
+
+	root = batch->root;
+	g_assert (root->stat_batch == batch);
+	root->stat_batch = NULL;
+
+	for (i = 0; i < batch->items->len; i++) {
+		TrackerCursorItem *item;
+
+		item = &g_array_index (batch->items, TrackerCursorItem, i);
+		handle_file_from_cursor (root, item);
+	}
+
+	tracker_index_root_continue (root);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+stat_job_free (TrackerStatJob *job)
+{
+	TrackerStatBatch *batch = job->batch;
+
+	if (g_atomic_int_dec_and_test (&batch->n_pending_jobs)) {
+		/* All jobs in the batch are done, hand the results
+		 * back to the thread owning the index root.
+		 */
+		g_main_context_invoke_full (batch->context,
+		                            G_PRIORITY_DEFAULT,
+		                            (GSourceFunc) stat_batch_done,
+		                            batch,
+		                            (GDestroyNotify) stat_batch_free);
+	}
+
+	g_free (job);
+}
+
+static void
+stat_thread_func (gpointer data,
+                  gpointer user_data)
+{
+	TrackerStatJob *job = data;
+	TrackerStatBatch *batch = job->batch;
+	guint i;
+
+	for (i = job->first; i < job->last; i++) {
+		TrackerCursorItem *item;
+
+		if (g_cancellable_is_cancelled (batch->cancellable))
+			break;
+
+		item = &g_array_index (batch->items, TrackerCursorItem, i);
+		item->info = g_file_query_info (item->file, INDEXER_FILE_ATTRIBUTES,
+		                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+		                                batch->cancellable, NULL);
+	}
+
+	stat_job_free (job);
+}
+
+static GThreadPool *
+notifier_ensure_stat_pool (TrackerFileNotifier *notifier)
+{
+	g_autoptr (GError) error = NULL;
+
+	if (notifier->stat_pool)
+		return notifier->stat_pool;
+
+	notifier->stat_pool =
+		g_thread_pool_new_full (stat_thread_func,
+		                        NULL,
+		                        (GDestroyNotify) stat_job_free,
+		                        CLAMP (g_get_num_processors (), 1, MAX_STAT_THREADS),
+		                        FALSE,
+		                        &error);
+	if (!notifier->stat_pool)
+		g_warning ("Could not create file info thread pool: %s", error->message);
+
+	return notifier->stat_pool;
+}
+
+static void
+tracker_index_root_query_file_infos (TrackerIndexRoot *root,
+                                     GArray           *items)
+{
+	TrackerStatBatch *batch;
+	GThreadPool *pool;
+	guint i, n_jobs;
+
+	batch = g_new0 (TrackerStatBatch, 1);
+	batch->root = root;
+	/* Folders being removed from crawling change root->cancellable,
+	 * the batch is only dropped along with the index root.
+	 */
+	batch->cancellable = g_cancellable_new ();
+	batch->context = g_main_context_ref_thread_default ();
+	batch->items = items;
+	root->stat_batch = batch;
+
+	pool = notifier_ensure_stat_pool (root->notifier);
+
+	if (!pool) {
+		/* Query info in place */
+		for (i = 0; i < items->len; i++) {
+			TrackerCursorItem *item;
+
+			item = &g_array_index (items, TrackerCursorItem, i);
+			item->info = g_file_query_info (item->file, INDEXER_FILE_ATTRIBUTES,
+			                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+			                                NULL, NULL);
+		}
+
+		stat_batch_done (batch);
+		stat_batch_free (batch);
+		return;
+	}
+
+	n_jobs = (items->len + N_STAT_JOB_ITEMS - 1) / N_STAT_JOB_ITEMS;
+	batch->n_pending_jobs = n_jobs;
+
+	for (i = 0; i < n_jobs; i++) {
+		TrackerStatJob *job;
+
+		job = g_new0 (TrackerStatJob, 1);
+		job->batch = batch;
+		job->first = i * N_STAT_JOB_ITEMS;
+		job->last = MIN (job->first + N_STAT_JOB_ITEMS, items->len);
+		g_thread_pool_push (pool, job, NULL);
+	}
+}
+
+static void
+read_cursor_item (TrackerIndexRoot    *root,
+                  TrackerSparqlCursor *cursor,
+                  TrackerCursorItem   *item)
+{
+	TrackerFileNotifier *notifier = root->notifier;
+	const gchar *uri, *extractor_hash, *mimetype, *current_hash = NULL;
+	g_autoptr (GDateTime) store_mtime = NULL;
+
+	uri = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+
+	if (notifier->root)
+		item->file = tracker_file_resolve_relative_uri (notifier->root, uri);
+	else
+		item->file = g_file_new_for_uri (uri);
+
+	/* Get stored info */
+	item->is_dir = tracker_sparql_cursor_get_string (cursor, 1, NULL) != NULL;
+	store_mtime = tracker_sparql_cursor_get_datetime (cursor, 2);
+	extractor_hash = tracker_sparql_cursor_get_string (cursor, 3, NULL);
+	mimetype = tracker_sparql_cursor_get_string (cursor, 4, NULL);
+
+	if (store_mtime) {
+		item->store_mtime = (g_date_time_to_unix (store_mtime) * G_USEC_PER_SEC +
+		                     g_date_time_get_microsecond (store_mtime));
+	}
+
+	/* Compare extractor hashes right away, no need to keep them around */
+	if (mimetype) {
+		current_hash = tracker_extract_rules_manager_get_hash (notifier->rules_manager,
+		                                                       mimetype);
+	}
+
+	item->extractor_outdated = g_strcmp0 (extractor_hash, current_hash) != 0;
 }
 
 static gboolean
@@ -996,15 +1573,26 @@ handle_cursor (TrackerIndexRoot *root)
 	TrackerSparqlCursor *cursor = root->cursor;
 	GCancellable *cancellable = root->cancellable;
 	g_autoptr (GError) error = NULL;
-	gboolean finished = TRUE, stop = TRUE;
+	g_autoptr (GArray) items = NULL;
+	gboolean finished = TRUE;
 	int i;
 
+	root->cursor_idle_id = 0;
+
+	items = g_array_sized_new (FALSE, TRUE, sizeof (TrackerCursorItem),
+	                           N_CURSOR_BATCH_ITEMS);
+	g_array_set_clear_func (items, (GDestroyNotify) cursor_item_clear);
+
 	for (i = 0; i < N_CURSOR_BATCH_ITEMS; i++) {
+		TrackerCursorItem *item;
+
 		finished = !tracker_sparql_cursor_next (cursor, cancellable, &error);
 		if (finished)
 			break;
 
-		handle_file_from_cursor (root, cursor);
+		g_array_set_size (items, items->len + 1);
+		item = &g_array_index (items, TrackerCursorItem, items->len - 1);
+		read_cursor_item (root, cursor, item);
 		root->cursor_has_content = TRUE;
 	}
 
@@ -1026,19 +1614,23 @@ handle_cursor (TrackerIndexRoot *root)
 		g_clear_object (&root->cursor);
 	}
 
-	stop = finished || check_high_water (root->notifier);
-
-	if (stop) {
-		root->cursor_idle_id = 0;
+	if (items->len > 0) {
+		/* Continues after the file infos were obtained */
+		tracker_index_root_query_file_infos (root, g_steal_pointer (&items));
+	} else {
 		tracker_index_root_continue (root);
 	}
 
-	return stop ? G_SOURCE_REMOVE : G_SOURCE_CONTINUE;
+	return G_SOURCE_REMOVE;
 }
 
 static gboolean
 tracker_index_root_continue_cursor (TrackerIndexRoot *root)
 {
+	/* Wait for the current batch to be handled */
+	if (root->stat_batch)
+		return TRUE;
+
 	if (!root->cursor)
 		return FALSE;
 
@@ -1090,6 +1682,9 @@ tracker_index_root_query_contents (TrackerIndexRoot *root)
 
 	g_timer_reset (root->timer);
 
+	/* Directory contents may have changed without us noticing */
+	tracker_indexing_tree_invalidate_parent (notifier->indexing_tree, directory);
+
 	uri = tracker_file_notifier_get_file_resource_uri (notifier, directory);
 	tracker_sparql_statement_bind_string (notifier->content_query, "root", uri);
 
@@ -1109,9 +1704,25 @@ notifier_queue_root (TrackerFileNotifier   *notifier,
                      TrackerRootFlags       root_flags)
 {
 	TrackerIndexRoot *root;
+	GList *l;
 
 	root = tracker_index_root_new (notifier, file, flags, root_flags);
-	notifier->pending_index_roots = g_list_append (notifier->pending_index_roots, root);
+
+	if (root_flags & TRACKER_ROOT_FLAG_PRIORITY) {
+		/* Crawl these before any bulk crawling that is still pending */
+		for (l = notifier->pending_index_roots; l; l = l->next) {
+			TrackerIndexRoot *pending = l->data;
+
+			if ((pending->root_flags & TRACKER_ROOT_FLAG_PRIORITY) == 0)
+				break;
+		}
+
+		notifier->pending_index_roots =
+			g_list_insert_before (notifier->pending_index_roots, l, root);
+	} else {
+		notifier->pending_index_roots =
+			g_list_append (notifier->pending_index_roots, root);
+	}
 
 	if (!notifier->current_index_root && !notifier->stopped)
 		notifier_check_next_root (notifier);
@@ -1135,6 +1746,50 @@ create_shallow_file_info (GFile    *file,
 	return file_info;
 }
 
+static void
+notifier_update_parent_cache (TrackerFileNotifier *notifier,
+                              GFile               *file,
+                              gboolean             is_directory,
+                              gboolean             exists)
+{
+	g_autoptr (GFile) parent = NULL;
+
+	/* Keep the cached directory content checks up to date */
+	if (is_directory)
+		tracker_indexing_tree_invalidate_parent (notifier->indexing_tree, file);
+
+	if (!tracker_indexing_tree_file_matches_filter (notifier->indexing_tree,
+	                                                TRACKER_FILTER_PARENT_DIRECTORY,
+	                                                file))
+		return;
+
+	parent = g_file_get_parent (file);
+	if (!parent)
+		return;
+
+	if (exists) {
+		tracker_indexing_tree_set_parent_is_indexable (notifier->indexing_tree,
+		                                               parent, FALSE);
+	} else {
+		tracker_indexing_tree_invalidate_parent (notifier->indexing_tree,
+		                                         parent);
+	}
+}
+
+static void
+notifier_emit_live (TrackerFileNotifier *notifier,
+                    guint                signal_id,
+                    ...)
+{
+	va_list args;
+
+	notifier->emitting_live = TRUE;
+	va_start (args, signal_id);
+	g_signal_emit_valist (notifier, signal_id, 0, args);
+	va_end (args);
+	notifier->emitting_live = FALSE;
+}
+
 /* Monitor signal handlers */
 static void
 monitor_item_created_cb (TrackerMonitor *monitor,
@@ -1145,12 +1800,14 @@ monitor_item_created_cb (TrackerMonitor *monitor,
 	TrackerFileNotifier *notifier = user_data;
 	gboolean indexable;
 
+	notifier_update_parent_cache (notifier, file, is_directory, TRUE);
+
 	indexable = tracker_indexing_tree_file_is_indexable (notifier->indexing_tree,
 	                                                     file, NULL);
 
 	if (!is_directory) {
 		gboolean parent_indexable;
-		GFile *parent;
+		g_autoptr (GFile) parent = NULL;
 
 		parent = g_file_get_parent (file);
 
@@ -1162,14 +1819,12 @@ monitor_item_created_cb (TrackerMonitor *monitor,
 				/* New file triggered a directory content
 				 * filter, remove parent directory altogether
 				 */
-				g_signal_emit (notifier, signals[FILE_DELETED], 0, parent, TRUE);
+				notifier_emit_live (notifier, signals[FILE_DELETED], parent, TRUE);
 				file_notifier_current_root_check_remove_directory (notifier, parent);
 
 				tracker_monitor_remove_recursively (monitor, parent);
 				return;
 			}
-
-			g_object_unref (parent);
 		}
 
 		if (!indexable)
@@ -1188,7 +1843,8 @@ monitor_item_created_cb (TrackerMonitor *monitor,
 
 		if (flags & TRACKER_DIRECTORY_FLAG_RECURSE) {
 			notifier_queue_root (notifier, file, flags,
-			                     TRACKER_ROOT_FLAG_IGNORE_ROOT_FILE);
+			                     TRACKER_ROOT_FLAG_IGNORE_ROOT_FILE |
+			                     TRACKER_ROOT_FLAG_PRIORITY);
 
 			/* Fall though, we want ::file-created to be emitted
 			 * ASAP so it is ensured to be processed before any
@@ -1197,7 +1853,7 @@ monitor_item_created_cb (TrackerMonitor *monitor,
 		}
 	}
 
-	g_signal_emit (notifier, signals[FILE_CREATED], 0, file, NULL);
+	notifier_emit_live (notifier, signals[FILE_CREATED], file, NULL);
 }
 
 static void
@@ -1214,7 +1870,7 @@ monitor_item_updated_cb (TrackerMonitor *monitor,
 		return;
 	}
 
-	g_signal_emit (notifier, signals[FILE_UPDATED], 0, file, NULL, FALSE);
+	notifier_emit_live (notifier, signals[FILE_UPDATED], file, NULL, FALSE);
 }
 
 static void
@@ -1231,7 +1887,7 @@ monitor_item_attribute_updated_cb (TrackerMonitor *monitor,
 		return;
 	}
 
-	g_signal_emit (notifier, signals[FILE_UPDATED], 0, file, NULL, TRUE);
+	notifier_emit_live (notifier, signals[FILE_UPDATED], file, NULL, TRUE);
 }
 
 static void
@@ -1242,6 +1898,8 @@ monitor_item_deleted_cb (TrackerMonitor *monitor,
 {
 	TrackerFileNotifier *notifier = user_data;
 
+	notifier_update_parent_cache (notifier, file, is_directory, FALSE);
+
 	/* Remove monitors if any */
 	if (is_directory &&
 	    tracker_indexing_tree_file_is_root (notifier->indexing_tree, file)) {
@@ -1286,7 +1944,7 @@ monitor_item_deleted_cb (TrackerMonitor *monitor,
 		return ;
 	}
 
-	g_signal_emit (notifier, signals[FILE_DELETED], 0, file, is_directory);
+	notifier_emit_live (notifier, signals[FILE_DELETED], file, is_directory);
 
 	file_notifier_current_root_check_remove_directory (notifier, file);
 }
@@ -1327,12 +1985,15 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 	notifier = user_data;
 	tracker_indexing_tree_get_root (notifier->indexing_tree, other_file, NULL, &flags);
 
+	notifier_update_parent_cache (notifier, file, is_directory, FALSE);
+	notifier_update_parent_cache (notifier, other_file, is_directory, TRUE);
+
 	if (!is_source_monitored) {
 		if (is_directory) {
 			/* Remove monitors if any */
 			tracker_monitor_remove_recursively (monitor, file);
 			notifier_queue_root (notifier, other_file, flags,
-			                     TRACKER_ROOT_FLAG_NONE);
+			                     TRACKER_ROOT_FLAG_PRIORITY);
 		}
 		/* else, file, do nothing */
 	} else {
@@ -1382,11 +2043,11 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 
 				/* Source file was not stored, check dest file as new */
 				if (!is_directory || !dest_is_recursive) {
-					g_signal_emit (notifier, signals[FILE_UPDATED], 0, other_file, NULL, FALSE);
+					notifier_emit_live (notifier, signals[FILE_UPDATED], other_file, NULL, FALSE);
 				} else if (is_directory) {
 					/* Crawl dest directory */
 					notifier_queue_root (notifier, other_file, flags,
-					                     TRACKER_ROOT_FLAG_NONE);
+					                     TRACKER_ROOT_FLAG_PRIORITY);
 				}
 			}
 			/* Else, do nothing else */
@@ -1396,7 +2057,7 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 				tracker_monitor_remove_recursively (monitor, file);
 			}
 
-			g_signal_emit (notifier, signals[FILE_DELETED], 0, file, is_directory);
+			notifier_emit_live (notifier, signals[FILE_DELETED], file, is_directory);
 			file_notifier_current_root_check_remove_directory (notifier, file);
 		} else {
 			/* Handle move */
@@ -1421,18 +2082,19 @@ monitor_item_moved_cb (TrackerMonitor *monitor,
 				} else if (!source_is_recursive && dest_is_recursive) {
 					/* crawl the folder */
 					notifier_queue_root (notifier, other_file, flags,
-					                     TRACKER_ROOT_FLAG_IGNORE_ROOT_FILE);
+					                     TRACKER_ROOT_FLAG_IGNORE_ROOT_FILE |
+					                     TRACKER_ROOT_FLAG_PRIORITY);
 				}
 			} else {
 				/* This is possibly a file replace operation, delete
 				 * pre-existing file if any. */
-				g_signal_emit (notifier, signals[FILE_DELETED], 0, other_file, is_directory);
+				notifier_emit_live (notifier, signals[FILE_DELETED], other_file, is_directory);
 			}
 
-			g_signal_emit (notifier, signals[FILE_MOVED], 0, file, other_file, is_directory);
+			notifier_emit_live (notifier, signals[FILE_MOVED], file, other_file, is_directory);
 
 			if (extension_changed (file, other_file))
-				g_signal_emit (notifier, signals[FILE_UPDATED], 0, other_file, NULL, FALSE);
+				notifier_emit_live (notifier, signals[FILE_UPDATED], other_file, NULL, FALSE);
 		}
 
 		g_object_unref (other_file);
@@ -1451,6 +2113,8 @@ indexing_tree_directory_added (TrackerIndexingTree *indexing_tree,
 
 	tracker_indexing_tree_get_root (indexing_tree, directory, NULL, &flags);
 	notifier_queue_root (notifier, directory, flags,
+	                     notifier->crawled ?
+	                     TRACKER_ROOT_FLAG_PRIORITY :
 	                     TRACKER_ROOT_FLAG_NONE);
 }
 
@@ -1474,7 +2138,8 @@ indexing_tree_directory_updated (TrackerIndexingTree *indexing_tree,
 
 	tracker_indexing_tree_get_root (indexing_tree, directory, NULL, &flags);
 	notifier_queue_root (notifier, directory, flags,
-	                     TRACKER_ROOT_FLAG_FULL_CHECK);
+	                     TRACKER_ROOT_FLAG_FULL_CHECK |
+	                     (notifier->crawled ? TRACKER_ROOT_FLAG_PRIORITY : 0));
 }
 
 static void
@@ -1555,7 +2220,7 @@ tracker_file_notifier_finalize (GObject *object)
 	g_clear_object (&notifier->root);
 	g_clear_object (&notifier->content_query);
 	g_clear_object (&notifier->deleted_query);
-	g_clear_object (&notifier->file_exists_query);
+	g_clear_object (&notifier->folder_children_query);
 
 	if (notifier->monitor) {
 		g_signal_handlers_disconnect_by_data (notifier->monitor, object);
@@ -1566,9 +2231,16 @@ tracker_file_notifier_finalize (GObject *object)
 
 	g_clear_pointer (&notifier->current_index_root, tracker_index_root_free);
 
+	if (notifier->stat_pool)
+		g_thread_pool_free (notifier->stat_pool, TRUE, TRUE);
+
 	g_list_foreach (notifier->pending_index_roots, (GFunc) tracker_index_root_free, NULL);
 	g_list_free (notifier->pending_index_roots);
 
+#ifdef HAVE_NATIVE_CRAWLER
+	g_clear_pointer (&notifier->directory_reader, tracker_directory_reader_free);
+#endif
+
 	G_OBJECT_CLASS (tracker_file_notifier_parent_class)->finalize (object);
 }
 
@@ -1581,6 +2253,10 @@ tracker_file_notifier_constructed (GObject *object)
 
 	g_assert (notifier->indexing_tree);
 
+#ifdef HAVE_NATIVE_CRAWLER
+	notifier->directory_reader = tracker_directory_reader_new ();
+#endif
+
 	g_signal_connect (notifier->indexing_tree, "directory-added",
 	                  G_CALLBACK (indexing_tree_directory_added), object);
 	g_signal_connect (notifier->indexing_tree, "directory-updated",
@@ -1805,6 +2481,7 @@ tracker_file_notifier_get_status (TrackerFileNotifier        *notifier,
 {
 	if (!notifier->current_index_root ||
 	    (!notifier->current_index_root->cursor &&
+	     !notifier->current_index_root->stat_batch &&
 	     !notifier->current_index_root->current_dir)) {
 		/* Not doing anything in special? */
 		return FALSE;
@@ -1840,3 +2517,24 @@ tracker_file_notifier_get_file_resource_uri (TrackerFileNotifier *notifier,
 	else
 		return g_file_get_uri (file);
 }
+
+/* Returns the priority of the file event currently being emitted:
+ * monitor events come first, then the contents of folders that
+ * appeared or were added to the indexing tree at runtime, and last
+ * the bulk crawling of the configured folders.
+ */
+TrackerFileNotifierPriority
+tracker_file_notifier_get_event_priority (TrackerFileNotifier *notifier)
+{
+	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier),
+	                      TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+
+	if (notifier->emitting_live)
+		return TRACKER_FILE_NOTIFIER_PRIORITY_LIVE;
+
+	if (notifier->current_index_root &&
+	    (notifier->current_index_root->root_flags & TRACKER_ROOT_FLAG_PRIORITY) != 0)
+		return TRACKER_FILE_NOTIFIER_PRIORITY_REQUESTED;
+
+	return TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL;
+}
@@ -43,7 +43,9 @@ G_BEGIN_DECLS
 	G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
 	G_FILE_ATTRIBUTE_TIME_CREATED "," \
 	G_FILE_ATTRIBUTE_TIME_CREATED_USEC "," \
-	G_FILE_ATTRIBUTE_TIME_ACCESS
+	G_FILE_ATTRIBUTE_TIME_ACCESS "," \
+	G_FILE_ATTRIBUTE_ID_FILESYSTEM "," \
+	G_FILE_ATTRIBUTE_UNIX_INODE
 
 #define TRACKER_TYPE_FILE_NOTIFIER (tracker_file_notifier_get_type ())
 G_DECLARE_FINAL_TYPE (TrackerFileNotifier,
@@ -57,6 +59,14 @@ typedef enum
 	TRACKER_FILE_NOTIFIER_STATUS_CHECKING,
 } TrackerFileNotifierStatus;
 
+typedef enum
+{
+	TRACKER_FILE_NOTIFIER_PRIORITY_LIVE,
+	TRACKER_FILE_NOTIFIER_PRIORITY_REQUESTED,
+	TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL,
+	TRACKER_FILE_NOTIFIER_N_PRIORITIES,
+} TrackerFileNotifierPriority;
+
 TrackerFileNotifier * tracker_file_notifier_new (TrackerIndexingTree        *indexing_tree,
                                                  TrackerSparqlConnection    *connection,
                                                  TrackerMonitor             *monitor,
@@ -78,6 +88,8 @@ gboolean tracker_file_notifier_get_status (TrackerFileNotifier        *notifier,
                                            guint                      *files_ignored,
                                            guint                      *files_reindexed);
 
+TrackerFileNotifierPriority tracker_file_notifier_get_event_priority (TrackerFileNotifier *notifier);
+
 char * tracker_file_notifier_get_file_resource_uri (TrackerFileNotifier *notifier,
                                                     GFile               *file);
 
@@ -118,11 +118,15 @@ static GVariant *
 create_extractor_config_variant (TrackerFilesInterface *files_interface)
 {
 	GVariantBuilder builder;
-	g_autoptr (GVariant) max_bytes = NULL;
+	g_autoptr (GVariant) max_bytes = NULL, max_jobs = NULL, prefetch_window = NULL;
 
 	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
 	max_bytes = g_settings_get_value (files_interface->settings, "max-bytes");
 	g_variant_builder_add (&builder, "{sv}", "max-bytes", max_bytes);
+	max_jobs = g_settings_get_value (files_interface->settings, "max-jobs");
+	g_variant_builder_add (&builder, "{sv}", "max-jobs", max_jobs);
+	prefetch_window = g_settings_get_value (files_interface->settings, "prefetch-window");
+	g_variant_builder_add (&builder, "{sv}", "prefetch-window", prefetch_window);
 
 	if (files_interface->priority_graphs)
 		g_variant_builder_add (&builder, "{sv}", "priority-graphs", files_interface->priority_graphs);
@@ -208,6 +212,10 @@ tracker_files_interface_constructed (GObject *object)
 	files_interface->settings = g_settings_new ("org.freedesktop.Tracker3.Extract");
 	g_signal_connect_swapped (files_interface->settings, "changed::max-bytes",
 	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::max-jobs",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
+	g_signal_connect_swapped (files_interface->settings, "changed::prefetch-window",
+	                          G_CALLBACK (tracker_files_interface_emit_changed), object);
 
 #ifdef HAVE_POWER
 	files_interface->power = tracker_power_new ();
@@ -164,7 +164,7 @@ create_empty_information_element (TrackerIndexer *indexer,
 }
 
 static gchar *
-get_content_type (GFile *file)
+query_content_type (GFile *file)
 {
 	g_autoptr (GFileInfo) info = NULL;
 
@@ -179,6 +179,57 @@ get_content_type (GFile *file)
 	return g_strdup (g_file_info_get_content_type (info));
 }
 
+static const gchar *
+get_content_type (GFile     *file,
+                  GFileInfo *info)
+{
+	g_autofree gchar *content_type = NULL;
+
+	if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE))
+		return g_file_info_get_content_type (info);
+
+	/* Resolve the content type the same way GIO does, but using
+	 * the file info we already have. Files are only sniffed if
+	 * the file name is not enough to guess the content type.
+	 */
+	switch (g_file_info_get_file_type (info)) {
+	case G_FILE_TYPE_DIRECTORY:
+		content_type = g_strdup ("inode/directory");
+		break;
+	case G_FILE_TYPE_SYMBOLIC_LINK:
+		content_type = g_strdup ("inode/symlink");
+		break;
+	case G_FILE_TYPE_REGULAR:
+		if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE) &&
+		    g_file_info_get_size (info) == 0) {
+			/* Zero-length files are not sniffed by GIO either */
+			content_type = g_strdup ("application/x-zerosize");
+		} else {
+			g_autofree gchar *basename = NULL;
+			gboolean uncertain;
+
+			basename = g_file_get_basename (file);
+			content_type = g_content_type_guess (basename, NULL, 0, &uncertain);
+
+			if (uncertain)
+				g_clear_pointer (&content_type, g_free);
+		}
+		break;
+	default:
+		break;
+	}
+
+	if (!content_type)
+		content_type = query_content_type (file);
+	if (!content_type)
+		return NULL;
+
+	/* Keep it in the file info for further processing */
+	g_file_info_set_content_type (info, content_type);
+
+	return g_file_info_get_content_type (info);
+}
+
 void
 tracker_indexer_process_file (TrackerIndexer      *indexer,
                               GFile               *file,
@@ -193,11 +244,11 @@ tracker_indexer_process_file (TrackerIndexer      *indexer,
 	const gchar *parent_urn;
 	g_autoptr (GFile) parent = NULL;
 	g_autofree gchar *uri = NULL;
-	g_autofree gchar *mime_type = NULL;
+	const gchar *mime_type;
 	g_autoptr (GDateTime) modified = NULL;
 	g_autoptr (GDateTime) accessed = NULL, created = NULL;
 
-	mime_type = get_content_type (file);
+	mime_type = get_content_type (file, file_info);
 
 	uri = tracker_indexer_get_file_resource_uri (indexer, file);
 
@@ -319,12 +370,12 @@ tracker_indexer_process_file_attributes (TrackerIndexer      *indexer,
 		tracker_indexer_get_extract_rules_manager (indexer);
 	g_autoptr (TrackerResource) resource = NULL, graph_file = NULL;
 	g_autofree gchar *uri = NULL;
-	g_autofree gchar *mime_type = NULL;
+	const gchar *mime_type;
 	const gchar *graph = NULL;
 	g_autoptr (GDateTime) modified = NULL;
 	g_autoptr (GDateTime) accessed = NULL, created = NULL;
 
-	mime_type = get_content_type (file);
+	mime_type = get_content_type (file, info);
 
 	uri = tracker_indexer_get_file_resource_uri (indexer, file);
 	resource = tracker_resource_new (uri);
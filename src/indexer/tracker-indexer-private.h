@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2009, Nokia <ivan.frade@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include "tracker-indexer.h"
+#include "tracker-file-notifier.h"
+
+#ifdef TEST
+/* Event queue access, so tests can check the order in which
+ * queued files would be handled.
+ */
+void tracker_indexer_queue_file (TrackerIndexer              *indexer,
+                                 GFile                       *file,
+                                 gboolean                     update,
+                                 TrackerFileNotifierPriority  priority);
+
+GFile * tracker_indexer_pop_next_file (TrackerIndexer *indexer);
+#endif /* TEST */
@@ -24,6 +24,7 @@
 #include "tracker-error-report.h"
 #include "tracker-extract-watchdog.h"
 #include "tracker-indexer.h"
+#include "tracker-indexer-private.h"
 #include "tracker-indexer-methods.h"
 #include "tracker-monitor.h"
 #include "tracker-utils.h"
@@ -31,8 +32,16 @@
 #include "tracker-file-notifier.h"
 #include "tracker-lru.h"
 
+/* Initial number of tasks per SPARQL batch, the buffer adapts
+ * it to commit latency.
+ */
 #define BUFFER_POOL_LIMIT 800
-#define DEFAULT_URN_LRU_SIZE 100
+/* Number of SPARQL batches that may be executed while the
+ * next one is being built.
+ */
+#define BUFFER_MAX_BATCHES 2
+/* Memory budget for the folder URN cache */
+#define URN_CACHE_BUDGET (2 * 1024 * 1024)
 
 /* Put tasks processing at a lower priority so other events
  * (timeouts, monitor events, etc...) are guaranteed to be
@@ -46,26 +55,40 @@
 
 #define RETRY_AFTER_DISK_FULL (60 * 15)
 
+/* Freed events kept around for reuse */
+#define MAX_POOLED_EVENTS 1024
+
+/* Number of events handled from each lane in a round */
+static const guint lane_weights[] = { 8, 4, 1 };
+G_STATIC_ASSERT (G_N_ELEMENTS (lane_weights) == TRACKER_FILE_NOTIFIER_N_PRIORITIES);
+
 typedef struct {
-	guint16 type;
+	guint type : 3;
 	guint attributes_update : 1;
 	guint is_dir : 1;
+	guint lane : 2;
+	guint64 seq;
 	GFile *file;
 	GFile *dest_file;
 	GFileInfo *info;
-	GList *queue_node;
+	GTreeNode *tree_node;
+	/* Links in the lane queue and in the tree node queue */
+	GList queue_link;
+	GList tree_link;
 } QueueEvent;
 
-typedef struct {
-	TrackerIndexer *indexer;
-	GFile *prefix;
-} QueueForeachData;
-
 struct _TrackerIndexer {
 	TrackerMiner parent_instance;
 
-	GQueue *items;
+	/* Pending events, one queue per TrackerFileNotifierPriority */
+	GQueue *lanes[TRACKER_FILE_NOTIFIER_N_PRIORITIES];
+	guint current_lane;
+	guint lane_credit;
+	guint64 next_seq;
+	GQueue event_pool;
 	GHashTable *items_by_file;
+	/* URI -> GQueue of QueueEvents, sorted so folder contents are contiguous */
+	GTree *items_tree;
 
 	TrackerMonitor *monitor;
 	TrackerIndexingTree *indexing_tree;
@@ -98,8 +121,9 @@ struct _TrackerIndexer {
 	guint active : 1;
 	guint extract_content : 1;
 	guint is_paused : 1;        /* TRUE if miner is paused */
-	guint flushing : 1;         /* TRUE if flushing SPARQL */
 	guint cleanup_audio_pending : 1;
+	guint unextracted_queue_checked : 1;
+	guint queueing_unextracted : 1;
 
 	guint status_idle_id;
 	guint resume_after_disk_full_id;
@@ -272,23 +296,62 @@ tracker_indexer_class_init (TrackerIndexerClass *klass)
 		              G_TYPE_NONE, 0);
 }
 
+static gsize
+urn_cache_cost (gpointer elem,
+                gpointer data)
+{
+	const char *path;
+
+	/* Approximate memory used by an element, including the GFile,
+	 * the hash table and LRU bookkeeping.
+	 */
+	path = g_file_peek_path (elem);
+
+	return 128 + strlen (data) + (path ? strlen (path) : 0);
+}
+
 static void
 tracker_indexer_init (TrackerIndexer *indexer)
 {
-	indexer->items = g_queue_new ();
+	guint i;
+
+	for (i = 0; i < TRACKER_FILE_NOTIFIER_N_PRIORITIES; i++)
+		indexer->lanes[i] = g_queue_new ();
+
+	indexer->lane_credit = lane_weights[0];
 	indexer->items_by_file = g_hash_table_new_full (g_file_hash,
 	                                                (GEqualFunc) g_file_equal,
 	                                                g_object_unref, NULL);
+	indexer->items_tree = g_tree_new_full (tracker_uri_compare, NULL,
+	                                       g_free, g_free);
+
+	indexer->urn_lru = tracker_lru_new_full (URN_CACHE_BUDGET,
+	                                         urn_cache_cost,
+	                                         g_file_hash,
+	                                         (GEqualFunc) g_file_equal,
+	                                         g_object_unref,
+	                                         g_free);
+}
+
+static QueueEvent *
+queue_event_alloc (TrackerIndexer *indexer)
+{
+	QueueEvent *event;
+	GList *link;
+
+	link = g_queue_pop_head_link (&indexer->event_pool);
+	event = link ? link->data : g_new (QueueEvent, 1);
+
+	memset (event, 0, sizeof (QueueEvent));
+	event->queue_link.data = event;
+	event->tree_link.data = event;
 
-	indexer->urn_lru = tracker_lru_new (DEFAULT_URN_LRU_SIZE,
-	                                    g_file_hash,
-	                                    (GEqualFunc) g_file_equal,
-	                                    g_object_unref,
-	                                    g_free);
+	return event;
 }
 
 static QueueEvent *
-queue_event_new (TrackerIndexerEventType  type,
+queue_event_new (TrackerIndexer          *indexer,
+                 TrackerIndexerEventType  type,
                  GFile                   *file,
                  GFileInfo               *info)
 {
@@ -296,7 +359,7 @@ queue_event_new (TrackerIndexerEventType  type,
 
 	g_assert (type != TRACKER_INDEXER_EVENT_MOVED);
 
-	event = g_new0 (QueueEvent, 1);
+	event = queue_event_alloc (indexer);
 	event->type = type;
 	g_set_object (&event->file, file);
 	g_set_object (&event->info, info);
@@ -305,13 +368,14 @@ queue_event_new (TrackerIndexerEventType  type,
 }
 
 static QueueEvent *
-queue_event_moved_new (GFile    *source,
-                       GFile    *dest,
-                       gboolean  is_dir)
+queue_event_moved_new (TrackerIndexer *indexer,
+                       GFile          *source,
+                       GFile          *dest,
+                       gboolean        is_dir)
 {
 	QueueEvent *event;
 
-	event = g_new0 (QueueEvent, 1);
+	event = queue_event_alloc (indexer);
 	event->type = TRACKER_INDEXER_EVENT_MOVED;
 	event->is_dir = !!is_dir;
 	g_set_object (&event->dest_file, dest);
@@ -321,16 +385,22 @@ queue_event_moved_new (GFile    *source,
 }
 
 static void
-queue_event_free (QueueEvent *event)
+queue_event_free (TrackerIndexer *indexer,
+                  QueueEvent     *event)
 {
 	g_clear_object (&event->dest_file);
 	g_clear_object (&event->file);
 	g_clear_object (&event->info);
-	g_free (event);
+
+	if (g_queue_get_length (&indexer->event_pool) < MAX_POOLED_EVENTS)
+		g_queue_push_head_link (&indexer->event_pool, &event->queue_link);
+	else
+		g_free (event);
 }
 
 static QueueCoalesceAction
-queue_event_coalesce (const QueueEvent  *first,
+queue_event_coalesce (TrackerIndexer    *indexer,
+                      const QueueEvent  *first,
 		      const QueueEvent  *second,
 		      QueueEvent       **replacement)
 {
@@ -345,7 +415,8 @@ queue_event_coalesce (const QueueEvent  *first,
 		     !second->attributes_update)) {
 			return QUEUE_ACTION_DELETE_FIRST;
 		} else if (second->type == TRACKER_INDEXER_EVENT_MOVED) {
-			*replacement = queue_event_new (TRACKER_INDEXER_EVENT_CREATED,
+			*replacement = queue_event_new (indexer,
+			                                TRACKER_INDEXER_EVENT_CREATED,
 			                                second->dest_file,
 			                                NULL);
 			return (QUEUE_ACTION_DELETE_FIRST |
@@ -368,7 +439,8 @@ queue_event_coalesce (const QueueEvent  *first,
 	} else if (first->type == TRACKER_INDEXER_EVENT_MOVED) {
 		if (second->type == TRACKER_INDEXER_EVENT_MOVED) {
 			if (first->file != second->dest_file) {
-				*replacement = queue_event_moved_new (first->file,
+				*replacement = queue_event_moved_new (indexer,
+				                                      first->file,
 				                                      second->dest_file,
 				                                      first->is_dir);
 			}
@@ -376,7 +448,8 @@ queue_event_coalesce (const QueueEvent  *first,
 			return (QUEUE_ACTION_DELETE_FIRST |
 				QUEUE_ACTION_DELETE_SECOND);
 		} else if (second->type == TRACKER_INDEXER_EVENT_DELETED) {
-			*replacement = queue_event_new (TRACKER_INDEXER_EVENT_DELETED,
+			*replacement = queue_event_new (indexer,
+			                                TRACKER_INDEXER_EVENT_DELETED,
 			                                first->file,
 			                                NULL);
 			return (QUEUE_ACTION_DELETE_FIRST |
@@ -391,17 +464,239 @@ queue_event_coalesce (const QueueEvent  *first,
 }
 
 static void
-delete_nested_queued_events (QueueEvent       *event,
-                             QueueForeachData *foreach_data)
-{
-	if (g_file_equal (event->file, foreach_data->prefix) ||
-	    g_file_has_prefix (event->file, foreach_data->prefix)) {
-		g_queue_delete_link (foreach_data->indexer->items,
-		                     event->queue_node);
-		queue_event_free (event);
+queue_event_link (TrackerIndexer *indexer,
+                  QueueEvent     *event)
+{
+	g_autofree gchar *uri = NULL;
+	GTreeNode *node;
+	GQueue *queue;
+
+	event->seq = indexer->next_seq++;
+	g_queue_push_tail_link (indexer->lanes[event->lane], &event->queue_link);
+
+	uri = g_file_get_uri (event->file);
+	node = g_tree_lookup_node (indexer->items_tree, uri);
+
+	if (!node) {
+		node = g_tree_insert_node (indexer->items_tree,
+		                           g_steal_pointer (&uri),
+		                           g_new0 (GQueue, 1));
+	}
+
+	queue = g_tree_node_value (node);
+	g_queue_push_tail_link (queue, &event->tree_link);
+	event->tree_node = node;
+}
+
+static void
+queue_event_unlink (TrackerIndexer *indexer,
+                    QueueEvent     *event)
+{
+	GQueue *queue;
+
+	g_queue_unlink (indexer->lanes[event->lane], &event->queue_link);
+
+	queue = g_tree_node_value (event->tree_node);
+	g_queue_unlink (queue, &event->tree_link);
+
+	if (g_queue_is_empty (queue)) {
+		g_tree_remove (indexer->items_tree,
+		               g_tree_node_key (event->tree_node));
+	}
+
+	event->tree_node = NULL;
+}
+
+static void
+queue_remove_subtree (TrackerIndexer *indexer,
+                      GFile          *prefix)
+{
+	g_autofree gchar *uri = NULL;
+	GTreeNode *node;
+	gsize len;
+
+	uri = g_file_get_uri (prefix);
+	len = strlen (uri);
+
+	/* The folder and its contents are a contiguous range in
+	 * the tree, remove all events from there.
+	 */
+	while ((node = g_tree_lower_bound (indexer->items_tree, uri)) != NULL &&
+	       tracker_uri_is_nested (g_tree_node_key (node), uri, len)) {
+		GQueue *queue = g_tree_node_value (node);
+		GList *link;
+
+		while ((link = g_queue_pop_head_link (queue)) != NULL) {
+			QueueEvent *event = link->data;
+
+			if (g_hash_table_lookup (indexer->items_by_file, event->file) == event)
+				g_hash_table_remove (indexer->items_by_file, event->file);
+
+			g_queue_unlink (indexer->lanes[event->lane], &event->queue_link);
+			queue_event_free (indexer, event);
+		}
+
+		g_tree_remove (indexer->items_tree, g_tree_node_key (node));
+	}
+}
+
+static void
+queue_forget_subtree (TrackerIndexer *indexer,
+                      GFile          *prefix)
+{
+	g_autofree gchar *uri = NULL;
+	GTreeNode *node;
+	gsize len;
+
+	uri = g_file_get_uri (prefix);
+	len = strlen (uri);
+
+	/* Keep the events queued, but don't coalesce with them anymore */
+	for (node = g_tree_lower_bound (indexer->items_tree, uri);
+	     node && tracker_uri_is_nested (g_tree_node_key (node), uri, len);
+	     node = g_tree_node_next (node)) {
+		GQueue *queue = g_tree_node_value (node);
+		GList *l;
+
+		for (l = queue->head; l; l = l->next) {
+			QueueEvent *event = l->data;
+
+			if (g_hash_table_lookup (indexer->items_by_file, event->file) == event)
+				g_hash_table_remove (indexer->items_by_file, event->file);
+		}
 	}
 }
 
+static void
+queue_event_promote (TrackerIndexer *indexer,
+                     QueueEvent     *event,
+                     guint           lane)
+{
+	/* The event keeps its sequence number, so it is still
+	 * ordered after older events it depends on.
+	 */
+	g_queue_unlink (indexer->lanes[event->lane], &event->queue_link);
+	event->lane = lane;
+	g_queue_push_tail_link (indexer->lanes[event->lane], &event->queue_link);
+}
+
+static QueueEvent *
+find_oldest_in_ancestors (TrackerIndexer *indexer,
+                          const gchar    *uri,
+                          QueueEvent     *oldest)
+{
+	g_autofree gchar *str = NULL;
+	gchar *sep;
+
+	str = g_strdup (uri);
+
+	do {
+		GQueue *queue;
+		QueueEvent *head;
+
+		queue = g_tree_lookup (indexer->items_tree, str);
+		head = queue ? g_queue_peek_head (queue) : NULL;
+
+		if (head && head->seq < oldest->seq)
+			oldest = head;
+
+		sep = strrchr (str, '/');
+		if (sep)
+			*sep = '\0';
+	} while (sep);
+
+	return oldest;
+}
+
+static QueueEvent *
+find_oldest_in_subtree (TrackerIndexer *indexer,
+                        const gchar    *uri,
+                        QueueEvent     *oldest)
+{
+	GTreeNode *node;
+	gsize len;
+
+	len = strlen (uri);
+
+	for (node = g_tree_lower_bound (indexer->items_tree, uri);
+	     node && tracker_uri_is_nested (g_tree_node_key (node), uri, len);
+	     node = g_tree_node_next (node)) {
+		QueueEvent *head = g_queue_peek_head (g_tree_node_value (node));
+
+		if (head->seq < oldest->seq)
+			oldest = head;
+	}
+
+	return oldest;
+}
+
+static QueueEvent *
+queue_event_resolve_dependencies (TrackerIndexer *indexer,
+                                  QueueEvent     *event)
+{
+	QueueEvent *oldest;
+
+	/* An event may depend on older events on the same file, on its
+	 * parent folders, or on the contents of a moved folder, these
+	 * may be waiting in a lower priority lane. Handle the oldest of
+	 * those first.
+	 */
+	while (TRUE) {
+		const gchar *uri = g_tree_node_key (event->tree_node);
+
+		oldest = find_oldest_in_ancestors (indexer, uri, event);
+
+		if (event->type == TRACKER_INDEXER_EVENT_MOVED) {
+			g_autofree gchar *dest_uri = NULL;
+
+			dest_uri = g_file_get_uri (event->dest_file);
+			oldest = find_oldest_in_ancestors (indexer, dest_uri, oldest);
+
+			if (event->is_dir)
+				oldest = find_oldest_in_subtree (indexer, uri, oldest);
+		}
+
+		if (oldest == event)
+			return event;
+
+		event = oldest;
+	}
+}
+
+static QueueEvent *
+queue_peek_next_event (TrackerIndexer *indexer)
+{
+	guint i;
+
+	/* Weighted round robin between the lanes that have events */
+	for (i = 0; i <= TRACKER_FILE_NOTIFIER_N_PRIORITIES; i++) {
+		GQueue *lane = indexer->lanes[indexer->current_lane];
+
+		if (indexer->lane_credit > 0 && !g_queue_is_empty (lane)) {
+			indexer->lane_credit--;
+			return queue_event_resolve_dependencies (indexer,
+			                                         g_queue_peek_head (lane));
+		}
+
+		indexer->current_lane = (indexer->current_lane + 1) %
+			TRACKER_FILE_NOTIFIER_N_PRIORITIES;
+		indexer->lane_credit = lane_weights[indexer->current_lane];
+	}
+
+	return NULL;
+}
+
+static guint
+queue_get_length (TrackerIndexer *indexer)
+{
+	guint i, length = 0;
+
+	for (i = 0; i < TRACKER_FILE_NOTIFIER_N_PRIORITIES; i++)
+		length += g_queue_get_length (indexer->lanes[i]);
+
+	return length;
+}
+
 static void
 set_up_mount_point (TrackerIndexer *indexer,
                     GFile          *mount_point,
@@ -688,6 +983,8 @@ static void
 fs_finalize (GObject *object)
 {
 	TrackerIndexer *indexer = TRACKER_INDEXER (object);
+	GList *link;
+	guint i;
 
 	g_clear_handle_id (&indexer->status_idle_id, g_source_remove);
 
@@ -700,9 +997,17 @@ fs_finalize (GObject *object)
 
 	g_clear_object (&indexer->sparql_buffer);
 	g_hash_table_unref (indexer->items_by_file);
+	g_tree_unref (indexer->items_tree);
+
+	for (i = 0; i < TRACKER_FILE_NOTIFIER_N_PRIORITIES; i++) {
+		while ((link = g_queue_pop_head_link (indexer->lanes[i])) != NULL)
+			queue_event_free (indexer, link->data);
+
+		g_queue_free (indexer->lanes[i]);
+	}
 
-	g_queue_free_full (indexer->items,
-	                   (GDestroyNotify) queue_event_free);
+	while ((link = g_queue_pop_head_link (&indexer->event_pool)) != NULL)
+		g_free (link->data);
 
 	g_clear_object (&indexer->ask_unextracted);
 	g_clear_object (&indexer->indexing_tree);
@@ -735,6 +1040,7 @@ fs_constructed (GObject *object)
 
 	indexer->sparql_buffer = tracker_sparql_buffer_new (tracker_miner_get_connection (TRACKER_MINER (object)),
 	                                                    BUFFER_POOL_LIMIT,
+	                                                    BUFFER_MAX_BATCHES,
 	                                                    indexer->root);
 
 	indexer->rules_manager = tracker_extract_rules_manager_new (&error);
@@ -879,10 +1185,69 @@ miner_resumed (TrackerMiner *miner)
 	 * processed.
 	 */
 	if (tracker_file_notifier_is_active (indexer->file_notifier) ||
-	    !g_queue_is_empty (indexer->items))
+	    queue_get_length (indexer) > 0)
 		queue_handler_maybe_set_up (indexer);
 }
 
+static void
+queue_unextracted_cb (GObject      *object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+	TrackerIndexer *indexer = user_data;
+	g_autoptr (GError) error = NULL;
+
+	if (!tracker_sparql_statement_update_finish (TRACKER_SPARQL_STATEMENT (object),
+	                                             result, &error))
+		g_warning ("Could not queue unextracted files: %s", error->message);
+
+	indexer->queueing_unextracted = FALSE;
+
+	/* Get back to process_stop() */
+	queue_handler_maybe_set_up (indexer);
+	g_object_unref (indexer);
+}
+
+static gboolean
+maybe_queue_unextracted (TrackerIndexer *indexer)
+{
+	TrackerSparqlConnection *conn;
+	g_autoptr (TrackerSparqlStatement) ask = NULL, stmt = NULL;
+	g_autoptr (TrackerSparqlCursor) cursor = NULL;
+	g_autoptr (GError) error = NULL;
+
+	conn = tracker_miner_get_connection (TRACKER_MINER (indexer));
+	indexer->unextracted_queue_checked = TRUE;
+
+	/* Files indexed by older versions may be pending extraction
+	 * without being in the extraction queue, add those once. This
+	 * goes through all files, so it is only done if the queue was
+	 * not marked as complete yet.
+	 */
+	ask = tracker_load_statement (conn, "ask-unextracted-queued.rq", &error);
+
+	if (ask)
+		cursor = tracker_sparql_statement_execute (ask, NULL, &error);
+
+	if (cursor && tracker_sparql_cursor_next (cursor, NULL, &error) &&
+	    tracker_sparql_cursor_get_boolean (cursor, 0))
+		return FALSE;
+
+	if (!error)
+		stmt = tracker_load_statement (conn, "queue-unextracted.rq", &error);
+
+	if (error) {
+		g_warning ("Could not queue unextracted files: %s", error->message);
+		return FALSE;
+	}
+
+	indexer->queueing_unextracted = TRUE;
+	tracker_sparql_statement_update_async (stmt, NULL,
+	                                       queue_unextracted_cb,
+	                                       g_object_ref (indexer));
+	return TRUE;
+}
+
 static void
 process_stop (TrackerIndexer *indexer)
 {
@@ -894,6 +1259,15 @@ process_stop (TrackerIndexer *indexer)
 
 	g_clear_handle_id (&indexer->status_idle_id, g_source_remove);
 
+	if (indexer->queueing_unextracted)
+		return;
+
+	tracker_sparql_buffer_log_statistics (indexer->sparql_buffer);
+
+	if (!indexer->unextracted_queue_checked && indexer->extract_content &&
+	    maybe_queue_unextracted (indexer))
+		return;
+
 	if (!indexer->ask_unextracted && indexer->extract_content)
 		indexer->ask_unextracted = tracker_load_statement (conn, "ask-unextracted.rq", &error);
 
@@ -920,7 +1294,8 @@ check_notifier_high_water (TrackerIndexer *indexer)
 	/* If there is more than worth 2 batches left processing, we can tell
 	 * the notifier to stop a bit.
 	 */
-	high_water = (g_queue_get_length (indexer->items) > 2 * BUFFER_POOL_LIMIT);
+	high_water = (queue_get_length (indexer) >
+	              2 * tracker_sparql_buffer_get_limit (indexer->sparql_buffer));
 	tracker_file_notifier_set_high_water (indexer->file_notifier, high_water);
 }
 
@@ -955,8 +1330,6 @@ sparql_buffer_flush_cb (GObject      *object,
 		g_assert_not_reached ();
 	}
 
-	indexer->flushing = FALSE;
-
 	if (tracker_sparql_buffer_limit_reached (buffer)) {
 		if (indexer->cleanup_audio_pending) {
 			indexer->cleanup_audio_pending = FALSE;
@@ -964,11 +1337,10 @@ sparql_buffer_flush_cb (GObject      *object,
 			                                   TRACKER_SPARQL_BUFFER_CLEANUP_AUDIO);
 		}
 
-		if (tracker_sparql_buffer_flush (buffer,
-		                                 "SPARQL buffer again full after flush",
-		                                 sparql_buffer_flush_cb,
-		                                 indexer))
-			indexer->flushing = TRUE;
+		tracker_sparql_buffer_flush (buffer,
+		                             "SPARQL buffer again full after flush",
+		                             sparql_buffer_flush_cb,
+		                             indexer);
 	}
 
 	queue_handler_maybe_set_up (indexer);
@@ -997,6 +1369,24 @@ item_add_or_update (TrackerIndexer *indexer,
 		tracker_lru_remove (indexer->urn_lru, event->file);
 	}
 
+	/* Folders are processed before their contents, cache their URN
+	 * from the crawled file info so children don't need to query it.
+	 * Same as tracker_indexer_get_content_uri(), only indexable
+	 * folders are cached.
+	 */
+	if (!event->attributes_update &&
+	    g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY &&
+	    g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_INODE) &&
+	    !tracker_lru_find (indexer->urn_lru, event->file, NULL) &&
+	    tracker_indexing_tree_file_is_indexable (indexer->indexing_tree,
+	                                             event->file, info)) {
+		tracker_lru_add (indexer->urn_lru,
+		                 g_object_ref (event->file),
+		                 tracker_indexer_get_content_identifier (indexer,
+		                                                         event->file,
+		                                                         info));
+	}
+
 	if (!event->attributes_update && indexer->error_reports) {
 		/* Delete any pre-existing error report if the file is being re-indexed */
 		tracker_error_report_delete (indexer->error_reports,
@@ -1132,29 +1522,17 @@ maybe_remove_file_event_node (TrackerIndexer *indexer,
 	return FALSE;
 }
 
-static gboolean
-remove_items_by_file_foreach (gpointer key,
-                              gpointer value,
-                              gpointer user_data)
-{
-	GFile *file = key;
-	GFile *prefix = user_data;
-
-	return (g_file_equal (file, prefix) ||
-	        g_file_has_prefix (file, prefix));
-}
-
 static gboolean
 miner_handle_next_item (TrackerIndexer *indexer)
 {
 	gboolean keep_processing = TRUE;
 	QueueEvent *event;
 
-	event = g_queue_pop_head (indexer->items);
+	event = queue_peek_next_event (indexer);
 
 	if (!event) {
 		if (!tracker_file_notifier_is_active (indexer->file_notifier)) {
-			if (!indexer->flushing &&
+			if (tracker_sparql_buffer_get_n_flushing (indexer->sparql_buffer) == 0 &&
 			    tracker_sparql_buffer_get_size (indexer->sparql_buffer) == 0) {
 				process_stop (indexer);
 			} else {
@@ -1165,11 +1543,10 @@ miner_handle_next_item (TrackerIndexer *indexer)
 					                                   TRACKER_SPARQL_BUFFER_CLEANUP_AUDIO);
 				}
 
-				if (tracker_sparql_buffer_flush (indexer->sparql_buffer,
-				                                 "Queue handlers NONE",
-				                                 sparql_buffer_flush_cb,
-				                                 indexer))
-					indexer->flushing = TRUE;
+				tracker_sparql_buffer_flush (indexer->sparql_buffer,
+				                             "Queue handlers NONE",
+				                             sparql_buffer_flush_cb,
+				                             indexer);
 			}
 		}
 
@@ -1177,6 +1554,7 @@ miner_handle_next_item (TrackerIndexer *indexer)
 		return FALSE;
 	}
 
+	queue_event_unlink (indexer, event);
 	maybe_remove_file_event_node (indexer, event);
 
 	/* Handle queues */
@@ -1207,12 +1585,10 @@ miner_handle_next_item (TrackerIndexer *indexer)
 			                                   TRACKER_SPARQL_BUFFER_CLEANUP_AUDIO);
 		}
 
-		if (tracker_sparql_buffer_flush (indexer->sparql_buffer,
-		                                 "SPARQL buffer limit reached",
-		                                 sparql_buffer_flush_cb,
-		                                 indexer)) {
-			indexer->flushing = TRUE;
-		} else {
+		if (!tracker_sparql_buffer_flush (indexer->sparql_buffer,
+		                                  "SPARQL buffer limit reached",
+		                                  sparql_buffer_flush_cb,
+		                                  indexer)) {
 			/* If we cannot flush, wait for the pending operations
 			 * to finish.
 			 */
@@ -1222,7 +1598,7 @@ miner_handle_next_item (TrackerIndexer *indexer)
 
 	check_notifier_high_water (indexer);
 
-	queue_event_free (event);
+	queue_event_free (indexer, event);
 
 	return keep_processing;
 }
@@ -1284,7 +1660,7 @@ update_status_cb (gpointer user_data)
 		guint elems_left;
 
 		elems_left =
-			g_queue_get_length (indexer->items) +
+			queue_get_length (indexer) +
 			tracker_sparql_buffer_get_size (indexer->sparql_buffer);
 
 		if (elems_left > 0)
@@ -1360,47 +1736,49 @@ queue_handler_maybe_set_up (TrackerIndexer *indexer)
 
 static void
 indexer_queue_event (TrackerIndexer *indexer,
-                     QueueEvent     *event)
+                     QueueEvent     *event,
+                     guint           lane)
 {
 	QueueEvent *old = NULL;
 
+	event->lane = lane;
 	old = g_hash_table_lookup (indexer->items_by_file, event->file);
 
 	if (old) {
 		QueueCoalesceAction action;
 		QueueEvent *replacement = NULL;
 
-		action = queue_event_coalesce (old, event, &replacement);
+		/* Coalesced events keep the highest priority */
+		lane = MIN (old->lane, event->lane);
+		action = queue_event_coalesce (indexer, old, event, &replacement);
 
 		if (action & QUEUE_ACTION_DELETE_FIRST) {
 			g_hash_table_remove (indexer->items_by_file, old->file);
-			g_queue_delete_link (indexer->items, old->queue_node);
-			queue_event_free (old);
+			queue_event_unlink (indexer, old);
+			queue_event_free (indexer, old);
 		}
 
 		if (action & QUEUE_ACTION_DELETE_SECOND) {
-			queue_event_free (event);
+			queue_event_free (indexer, event);
 			event = NULL;
 		}
 
 		if (replacement)
 			event = replacement;
+
+		if (event && (action & QUEUE_ACTION_DELETE_FIRST))
+			event->lane = lane;
+		else if (!(action & QUEUE_ACTION_DELETE_FIRST) && lane < old->lane)
+			queue_event_promote (indexer, old, lane);
 	}
 
 	if (event) {
 		if (event->is_dir &&
 		    event->type == TRACKER_INDEXER_EVENT_DELETED) {
-			QueueForeachData foreach_data = { indexer, event->file };
-
 			/* Attempt to optimize by removing any children
 			 * of this directory from being processed.
 			 */
-			g_hash_table_foreach_remove (indexer->items_by_file,
-			                             remove_items_by_file_foreach,
-			                             event->file);
-			g_queue_foreach (indexer->items,
-			                 (GFunc) delete_nested_queued_events,
-			                 &foreach_data);
+			queue_remove_subtree (indexer, event->file);
 		}
 
 #ifdef G_ENABLE_DEBUG
@@ -1426,15 +1804,11 @@ indexer_queue_event (TrackerIndexer *indexer,
 // LCOV_EXCL_STOP
 #endif
 
-		event->queue_node = g_list_alloc ();
-		event->queue_node->data = event;
-		g_queue_push_tail_link (indexer->items, event->queue_node);
+		queue_event_link (indexer, event);
 
 		if (event->type == TRACKER_INDEXER_EVENT_MOVED) {
 			if (event->is_dir) {
-				g_hash_table_foreach_remove (indexer->items_by_file,
-				                             remove_items_by_file_foreach,
-				                             event->dest_file);
+				queue_forget_subtree (indexer, event->dest_file);
 			} else {
 				g_hash_table_remove (indexer->items_by_file, event->dest_file);
 			}
@@ -1460,8 +1834,9 @@ file_notifier_file_created (TrackerFileNotifier  *notifier,
 	TrackerIndexer *indexer = user_data;
 	QueueEvent *event;
 
-	event = queue_event_new (TRACKER_INDEXER_EVENT_CREATED, file, info);
-	indexer_queue_event (indexer, event);
+	event = queue_event_new (indexer, TRACKER_INDEXER_EVENT_CREATED, file, info);
+	indexer_queue_event (indexer, event,
+	                     tracker_file_notifier_get_event_priority (notifier));
 }
 
 static void
@@ -1473,9 +1848,10 @@ file_notifier_file_deleted (TrackerFileNotifier  *notifier,
 	TrackerIndexer *indexer = user_data;
 	QueueEvent *event;
 
-	event = queue_event_new (TRACKER_INDEXER_EVENT_DELETED, file, NULL);
+	event = queue_event_new (indexer, TRACKER_INDEXER_EVENT_DELETED, file, NULL);
 	event->is_dir = !!is_dir;
-	indexer_queue_event (indexer, event);
+	indexer_queue_event (indexer, event,
+	                     tracker_file_notifier_get_event_priority (notifier));
 }
 
 static void
@@ -1488,9 +1864,10 @@ file_notifier_file_updated (TrackerFileNotifier  *notifier,
 	TrackerIndexer *indexer = user_data;
 	QueueEvent *event;
 
-	event = queue_event_new (TRACKER_INDEXER_EVENT_UPDATED, file, info);
+	event = queue_event_new (indexer, TRACKER_INDEXER_EVENT_UPDATED, file, info);
 	event->attributes_update = attributes_only;
-	indexer_queue_event (indexer, event);
+	indexer_queue_event (indexer, event,
+	                     tracker_file_notifier_get_event_priority (notifier));
 }
 
 static void
@@ -1503,8 +1880,9 @@ file_notifier_file_moved (TrackerFileNotifier *notifier,
 	TrackerIndexer *indexer = user_data;
 	QueueEvent *event;
 
-	event = queue_event_moved_new (source, dest, is_dir);
-	indexer_queue_event (indexer, event);
+	event = queue_event_moved_new (indexer, source, dest, is_dir);
+	indexer_queue_event (indexer, event,
+	                     tracker_file_notifier_get_event_priority (notifier));
 }
 
 static void
@@ -1515,8 +1893,9 @@ file_notifier_directory_finished (TrackerFileNotifier *notifier,
 	TrackerIndexer *indexer = user_data;
 	QueueEvent *event;
 
-	event = queue_event_new (TRACKER_INDEXER_EVENT_FINISH_DIRECTORY, directory, NULL);
-	indexer_queue_event (indexer, event);
+	event = queue_event_new (indexer, TRACKER_INDEXER_EVENT_FINISH_DIRECTORY, directory, NULL);
+	indexer_queue_event (indexer, event,
+	                     tracker_file_notifier_get_event_priority (notifier));
 }
 
 static void
@@ -1565,7 +1944,6 @@ indexing_tree_directory_removed (TrackerIndexingTree *indexing_tree,
 	TrackerSparqlConnection *conn;
 	g_autoptr (TrackerBatch) batch = NULL;
 	g_autoptr (GError) error = NULL;
-	QueueForeachData foreach_data = { indexer, directory };
 
 	TRACKER_NOTE (MINER_FS_EVENTS,
 	              g_message ("  Cancelled processing pool tasks at %f\n",
@@ -1589,12 +1967,7 @@ indexing_tree_directory_removed (TrackerIndexingTree *indexing_tree,
 	/* Remove anything contained in the removed directory
 	 * from all relevant processing queues.
 	 */
-	g_hash_table_foreach_remove (indexer->items_by_file,
-	                             remove_items_by_file_foreach,
-	                             directory);
-	g_queue_foreach (indexer->items,
-	                 (GFunc) delete_nested_queued_events,
-	                 &foreach_data);
+	queue_remove_subtree (indexer, directory);
 
 	TRACKER_NOTE (MINER_FS_EVENTS,
 	              g_message ("  Removed files at %f\n",
@@ -1676,3 +2049,45 @@ tracker_indexer_new (TrackerSparqlConnection  *connection,
 	                     "extract-content", extract_content,
 	                     NULL);
 }
+
+#ifdef TEST
+void
+tracker_indexer_queue_file (TrackerIndexer              *indexer,
+                            GFile                       *file,
+                            gboolean                     update,
+                            TrackerFileNotifierPriority  priority)
+{
+	QueueEvent *event;
+
+	g_return_if_fail (TRACKER_IS_INDEXER (indexer));
+	g_return_if_fail (G_IS_FILE (file));
+	g_return_if_fail (priority < TRACKER_FILE_NOTIFIER_N_PRIORITIES);
+
+	event = queue_event_new (indexer,
+	                         update ?
+	                         TRACKER_INDEXER_EVENT_UPDATED :
+	                         TRACKER_INDEXER_EVENT_CREATED,
+	                         file, NULL);
+	indexer_queue_event (indexer, event, priority);
+}
+
+GFile *
+tracker_indexer_pop_next_file (TrackerIndexer *indexer)
+{
+	QueueEvent *event;
+	GFile *file;
+
+	g_return_val_if_fail (TRACKER_IS_INDEXER (indexer), NULL);
+
+	event = queue_peek_next_event (indexer);
+	if (!event)
+		return NULL;
+
+	queue_event_unlink (indexer, event);
+	maybe_remove_file_event_node (indexer, event);
+	file = g_object_ref (event->file);
+	queue_event_free (indexer, event);
+
+	return file;
+}
+#endif /* TEST */
@@ -22,6 +22,7 @@
 #include "config-miners.h"
 
 #include "tracker-indexing-tree.h"
+#include "tracker-lru.h"
 
 #include <tracker-common.h>
 
@@ -35,6 +36,8 @@
 
 typedef struct _ConfiguredFolder ConfiguredFolder;
 typedef struct _PatternData PatternData;
+typedef struct _StringKey StringKey;
+typedef struct _FilterMatcher FilterMatcher;
 
 struct _ConfiguredFolder
 {
@@ -44,6 +47,12 @@ struct _ConfiguredFolder
 	int uri_len;
 };
 
+struct _StringKey
+{
+	const char *str;
+	gsize len;
+};
+
 struct _PatternData
 {
 	GPatternSpec *pattern;
@@ -51,12 +60,40 @@ struct _PatternData
 	TrackerFilterType type;
 };
 
+/* Filters of a type, split by the kind of glob. Literal names,
+ * prefixes (e.g. "foo*") and suffixes (e.g. "*.o") are looked up
+ * in hash tables, other globs are matched one by one.
+ */
+struct _FilterMatcher
+{
+	GHashTable *exact;
+	GHashTable *prefixes;
+	GHashTable *suffixes;
+	GArray *prefix_lens;
+	GArray *suffix_lens;
+	GPtrArray *globs;
+	gboolean match_all;
+};
+
+#define N_FILTER_TYPES (TRACKER_FILTER_PARENT_DIRECTORY + 1)
+
+/* Number of directories whose TRACKER_FILTER_PARENT_DIRECTORY
+ * check result is kept around.
+ */
+#define PARENT_CACHE_SIZE 1000
+
 struct _TrackerIndexingTree
 {
 	GObject parent_instance;
 
 	GArray *configured_folders;
+	/* StringKey -> position in configured_folders, for local folders */
+	GHashTable *folders_by_path;
+	gsize max_path_len;
 	GList *filter_patterns;
+	FilterMatcher *matchers[N_FILTER_TYPES];
+	/* GFile -> GINT_TO_POINTER (indexable) */
+	TrackerLRU *parent_cache;
 	GList *allowed_text_patterns;
 };
 
@@ -81,6 +118,107 @@ configured_folder_clear (gpointer data)
 	g_clear_pointer (&folder->id, g_free);
 }
 
+static guint
+string_key_hash (gconstpointer data)
+{
+	const StringKey *key = data;
+	guint hash = 5381;
+	gsize i;
+
+	for (i = 0; i < key->len; i++)
+		hash = (hash << 5) + hash + (guchar) key->str[i];
+
+	return hash;
+}
+
+static gboolean
+string_key_equal (gconstpointer data1,
+                gconstpointer data2)
+{
+	const StringKey *key1 = data1, *key2 = data2;
+
+	return (key1->len == key2->len &&
+	        memcmp (key1->str, key2->str, key1->len) == 0);
+}
+
+static void
+update_folders_by_path (TrackerIndexingTree *tree)
+{
+	unsigned int i;
+
+	g_hash_table_remove_all (tree->folders_by_path);
+	tree->max_path_len = 0;
+
+	for (i = 0; i < tree->configured_folders->len; i++) {
+		ConfiguredFolder *folder;
+		StringKey *key;
+		const char *path;
+
+		folder = &g_array_index (tree->configured_folders, ConfiguredFolder, i);
+		path = g_file_peek_path (folder->file);
+		if (!path)
+			continue;
+
+		key = g_new0 (StringKey, 1);
+		key->str = path;
+		key->len = strlen (path);
+		tree->max_path_len = MAX (tree->max_path_len, key->len);
+		g_hash_table_insert (tree->folders_by_path, key, GUINT_TO_POINTER (i));
+	}
+}
+
+static ConfiguredFolder *
+lookup_configured_folder (TrackerIndexingTree *tree,
+                          const char          *path,
+                          gsize                len,
+                          unsigned int        *pos)
+{
+	StringKey key = { path, len };
+	gpointer value;
+
+	if (!g_hash_table_lookup_extended (tree->folders_by_path, &key, NULL, &value))
+		return NULL;
+
+	if (pos)
+		*pos = GPOINTER_TO_UINT (value);
+
+	return &g_array_index (tree->configured_folders, ConfiguredFolder,
+	                       GPOINTER_TO_UINT (value));
+}
+
+static ConfiguredFolder *
+find_configured_folder_for_path (TrackerIndexingTree *tree,
+                                 const char          *path,
+                                 gboolean             exact,
+                                 unsigned int        *pos)
+{
+	ConfiguredFolder *folder;
+	gsize len, i;
+
+	len = strlen (path);
+
+	if (exact)
+		return lookup_configured_folder (tree, path, len, pos);
+
+	/* Look up the path and its parents, deepest first, skipping
+	 * those longer than any configured folder.
+	 */
+	for (i = MIN (len, tree->max_path_len); i > 0; i--) {
+		if (i < len && path[i] != G_DIR_SEPARATOR)
+			continue;
+
+		folder = lookup_configured_folder (tree, path, i, pos);
+		if (folder)
+			return folder;
+	}
+
+	/* The filesystem root */
+	if (path[0] == G_DIR_SEPARATOR)
+		return lookup_configured_folder (tree, path, 1, pos);
+
+	return NULL;
+}
+
 static ConfiguredFolder *
 find_configured_folder (TrackerIndexingTree *tree,
 			GFile               *file,
@@ -136,6 +274,201 @@ pattern_data_free (PatternData *data)
 	g_slice_free (PatternData, data);
 }
 
+static void
+add_string_key (GHashTable *table,
+                GArray     *lens,
+                const char *str,
+                gsize       len)
+{
+	StringKey *key;
+	guint i;
+
+	key = g_new0 (StringKey, 1);
+	key->str = str;
+	key->len = len;
+
+	if (!g_hash_table_add (table, key) || !lens)
+		return;
+
+	/* Keep the distinct lengths sorted */
+	for (i = 0; i < lens->len; i++) {
+		gsize cur = g_array_index (lens, gsize, i);
+
+		if (cur == len)
+			return;
+		else if (cur > len)
+			break;
+	}
+
+	g_array_insert_val (lens, i, len);
+}
+
+static FilterMatcher *
+filter_matcher_new (GList             *patterns,
+                    TrackerFilterType  type)
+{
+	FilterMatcher *matcher;
+	GList *l;
+
+	matcher = g_new0 (FilterMatcher, 1);
+	matcher->exact = g_hash_table_new_full (string_key_hash, string_key_equal, g_free, NULL);
+	matcher->prefixes = g_hash_table_new_full (string_key_hash, string_key_equal, g_free, NULL);
+	matcher->suffixes = g_hash_table_new_full (string_key_hash, string_key_equal, g_free, NULL);
+	matcher->prefix_lens = g_array_new (FALSE, FALSE, sizeof (gsize));
+	matcher->suffix_lens = g_array_new (FALSE, FALSE, sizeof (gsize));
+	matcher->globs = g_ptr_array_new ();
+
+	for (l = patterns; l; l = l->next) {
+		PatternData *data = l->data;
+		const char *str = data->string, *star;
+		gsize len;
+
+		if (data->type != type)
+			continue;
+
+		len = strlen (str);
+		star = strchr (str, '*');
+
+		if (!data->pattern || (!star && !strchr (str, '?'))) {
+			add_string_key (matcher->exact, NULL, str, len);
+		} else if (strspn (str, "*") == len) {
+			matcher->match_all = TRUE;
+		} else if (strchr (str, '?') || strchr (star + 1, '*')) {
+			/* Single character wildcards, or multiple stars */
+			g_ptr_array_add (matcher->globs, data);
+		} else if (star == &str[len - 1]) {
+			add_string_key (matcher->prefixes, matcher->prefix_lens, str, len - 1);
+		} else if (star == str) {
+			add_string_key (matcher->suffixes, matcher->suffix_lens, &str[1], len - 1);
+		} else {
+			g_ptr_array_add (matcher->globs, data);
+		}
+	}
+
+	return matcher;
+}
+
+static void
+filter_matcher_free (FilterMatcher *matcher)
+{
+	g_hash_table_unref (matcher->exact);
+	g_hash_table_unref (matcher->prefixes);
+	g_hash_table_unref (matcher->suffixes);
+	g_array_unref (matcher->prefix_lens);
+	g_array_unref (matcher->suffix_lens);
+	g_ptr_array_unref (matcher->globs);
+	g_free (matcher);
+}
+
+static gboolean
+filter_matcher_match (FilterMatcher *matcher,
+                      const char    *name)
+{
+	StringKey key;
+	gsize len;
+	guint i;
+
+	if (matcher->match_all)
+		return TRUE;
+
+	len = strlen (name);
+	key = (StringKey) { name, len };
+
+	if (g_hash_table_contains (matcher->exact, &key))
+		return TRUE;
+
+	for (i = 0; i < matcher->prefix_lens->len; i++) {
+		gsize prefix_len = g_array_index (matcher->prefix_lens, gsize, i);
+
+		if (prefix_len > len)
+			break;
+
+		key = (StringKey) { name, prefix_len };
+		if (g_hash_table_contains (matcher->prefixes, &key))
+			return TRUE;
+	}
+
+	for (i = 0; i < matcher->suffix_lens->len; i++) {
+		gsize suffix_len = g_array_index (matcher->suffix_lens, gsize, i);
+
+		if (suffix_len > len)
+			break;
+
+		key = (StringKey) { &name[len - suffix_len], suffix_len };
+		if (g_hash_table_contains (matcher->suffixes, &key))
+			return TRUE;
+	}
+
+	if (matcher->globs->len > 0) {
+		g_autofree char *valid = NULL;
+
+		/* Patterns are UTF-8, make sure the matched string is too */
+		if (!g_utf8_validate (name, len, NULL)) {
+			valid = g_utf8_make_valid (name, len);
+			name = valid;
+			len = strlen (valid);
+		}
+
+		for (i = 0; i < matcher->globs->len; i++) {
+			PatternData *data = g_ptr_array_index (matcher->globs, i);
+
+#if GLIB_CHECK_VERSION (2, 70, 0)
+			if (g_pattern_spec_match (data->pattern, len, name, NULL))
+#else
+			if (g_pattern_match (data->pattern, len, name, NULL))
+#endif
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gboolean
+filter_matcher_is_empty (FilterMatcher *matcher)
+{
+	return !matcher->match_all &&
+		g_hash_table_size (matcher->exact) == 0 &&
+		matcher->prefix_lens->len == 0 &&
+		matcher->suffix_lens->len == 0 &&
+		matcher->globs->len == 0;
+}
+
+static void
+invalidate_filter_matchers (TrackerIndexingTree *tree)
+{
+	int i;
+
+	for (i = 0; i < N_FILTER_TYPES; i++)
+		g_clear_pointer (&tree->matchers[i], filter_matcher_free);
+
+	g_clear_pointer (&tree->parent_cache, tracker_lru_free);
+}
+
+static FilterMatcher *
+ensure_filter_matcher (TrackerIndexingTree *tree,
+                       TrackerFilterType    type)
+{
+	if (!tree->matchers[type])
+		tree->matchers[type] = filter_matcher_new (tree->filter_patterns, type);
+
+	return tree->matchers[type];
+}
+
+static TrackerLRU *
+ensure_parent_cache (TrackerIndexingTree *tree)
+{
+	if (!tree->parent_cache) {
+		tree->parent_cache = tracker_lru_new (PARENT_CACHE_SIZE,
+		                                      g_file_hash,
+		                                      (GEqualFunc) g_file_equal,
+		                                      g_object_unref,
+		                                      NULL);
+	}
+
+	return tree->parent_cache;
+}
+
 static int
 pattern_data_compare (const PatternData *data1,
                       const PatternData *data2)
@@ -154,7 +487,9 @@ tracker_indexing_tree_finalize (GObject *object)
 	tree = TRACKER_INDEXING_TREE (object);
 
 	g_clear_list (&tree->allowed_text_patterns, (GDestroyNotify) pattern_data_free);
+	invalidate_filter_matchers (tree);
 	g_clear_list (&tree->filter_patterns, (GDestroyNotify) pattern_data_free);
+	g_clear_pointer (&tree->folders_by_path, g_hash_table_unref);
 	g_clear_pointer (&tree->configured_folders, g_array_unref);
 
 	G_OBJECT_CLASS (tracker_indexing_tree_parent_class)->finalize (object);
@@ -255,6 +590,8 @@ tracker_indexing_tree_init (TrackerIndexingTree *tree)
 		g_array_new (FALSE, FALSE, sizeof (ConfiguredFolder));
 	g_array_set_clear_func (tree->configured_folders,
 				configured_folder_clear);
+	tree->folders_by_path =
+		g_hash_table_new_full (string_key_hash, string_key_equal, g_free, NULL);
 }
 
 /**
@@ -342,6 +679,8 @@ tracker_indexing_tree_add (TrackerIndexingTree   *tree,
 	else
 		g_array_append_val (tree->configured_folders, new_folder);
 
+	update_folders_by_path (tree);
+
 	g_signal_emit (tree, signals[DIRECTORY_ADDED], 0, directory);
 }
 
@@ -370,6 +709,7 @@ tracker_indexing_tree_remove (TrackerIndexingTree *tree,
 
 	g_signal_emit (tree, signals[DIRECTORY_REMOVED], 0, folder->file);
 	g_array_remove_index (tree->configured_folders, pos);
+	update_folders_by_path (tree);
 }
 
 /**
@@ -463,6 +803,7 @@ tracker_indexing_tree_add_filter (TrackerIndexingTree *tree,
 
 	data = pattern_data_new (glob_string, filter);
 	tree->filter_patterns = g_list_prepend (tree->filter_patterns, data);
+	invalidate_filter_matchers (tree);
 }
 
 /**
@@ -492,6 +833,8 @@ tracker_indexing_tree_clear_filters (TrackerIndexingTree *tree,
 			pattern_data_free (data);
 		}
 	}
+
+	invalidate_filter_matchers (tree);
 }
 
 /**
@@ -509,51 +852,50 @@ tracker_indexing_tree_file_matches_filter (TrackerIndexingTree *tree,
                                            TrackerFilterType    type,
                                            GFile               *file)
 {
-	GList *filters;
-	gchar *basename, *str, *reverse;
-	gboolean match = FALSE;
-	gint len;
+	g_autofree gchar *basename = NULL;
+	const char *path, *name = NULL;
 
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+	g_return_val_if_fail (type < N_FILTER_TYPES, FALSE);
 
-	filters = tree->filter_patterns;
-	basename = g_file_get_basename (file);
-
-	str = g_utf8_make_valid (basename, -1);
-	len = strlen (str);
-	reverse = g_utf8_strreverse (str, len);
-
-	while (filters) {
-		PatternData *data = filters->data;
-
-		filters = filters->next;
-
-		if (data->type != type)
-			continue;
-
-		if (!data->pattern) {
-			match = g_strcmp0 (str, data->string) == 0;
-			break;
-		}
-
-#if GLIB_CHECK_VERSION (2, 70, 0)
-		if (g_pattern_spec_match (data->pattern, len, str, reverse))
-#else
-		if (g_pattern_match (data->pattern, len, str, reverse))
-#endif
+	/* Avoid allocating the basename of local files */
+	path = g_file_peek_path (file);
+	if (path) {
+		name = strrchr (path, G_DIR_SEPARATOR);
+		name = name ? name + 1 : path;
+	}
 
-		{
-			match = TRUE;
-			break;
-		}
+	if (!name || !*name) {
+		basename = g_file_get_basename (file);
+		name = basename;
 	}
 
-	g_free (basename);
-	g_free (str);
-	g_free (reverse);
+	return filter_matcher_match (ensure_filter_matcher (tree, type), name);
+}
 
-	return match;
+/**
+ * tracker_indexing_tree_basename_matches_filter:
+ * @tree: a #TrackerIndexingTree
+ * @type: filter type
+ * @basename: a file name
+ *
+ * Returns %TRUE if a file named @basename matches any filter of
+ * the given filter type. This is useful to check the contents of
+ * a directory listing without creating #GFile<!-- -->s.
+ *
+ * Returns: %TRUE if @basename is filtered.
+ **/
+gboolean
+tracker_indexing_tree_basename_matches_filter (TrackerIndexingTree *tree,
+                                               TrackerFilterType    type,
+                                               const char          *basename)
+{
+	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
+	g_return_val_if_fail (basename != NULL, FALSE);
+	g_return_val_if_fail (type < N_FILTER_TYPES, FALSE);
+
+	return filter_matcher_match (ensure_filter_matcher (tree, type), basename);
 }
 
 static gboolean
@@ -643,6 +985,9 @@ tracker_indexing_tree_file_is_indexable (TrackerIndexingTree *tree,
  *
  * returns %TRUE if @parent should be indexed based on its contents.
  *
+ * The result is cached, see tracker_indexing_tree_set_parent_is_indexable()
+ * and tracker_indexing_tree_invalidate_parent() to keep it up to date.
+ *
  * Returns: %TRUE if @parent should be indexed.
  **/
 gboolean
@@ -650,11 +995,18 @@ tracker_indexing_tree_parent_is_indexable (TrackerIndexingTree *tree,
                                            GFile               *parent)
 {
 	gboolean has_match = FALSE;
+	gpointer cached;
 	GList *filters;
 
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
 	g_return_val_if_fail (G_IS_FILE (parent), FALSE);
 
+	if (filter_matcher_is_empty (ensure_filter_matcher (tree, TRACKER_FILTER_PARENT_DIRECTORY)))
+		return TRUE;
+
+	if (tracker_lru_find (ensure_parent_cache (tree), parent, &cached))
+		return GPOINTER_TO_INT (cached);
+
 	filters = tree->filter_patterns;
 
 	while (filters) {
@@ -674,9 +1026,70 @@ tracker_indexing_tree_parent_is_indexable (TrackerIndexingTree *tree,
 		}
 	}
 
+	tracker_lru_add (tree->parent_cache, g_object_ref (parent),
+	                 GINT_TO_POINTER (!has_match));
+
 	return !has_match;
 }
 
+/**
+ * tracker_indexing_tree_set_parent_is_indexable:
+ * @tree: a #TrackerIndexingTree
+ * @parent: directory
+ * @indexable: whether @parent should be indexed based on its contents
+ *
+ * Caches the result of checking the contents of @parent against the
+ * %TRACKER_FILTER_PARENT_DIRECTORY filters, e.g. when the caller
+ * already listed the directory.
+ **/
+void
+tracker_indexing_tree_set_parent_is_indexable (TrackerIndexingTree *tree,
+                                               GFile               *parent,
+                                               gboolean             indexable)
+{
+	TrackerLRU *cache;
+
+	g_return_if_fail (TRACKER_IS_INDEXING_TREE (tree));
+	g_return_if_fail (G_IS_FILE (parent));
+
+	cache = ensure_parent_cache (tree);
+	tracker_lru_remove (cache, parent);
+	tracker_lru_add (cache, g_object_ref (parent),
+	                 GINT_TO_POINTER (!!indexable));
+}
+
+static gboolean
+file_equal_or_descendant (gconstpointer a,
+                          gconstpointer b)
+{
+	return g_file_equal ((GFile *) a, (GFile *) b) ||
+		g_file_has_prefix ((GFile *) a, (GFile *) b);
+}
+
+/**
+ * tracker_indexing_tree_invalidate_parent:
+ * @tree: a #TrackerIndexingTree
+ * @parent: directory
+ *
+ * Drops the cached content checks of @parent and all directories
+ * inside it, e.g. after files matching %TRACKER_FILTER_PARENT_DIRECTORY
+ * filters were deleted, or the directory was removed.
+ **/
+void
+tracker_indexing_tree_invalidate_parent (TrackerIndexingTree *tree,
+                                         GFile               *parent)
+{
+	g_return_if_fail (TRACKER_IS_INDEXING_TREE (tree));
+	g_return_if_fail (G_IS_FILE (parent));
+
+	if (!tree->parent_cache)
+		return;
+
+	tracker_lru_remove_foreach (tree->parent_cache,
+	                            file_equal_or_descendant,
+	                            parent);
+}
+
 GFile *
 tracker_indexing_tree_get_root (TrackerIndexingTree    *tree,
                                 GFile                  *file,
@@ -684,6 +1097,7 @@ tracker_indexing_tree_get_root (TrackerIndexingTree    *tree,
                                 TrackerDirectoryFlags  *directory_flags)
 {
 	ConfiguredFolder *folder;
+	const char *path;
 
 	if (directory_flags) {
 		*directory_flags = TRACKER_DIRECTORY_FLAG_NONE;
@@ -692,7 +1106,12 @@ tracker_indexing_tree_get_root (TrackerIndexingTree    *tree,
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), NULL);
 	g_return_val_if_fail (G_IS_FILE (file), NULL);
 
-	folder = find_configured_folder (tree, file, (GEqualFunc) parent_or_equals, NULL);
+	path = g_file_peek_path (file);
+
+	if (path)
+		folder = find_configured_folder_for_path (tree, path, FALSE, NULL);
+	else
+		folder = find_configured_folder (tree, file, (GEqualFunc) parent_or_equals, NULL);
 
 	if (!folder)
 		return NULL;
@@ -724,9 +1143,15 @@ gboolean
 tracker_indexing_tree_file_is_root (TrackerIndexingTree *tree,
                                     GFile               *file)
 {
+	const char *path;
+
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
+	path = g_file_peek_path (file);
+	if (path)
+		return find_configured_folder_for_path (tree, path, TRUE, NULL) != NULL;
+
 	return find_configured_folder (tree, file, (GEqualFunc) g_file_equal, NULL) != NULL;
 }
 
@@ -51,12 +51,20 @@ void      tracker_indexing_tree_clear_filters        (TrackerIndexingTree  *tree
 gboolean  tracker_indexing_tree_file_matches_filter  (TrackerIndexingTree  *tree,
                                                       TrackerFilterType     type,
                                                       GFile                *file);
+gboolean  tracker_indexing_tree_basename_matches_filter (TrackerIndexingTree  *tree,
+                                                         TrackerFilterType     type,
+                                                         const char           *basename);
 
 gboolean  tracker_indexing_tree_file_is_indexable    (TrackerIndexingTree  *tree,
                                                       GFile                *file,
                                                       GFileInfo            *info);
 gboolean  tracker_indexing_tree_parent_is_indexable (TrackerIndexingTree  *tree,
                                                      GFile                *file);
+void      tracker_indexing_tree_set_parent_is_indexable (TrackerIndexingTree *tree,
+                                                         GFile               *parent,
+                                                         gboolean             indexable);
+void      tracker_indexing_tree_invalidate_parent    (TrackerIndexingTree  *tree,
+                                                      GFile                *parent);
 
 GFile *   tracker_indexing_tree_get_root             (TrackerIndexingTree    *tree,
                                                       GFile                  *file,
@@ -29,6 +29,7 @@ struct _TrackerLRUElement {
 	gpointer element;
 	gpointer data;
 	GList *link;
+	gsize cost;
 };
 
 struct _TrackerLRU {
@@ -36,7 +37,9 @@ struct _TrackerLRU {
 	GHashTable *items;
 	GDestroyNotify elem_destroy;
 	GDestroyNotify data_destroy;
-	guint max_size;
+	TrackerLRUCostFunc cost_func;
+	gsize max_cost;
+	gsize cost;
 };
 
 static void
@@ -44,8 +47,11 @@ free_node (TrackerLRUElement *node,
            TrackerLRU        *lru)
 {
 	g_hash_table_remove (lru->items, node->element);
-	lru->elem_destroy (node->element);
-	lru->data_destroy (node->data);
+	lru->cost -= node->cost;
+	if (lru->elem_destroy)
+		lru->elem_destroy (node->element);
+	if (lru->data_destroy)
+		lru->data_destroy (node->data);
 	g_slice_free (TrackerLRUElement, node);
 }
 
@@ -55,12 +61,26 @@ tracker_lru_new (guint                size,
                  GEqualFunc           elem_equal_func,
                  GDestroyNotify       elem_destroy,
                  GDestroyNotify       data_destroy)
+{
+	return tracker_lru_new_full (size, NULL,
+	                             elem_hash_func, elem_equal_func,
+	                             elem_destroy, data_destroy);
+}
+
+TrackerLRU *
+tracker_lru_new_full (gsize                max_cost,
+                      TrackerLRUCostFunc   cost_func,
+                      GHashFunc            elem_hash_func,
+                      GEqualFunc           elem_equal_func,
+                      GDestroyNotify       elem_destroy,
+                      GDestroyNotify       data_destroy)
 {
 	TrackerLRU *lru;
 
 	lru = g_new0 (TrackerLRU, 1);
 	g_queue_init (&lru->queue);
-	lru->max_size = size;
+	lru->max_cost = max_cost;
+	lru->cost_func = cost_func;
 	lru->elem_destroy = elem_destroy;
 	lru->data_destroy = data_destroy;
 	lru->items = g_hash_table_new (elem_hash_func,
@@ -120,14 +140,17 @@ tracker_lru_add (TrackerLRU *lru,
 	node = g_slice_new0 (TrackerLRUElement);
 	node->element = elem;
 	node->data = data;
+	node->cost = lru->cost_func ? lru->cost_func (elem, data) : 1;
 	node->link = g_list_alloc ();
 	node->link->data = node;
 
 	g_queue_push_head_link (&lru->queue, node->link);
 
 	g_hash_table_insert (lru->items, elem, node);
+	lru->cost += node->cost;
 
-	if (g_hash_table_size (lru->items) > lru->max_size) {
+	while (lru->cost > lru->max_cost &&
+	       lru->queue.tail != node->link) {
 		/* Remove last element */
 		last = g_queue_pop_tail (&lru->queue);
 		free_node (last, lru);
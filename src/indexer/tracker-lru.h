@@ -25,12 +25,22 @@
 
 typedef struct _TrackerLRU TrackerLRU;
 
+typedef gsize (* TrackerLRUCostFunc) (gpointer elem,
+                                      gpointer data);
+
 TrackerLRU * tracker_lru_new (guint                size,
                               GHashFunc            elem_hash_func,
                               GEqualFunc           elem_equal_func,
                               GDestroyNotify       elem_destroy,
                               GDestroyNotify       data_destroy);
 
+TrackerLRU * tracker_lru_new_full (gsize                max_cost,
+                                   TrackerLRUCostFunc   cost_func,
+                                   GHashFunc            elem_hash_func,
+                                   GEqualFunc           elem_equal_func,
+                                   GDestroyNotify       elem_destroy,
+                                   GDestroyNotify       data_destroy);
+
 void tracker_lru_free (TrackerLRU *lru);
 
 gboolean tracker_lru_find (TrackerLRU *lru,
@@ -24,6 +24,7 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <gio/gio.h>
 #include <sys/fanotify.h>
 #include <sys/vfs.h>
@@ -32,6 +33,7 @@
 
 #include "tracker-monitor-fanotify.h"
 #include "tracker-monitor-private.h"
+#include "tracker-utils.h"
 
 #include <tracker-common.h>
 
@@ -41,6 +43,11 @@
                          FAN_MOVED_TO | FAN_MOVED_FROM | FAN_MOVE_SELF | \
                          FAN_EVENT_ON_CHILD | FAN_ONDIR)
 
+/* Filesystem marks get events for every child already */
+#define FANOTIFY_FILESYSTEM_EVENTS (FANOTIFY_EVENTS & ~FAN_EVENT_ON_CHILD)
+
+#define MAX_RESOLVED_HANDLES 4096
+
 typedef enum {
 	EVENT_NONE,
 	EVENT_CREATE,
@@ -73,15 +80,26 @@ struct _TrackerMonitorFanotify {
 	TrackerMonitor parent_instance;
 
 	GHashTable *monitored_dirs;
+	GTree *dirs_tree;
 	GHashTable *handles;
 	GHashTable *cached_events;
 	GSource *source;
 	gboolean enabled;
 	int fanotify_fd;
 
+	/* Filesystem-wide marks, and directory handles resolved
+	 * to a path for events coming through those.
+	 */
+	GHashTable *filesystems;
+	GHashTable *resolved_handles;
+	/* Resolved handles sorted by URI, to invalidate subtrees */
+	GTree *resolved_tree;
+	gboolean use_filesystem_marks;
+
 	ssize_t file_handle_payload;
 	GFile *moved_file;
 	guint limit;
+	guint n_marks;
 	guint ignored;
 };
 
@@ -91,9 +109,25 @@ typedef struct {
 	struct file_handle handle;
 } HandleData;
 
+typedef struct {
+	TrackerMonitorFanotify *monitor;
+	guint64 fsid;
+	/* Used to open handles in this filesystem, -1 if the
+	 * filesystem could not be marked.
+	 */
+	int mount_fd;
+	gchar *path;
+	/* Number of monitored folders covered by the mark */
+	guint n_folders;
+} MonitoredFilesystem;
+
 typedef struct {
 	TrackerMonitorFanotify *monitor;
 	GFile *file;
+	/* Set for folders covered by a filesystem mark, these
+	 * have no mark or handle of their own.
+	 */
+	MonitoredFilesystem *filesystem;
 	GBytes *handle_bytes;
 	/* This must be last in the struct */
 	HandleData handle;
@@ -320,6 +354,105 @@ flush_moved_file_event (TrackerMonitorFanotify *monitor)
 	}
 }
 
+static guint64
+fsid_to_key (const fsid_t *fsid)
+{
+	guint64 key;
+
+	G_STATIC_ASSERT (sizeof (fsid_t) == sizeof (guint64));
+	memcpy (&key, fsid, sizeof (key));
+
+	return key;
+}
+
+static GFile *
+resolve_handle (TrackerMonitorFanotify *monitor,
+                HandleData             *handle)
+{
+	MonitoredFilesystem *filesystem;
+	GBytes *handle_bytes;
+	gchar *proc_path, *path;
+	GFile *file;
+	guint64 fsid;
+	int fd;
+
+	handle_bytes = create_bytes_for_handle (handle);
+	file = g_hash_table_lookup (monitor->resolved_handles, handle_bytes);
+	g_bytes_unref (handle_bytes);
+
+	if (file)
+		return file;
+
+	fsid = fsid_to_key (&handle->fsid);
+	filesystem = g_hash_table_lookup (monitor->filesystems, &fsid);
+	if (!filesystem || filesystem->mount_fd < 0)
+		return NULL;
+
+	fd = open_by_handle_at (filesystem->mount_fd, &handle->handle,
+	                        O_PATH | O_CLOEXEC);
+	if (fd < 0) {
+		if (errno != ESTALE)
+			TRACKER_NOTE (MONITORS, g_message ("Could not open file handle: %m"));
+		return NULL;
+	}
+
+	proc_path = g_strdup_printf ("/proc/self/fd/%d", fd);
+	path = g_file_read_link (proc_path, NULL);
+	g_free (proc_path);
+	close (fd);
+
+	/* Directory is gone already */
+	if (!path || !g_path_is_absolute (path) ||
+	    g_str_has_suffix (path, " (deleted)")) {
+		g_free (path);
+		return NULL;
+	}
+
+	if (g_hash_table_size (monitor->resolved_handles) >= MAX_RESOLVED_HANDLES) {
+		g_hash_table_remove_all (monitor->resolved_handles);
+		g_tree_remove_all (monitor->resolved_tree);
+	}
+
+	file = g_file_new_for_path (path);
+	handle_bytes = g_bytes_new (handle,
+	                            sizeof (HandleData) +
+	                            handle->handle.handle_bytes);
+	g_hash_table_insert (monitor->resolved_handles, handle_bytes, file);
+	g_tree_replace (monitor->resolved_tree,
+	                g_file_get_uri (file),
+	                g_bytes_ref (handle_bytes));
+	g_free (path);
+
+	return file;
+}
+
+/* Drops the resolved paths of @file and the folders below it */
+static void
+invalidate_resolved_handles (TrackerMonitorFanotify *monitor,
+                             GFile                  *file)
+{
+	g_autofree gchar *uri = NULL;
+	g_autoptr (GPtrArray) keys = NULL;
+	GTreeNode *node;
+	gsize len;
+	guint i;
+
+	uri = g_file_get_uri (file);
+	len = strlen (uri);
+	keys = g_ptr_array_new ();
+
+	for (node = g_tree_lower_bound (monitor->resolved_tree, uri);
+	     node && tracker_uri_is_nested (g_tree_node_key (node), uri, len);
+	     node = g_tree_node_next (node)) {
+		g_hash_table_remove (monitor->resolved_handles,
+		                     g_tree_node_value (node));
+		g_ptr_array_add (keys, (gpointer) g_tree_node_key (node));
+	}
+
+	for (i = 0; i < keys->len; i++)
+		g_tree_remove (monitor->resolved_tree, g_ptr_array_index (keys, i));
+}
+
 static gboolean
 fanotify_events_cb (int          fd,
                     GIOCondition condition,
@@ -339,7 +472,7 @@ fanotify_events_cb (int          fd,
 		MonitoredFile *data;
 		const gchar *file_name;
 		GBytes *fid_bytes;
-		GFile *child;
+		GFile *dir = NULL, *child;
 
 		/* Check that run-time and compile-time structures match. */
 		if (event->vers != FANOTIFY_METADATA_VERSION) {
@@ -365,7 +498,20 @@ fanotify_events_cb (int          fd,
 		data = g_hash_table_lookup (monitor->handles, fid_bytes);
 		g_bytes_unref (fid_bytes);
 
-		if (!data) {
+		if (data) {
+			dir = data->file;
+		} else if (g_hash_table_size (monitor->filesystems) > 0) {
+			/* Events from filesystem marks cover everything in
+			 * the filesystem, only handle those in folders we
+			 * were asked to monitor.
+			 */
+			dir = resolve_handle (monitor, handle);
+
+			if (dir && !g_hash_table_contains (monitor->monitored_dirs, dir))
+				dir = NULL;
+		}
+
+		if (!dir) {
 			/* We are receiving a notification on an unknown handle,
 			 * should this ever happen on folders? In either case this is
 			 * ignored, presumably will be fixed by events that
@@ -378,9 +524,9 @@ fanotify_events_cb (int          fd,
 		file_name = handle->handle.f_handle + handle->handle.handle_bytes;
 
 		if (g_strcmp0 (file_name, ".") == 0)
-			child = g_object_ref (data->file);
+			child = g_object_ref (dir);
 		else
-			child = g_file_get_child (data->file, file_name);
+			child = g_file_get_child (dir, file_name);
 
 		/* We have a pending MOVED_FROM event, now unpaired. Flush
 		 * it as a DELETE event, since it's moving outside our
@@ -390,6 +536,13 @@ fanotify_events_cb (int          fd,
 			flush_moved_file_event (monitor);
 
 		handle_monitor_events (monitor, child, event->mask);
+
+		/* Resolved paths may be stale after directories move */
+		if ((event->mask & FAN_ONDIR) &&
+		    (event->mask & (FAN_MOVED_FROM | FAN_MOVED_TO | FAN_MOVE_SELF |
+		                    FAN_DELETE | FAN_DELETE_SELF)))
+			invalidate_resolved_handles (monitor, child);
+
 		g_object_unref (child);
 
 	cont:
@@ -451,6 +604,12 @@ tracker_monitor_fanotify_initable_init (GInitable     *initable,
 
 	/* Take up to 80% of available marks */
 	monitor->limit = limit * 8 / 10;
+
+	/* Optionally mark whole filesystems, this needs CAP_SYS_ADMIN
+	 * and CAP_DAC_READ_SEARCH, per-directory marks are used otherwise.
+	 */
+	monitor->use_filesystem_marks =
+		g_getenv ("TRACKER_MONITOR_FILESYSTEM_MARKS") != NULL;
 	TRACKER_NOTE (MONITORS, g_message ("Setting a limit of %d  Fanotify marks",
 	                                   monitor->limit));
 
@@ -488,6 +647,10 @@ tracker_monitor_fanotify_set_enabled (TrackerMonitor *object,
 	g_list_foreach (files, (GFunc) g_object_ref, NULL);
 	g_hash_table_remove_all (monitor->handles);
 	g_hash_table_remove_all (monitor->monitored_dirs);
+	g_tree_remove_all (monitor->dirs_tree);
+	g_hash_table_remove_all (monitor->resolved_handles);
+	g_tree_remove_all (monitor->resolved_tree);
+	g_hash_table_remove_all (monitor->filesystems);
 
 	while (files) {
 		GFile *file;
@@ -521,8 +684,12 @@ tracker_monitor_fanotify_finalize (GObject *object)
 	}
 
 	g_hash_table_unref (monitor->monitored_dirs);
+	g_tree_unref (monitor->dirs_tree);
 	g_hash_table_unref (monitor->handles);
 	g_hash_table_unref (monitor->cached_events);
+	g_hash_table_unref (monitor->resolved_handles);
+	g_tree_unref (monitor->resolved_tree);
+	g_hash_table_unref (monitor->filesystems);
 	g_clear_object (&monitor->moved_file);
 
 	G_OBJECT_CLASS (tracker_monitor_fanotify_parent_class)->finalize (object);
@@ -590,6 +757,136 @@ remove_mark (TrackerMonitorFanotify *monitor,
 	g_free (path);
 }
 
+static void
+monitored_filesystem_free (MonitoredFilesystem *filesystem)
+{
+	if (filesystem->mount_fd >= 0) {
+		/* The path the mark was added through might be gone,
+		 * remove it through the filesystem we kept open.
+		 */
+		if (fanotify_mark (filesystem->monitor->fanotify_fd,
+		                   FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM,
+		                   FANOTIFY_FILESYSTEM_EVENTS,
+		                   filesystem->mount_fd,
+		                   NULL) < 0)
+			g_warning ("Could not remove filesystem mark for path '%s': %m",
+			           filesystem->path);
+
+		close (filesystem->mount_fd);
+	}
+
+	g_free (filesystem->path);
+	g_free (filesystem);
+}
+
+/* Events through filesystem marks are only usable if the folder
+ * handles in them can be opened, check that it works beforehand.
+ */
+static gboolean
+probe_file_handles (const gchar *path,
+                    int          mount_fd)
+{
+	union {
+		struct file_handle handle;
+		gchar buf[sizeof (struct file_handle) + MAX_HANDLE_SZ];
+	} data;
+	int mntid, fd;
+
+	data.handle.handle_bytes = MAX_HANDLE_SZ;
+
+	if (name_to_handle_at (AT_FDCWD, path, &data.handle, &mntid, 0) < 0)
+		return FALSE;
+
+	fd = open_by_handle_at (mount_fd, &data.handle, O_PATH | O_CLOEXEC);
+	if (fd < 0)
+		return FALSE;
+
+	close (fd);
+	return TRUE;
+}
+
+static MonitoredFilesystem *
+ensure_filesystem_mark (TrackerMonitorFanotify *monitor,
+                        GFile                  *file)
+{
+	MonitoredFilesystem *filesystem;
+	const gchar *path;
+	struct statfs buf;
+	guint64 fsid;
+
+	path = g_file_peek_path (file);
+	if (!path || statfs (path, &buf) < 0)
+		return NULL;
+
+	fsid = fsid_to_key (&buf.f_fsid);
+	filesystem = g_hash_table_lookup (monitor->filesystems, &fsid);
+	if (filesystem)
+		return filesystem->mount_fd >= 0 ? filesystem : NULL;
+
+	filesystem = g_new0 (MonitoredFilesystem, 1);
+	filesystem->monitor = monitor;
+	filesystem->fsid = fsid;
+	filesystem->path = g_strdup (path);
+	filesystem->mount_fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (filesystem->mount_fd >= 0 &&
+	    !probe_file_handles (path, filesystem->mount_fd)) {
+		if (errno == EPERM) {
+			/* Opening handles needs CAP_DAC_READ_SEARCH */
+			g_info ("Not allowed to open file handles, using per-directory marks");
+			monitor->use_filesystem_marks = FALSE;
+		} else {
+			g_info ("Could not use file handles for '%s': %m", path);
+		}
+
+		close (filesystem->mount_fd);
+		filesystem->mount_fd = -1;
+	}
+
+	if (filesystem->mount_fd >= 0 &&
+	    fanotify_mark (monitor->fanotify_fd,
+	                   FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+	                   FANOTIFY_FILESYSTEM_EVENTS,
+	                   AT_FDCWD,
+	                   path) < 0) {
+		if (errno == EPERM) {
+			/* No point in trying any further */
+			g_info ("Not allowed to set up filesystem marks, using per-directory marks");
+			monitor->use_filesystem_marks = FALSE;
+		} else {
+			g_info ("Could not set up filesystem mark for '%s': %m", path);
+		}
+
+		close (filesystem->mount_fd);
+		filesystem->mount_fd = -1;
+	}
+
+	TRACKER_NOTE (MONITORS, g_message ("Added filesystem mark for path:'%s': %s",
+	                                   path,
+	                                   filesystem->mount_fd >= 0 ? "yes" : "no"));
+
+	/* Also remember failures, so they fall back without retrying */
+	g_hash_table_insert (monitor->filesystems, &filesystem->fsid, filesystem);
+
+	return filesystem->mount_fd >= 0 ? filesystem : NULL;
+}
+
+static MonitoredFile *
+monitored_file_new_for_filesystem (TrackerMonitorFanotify *monitor,
+                                   MonitoredFilesystem    *filesystem,
+                                   GFile                  *file)
+{
+	MonitoredFile *data;
+
+	data = g_slice_alloc0 (sizeof (MonitoredFile));
+	data->monitor = monitor;
+	data->file = g_object_ref (file);
+	data->filesystem = filesystem;
+	filesystem->n_folders++;
+
+	return data;
+}
+
 static MonitoredFile *
 monitored_file_new (TrackerMonitorFanotify *monitor,
                     GFile                  *file)
@@ -653,6 +950,7 @@ retry:
 	}
 
 	data->handle_bytes = create_bytes_for_handle (&data->handle);
+	monitor->n_marks++;
 
 	return data;
 }
@@ -663,8 +961,24 @@ monitored_file_free (MonitoredFile *data)
 	if (!data)
 		return;
 
+	if (data->filesystem) {
+		MonitoredFilesystem *filesystem = data->filesystem;
+
+		/* Drop the filesystem mark along with its last folder,
+		 * so the filesystem is not kept busy.
+		 */
+		filesystem->n_folders--;
+		if (filesystem->n_folders == 0)
+			g_hash_table_remove (data->monitor->filesystems, &filesystem->fsid);
+
+		g_object_unref (data->file);
+		g_slice_free1 (sizeof (MonitoredFile), data);
+		return;
+	}
+
 	g_bytes_unref (data->handle_bytes);
 	remove_mark (data->monitor, data->file);
+	data->monitor->n_marks--;
 	g_object_unref (data->file);
 	g_slice_free1 (sizeof (MonitoredFile) +
 	               data->handle.handle.handle_bytes, data);
@@ -675,12 +989,26 @@ tracker_monitor_fanotify_add (TrackerMonitor *object,
                               GFile          *file)
 {
 	TrackerMonitorFanotify *monitor = TRACKER_MONITOR_FANOTIFY (object);
+	MonitoredFilesystem *filesystem = NULL;
 	MonitoredFile *data;
 
 	if (g_hash_table_contains (monitor->monitored_dirs, file))
 		return TRUE;
 
-	if (g_hash_table_size (monitor->monitored_dirs) > monitor->limit) {
+	if (monitor->enabled && monitor->use_filesystem_marks)
+		filesystem = ensure_filesystem_mark (monitor, file);
+
+	if (filesystem) {
+		/* Covered by the filesystem mark, events are filtered
+		 * against the monitored folders.
+		 */
+		data = monitored_file_new_for_filesystem (monitor, filesystem, file);
+		g_hash_table_insert (monitor->monitored_dirs, g_object_ref (file), data);
+		tracker_monitor_dir_tree_add (monitor->dirs_tree, file);
+		return TRUE;
+	}
+
+	if (monitor->n_marks > monitor->limit) {
 		monitor->ignored++;
 		return FALSE;
 	}
@@ -705,6 +1033,8 @@ tracker_monitor_fanotify_add (TrackerMonitor *object,
 		g_hash_table_insert (monitor->monitored_dirs, g_object_ref (file), NULL);
 	}
 
+	tracker_monitor_dir_tree_add (monitor->dirs_tree, file);
+
 	return TRUE;
 }
 
@@ -717,31 +1047,22 @@ tracker_monitor_fanotify_remove (TrackerMonitor *object,
 
 	data = g_hash_table_lookup (monitor->monitored_dirs, file);
 	if (data) {
-		g_hash_table_remove (monitor->handles, data->handle_bytes);
+		if (data->handle_bytes)
+			g_hash_table_remove (monitor->handles, data->handle_bytes);
 		TRACKER_NOTE (MONITORS, g_message ("Removed monitor for path:'%s', total monitors:%d",
 		                                   g_file_peek_path (file),
 		                                   g_hash_table_size (monitor->monitored_dirs) - 1));
 	}
 
-	if (g_hash_table_remove (monitor->monitored_dirs, file))
+	if (g_hash_table_remove (monitor->monitored_dirs, file)) {
+		tracker_monitor_dir_tree_remove (monitor->dirs_tree, file);
 		return TRUE;
+	}
 
 	return TRACKER_MONITOR_CLASS (tracker_monitor_fanotify_parent_class)->remove (object,
 	                                                                              file);
 }
 
-/* If @is_strict is %TRUE, return %TRUE iff @file is a child of @prefix.
- * If @is_strict is %FALSE, additionally return %TRUE if @file equals @prefix.
- */
-static gboolean
-file_has_maybe_strict_prefix (GFile    *file,
-                              GFile    *prefix,
-                              gboolean  is_strict)
-{
-	return (g_file_has_prefix (file, prefix) ||
-	        (!is_strict && g_file_equal (file, prefix)));
-}
-
 static gboolean
 tracker_monitor_fanotify_remove_recursively (TrackerMonitor *object,
                                              GFile          *file,
@@ -749,9 +1070,8 @@ tracker_monitor_fanotify_remove_recursively (TrackerMonitor *object,
 {
 	TrackerMonitorFanotify *monitor = TRACKER_MONITOR_FANOTIFY (object);
 	MonitoredFile *data;
-	GHashTableIter iter;
 	guint items_removed = 0;
-	GFile *f;
+	GList *files, *l;
 	gchar *uri;
 
 	if (!g_hash_table_contains (monitor->monitored_dirs, file)) {
@@ -760,17 +1080,19 @@ tracker_monitor_fanotify_remove_recursively (TrackerMonitor *object,
 		                                                                                          only_children);
 	}
 
-	g_hash_table_iter_init (&iter, monitor->monitored_dirs);
-	while (g_hash_table_iter_next (&iter, (gpointer *) &f, (gpointer *) &data)) {
-		if (!file_has_maybe_strict_prefix (f, file, only_children))
-			continue;
+	files = tracker_monitor_dir_tree_steal_subtree (monitor->dirs_tree,
+	                                                file, !only_children);
 
-		if (data)
+	for (l = files; l; l = l->next) {
+		data = g_hash_table_lookup (monitor->monitored_dirs, l->data);
+		if (data && data->handle_bytes)
 			g_hash_table_remove (monitor->handles, data->handle_bytes);
-		g_hash_table_iter_remove (&iter);
+		g_hash_table_remove (monitor->monitored_dirs, l->data);
 		items_removed++;
 	}
 
+	g_list_free_full (files, g_object_unref);
+
 	uri = g_file_get_uri (file);
 	TRACKER_NOTE (MONITORS,
 	              g_message ("Removed all monitors %srecursively for path:'%s', )"
@@ -789,12 +1111,8 @@ tracker_monitor_fanotify_move (TrackerMonitor *object,
 {
 	TrackerMonitorFanotify *monitor = TRACKER_MONITOR_FANOTIFY (object);
 	MonitoredFile *data;
-	GHashTableIter iter;
-	gchar *old_prefix;
-	gpointer iter_file;
 	guint items_moved = 0;
-	GList *files = NULL;
-	GFile *f;
+	GList *files, *l, *new_files = NULL;
 
 	if (!g_hash_table_contains (monitor->monitored_dirs, old_file)) {
 		return TRACKER_MONITOR_CLASS (tracker_monitor_fanotify_parent_class)->move (object,
@@ -802,60 +1120,40 @@ tracker_monitor_fanotify_move (TrackerMonitor *object,
 		                                                                            new_file);
 	}
 
-	old_prefix = g_file_get_path (old_file);
-
 	/* Find out which subdirectories should have a file monitor added */
-	g_hash_table_iter_init (&iter, monitor->monitored_dirs);
-	while (g_hash_table_iter_next (&iter, &iter_file, (gpointer *) &data)) {
-		gchar *old_path, *new_path;
-		gchar *new_prefix;
-		gchar *p;
-
-		if (!file_has_maybe_strict_prefix (iter_file, old_file, FALSE))
-			continue;
+	files = tracker_monitor_dir_tree_steal_subtree (monitor->dirs_tree,
+	                                                old_file, FALSE);
 
-		old_path = g_file_get_path (iter_file);
-		p = strstr (old_path, old_prefix);
+	for (l = files; l; l = l->next) {
+		g_autofree gchar *relative_path = NULL;
 
-		if (!p || strcmp (p, old_prefix) == 0) {
-			g_free (old_path);
-			continue;
-		}
-
-		/* Move to end of prefix */
-		p += strlen (old_prefix) + 1;
+		relative_path = g_file_get_relative_path (old_file, l->data);
+		new_files = g_list_prepend (new_files,
+		                            g_file_resolve_relative_path (new_file,
+		                                                          relative_path));
+	}
 
-		/* Check this is not the end of the string */
-		if (*p == '\0') {
-			g_free (old_path);
-			continue;
-		}
+	/* Add the new locations before dropping the old ones, so
+	 * filesystem marks are not dropped along the way.
+	 */
+	for (l = new_files; l; l = l->next)
+		tracker_monitor_fanotify_add (object, l->data);
 
-		new_prefix = g_file_get_path (new_file);
-		new_path = g_build_path (G_DIR_SEPARATOR_S, new_prefix, p, NULL);
-		g_free (new_prefix);
+	g_list_free_full (new_files, g_object_unref);
 
-		f = g_file_new_for_path (new_path);
-		g_free (new_path);
+	for (l = files; l; l = l->next) {
+		data = g_hash_table_lookup (monitor->monitored_dirs, l->data);
 
-		files = g_list_prepend (files, g_object_ref (f));
-		if (data)
+		/* The new location may share the handle */
+		if (data && data->handle_bytes &&
+		    g_hash_table_lookup (monitor->handles, data->handle_bytes) == data)
 			g_hash_table_remove (monitor->handles, data->handle_bytes);
-		g_hash_table_iter_remove (&iter);
 
-		g_object_unref (f);
-		g_free (old_path);
+		g_hash_table_remove (monitor->monitored_dirs, l->data);
 		items_moved++;
 	}
 
-	while (files) {
-		f = files->data;
-		tracker_monitor_fanotify_add (object, f);
-		files = g_list_remove (files, files->data);
-		g_object_unref (f);
-	}
-
-	g_free (old_prefix);
+	g_list_free_full (files, g_object_unref);
 
 	return items_moved > 0;
 }
@@ -923,6 +1221,7 @@ tracker_monitor_fanotify_init (TrackerMonitorFanotify *monitor)
 		                       (GEqualFunc) g_file_equal,
 		                       (GDestroyNotify) g_object_unref,
 		                       (GDestroyNotify) monitored_file_free);
+	monitor->dirs_tree = tracker_monitor_dir_tree_new ();
 	monitor->cached_events =
 		g_hash_table_new_full (g_file_hash,
 		                       (GEqualFunc) g_file_equal,
@@ -930,4 +1229,14 @@ tracker_monitor_fanotify_init (TrackerMonitorFanotify *monitor)
 		                       (GDestroyNotify) monitor_event_free);
 
 	monitor->handles = g_hash_table_new (g_bytes_hash, g_bytes_equal);
+	monitor->resolved_handles =
+		g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+		                       (GDestroyNotify) g_bytes_unref,
+		                       (GDestroyNotify) g_object_unref);
+	monitor->resolved_tree =
+		g_tree_new_full (tracker_uri_compare, NULL,
+		                 g_free, (GDestroyNotify) g_bytes_unref);
+	monitor->filesystems =
+		g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL,
+		                       (GDestroyNotify) monitored_filesystem_free);
 }
@@ -39,6 +39,7 @@ typedef struct TrackerMonitorGlibPrivate  TrackerMonitorGlibPrivate;
 
 struct TrackerMonitorGlibPrivate {
 	GHashTable    *monitored_dirs;
+	GTree         *dirs_tree;
 
 	gboolean       enabled;
 
@@ -56,6 +57,11 @@ struct TrackerMonitorGlibPrivate {
 		GMutex mutex;
 		GCond cond;
 		gint n_requests;
+
+		/* Events pending delivery to the owner context */
+		GMutex events_mutex;
+		GQueue pending_events;
+		gboolean flush_scheduled;
 	} thread;
 };
 
@@ -395,6 +401,7 @@ tracker_monitor_glib_init (TrackerMonitorGlib *object)
 		                       (GEqualFunc) g_file_equal,
 		                       (GDestroyNotify) g_object_unref,
 		                       NULL);
+	priv->dirs_tree = tracker_monitor_dir_tree_new ();
 
 	priv->thread.cached_events =
 		g_hash_table_new_full (g_file_hash,
@@ -410,6 +417,8 @@ tracker_monitor_glib_init (TrackerMonitorGlib *object)
 
 	g_mutex_init (&priv->thread.mutex);
 	g_cond_init (&priv->thread.cond);
+	g_mutex_init (&priv->thread.events_mutex);
+	g_queue_init (&priv->thread.pending_events);
 }
 
 static gboolean
@@ -445,7 +454,12 @@ tracker_monitor_glib_finalize (GObject *object)
 	g_clear_pointer (&priv->thread.cached_events, g_hash_table_unref);
 	g_clear_pointer (&priv->thread.monitors, g_hash_table_unref);
 
+	g_queue_clear_full (&priv->thread.pending_events,
+	                    (GDestroyNotify) monitor_event_free);
+	g_mutex_clear (&priv->thread.events_mutex);
+
 	g_hash_table_unref (priv->monitored_dirs);
+	g_tree_unref (priv->dirs_tree);
 
 	G_OBJECT_CLASS (tracker_monitor_glib_parent_class)->finalize (object);
 }
@@ -575,10 +589,8 @@ tracker_monitor_glib_move (TrackerMonitor *monitor,
                            GFile          *new_file)
 {
 	TrackerMonitorGlibPrivate *priv;
-	GHashTableIter iter;
-	MonitorRequest *request;
-	gchar *old_prefix;
-	gpointer iter_file;
+	MonitorRequest *add_request, *remove_request;
+	GList *files, *l;
 	guint items_moved = 0;
 
 	priv = tracker_monitor_glib_get_instance_private (TRACKER_MONITOR_GLIB (monitor));
@@ -593,66 +605,53 @@ tracker_monitor_glib_move (TrackerMonitor *monitor,
 	 * asynchronously on IN_IGNORE, so the opposite sequence
 	 * may possibly remove valid, just added, monitors.
 	 */
-	request = g_new0 (MonitorRequest, 1);
-	request->monitor = TRACKER_MONITOR_GLIB (monitor);
-	request->type = MONITOR_REQUEST_ADD;
+	add_request = g_new0 (MonitorRequest, 1);
+	add_request->monitor = TRACKER_MONITOR_GLIB (monitor);
+	add_request->type = MONITOR_REQUEST_ADD;
 
-	old_prefix = g_file_get_path (old_file);
+	remove_request = g_new0 (MonitorRequest, 1);
+	remove_request->monitor = TRACKER_MONITOR_GLIB (monitor);
+	remove_request->type = MONITOR_REQUEST_REMOVE;
 
-	/* Find out which subdirectories should have a file monitor added */
-	g_hash_table_iter_init (&iter, priv->monitored_dirs);
-	while (g_hash_table_iter_next (&iter, &iter_file, NULL)) {
-		GFile *f;
-		gchar *old_path, *new_path;
-		gchar *new_prefix;
-		gchar *p;
+	/* Only the moved hierarchy is visited */
+	files = tracker_monitor_dir_tree_steal_subtree (priv->dirs_tree,
+	                                                old_file, TRUE);
 
-		if (!g_file_has_prefix (iter_file, old_file) &&
-		    !g_file_equal (iter_file, old_file)) {
-			continue;
-		}
+	for (l = files; l; l = l->next) {
+		GFile *f = l->data;
+		g_autofree gchar *relative_path = NULL;
 
-		old_path = g_file_get_path (iter_file);
-		p = strstr (old_path, old_prefix);
+		g_hash_table_remove (priv->monitored_dirs, f);
+		relative_path = g_file_get_relative_path (old_file, f);
 
-		if (!p || strcmp (p, old_prefix) == 0) {
-			g_free (old_path);
-			continue;
-		}
+		if (relative_path) {
+			GFile *dest;
 
-		/* Move to end of prefix */
-		p += strlen (old_prefix) + 1;
-
-		/* Check this is not the end of the string */
-		if (*p == '\0') {
-			g_free (old_path);
-			continue;
+			dest = g_file_resolve_relative_path (new_file, relative_path);
+			g_hash_table_add (priv->monitored_dirs, g_object_ref (dest));
+			tracker_monitor_dir_tree_add (priv->dirs_tree, dest);
+			add_request->files = g_list_prepend (add_request->files, dest);
+			items_moved++;
 		}
 
-		new_prefix = g_file_get_path (new_file);
-		new_path = g_build_path (G_DIR_SEPARATOR_S, new_prefix, p, NULL);
-		g_free (new_prefix);
-
-		f = g_file_new_for_path (new_path);
-		g_free (new_path);
+		/* Pass on the reference */
+		remove_request->files = g_list_prepend (remove_request->files, f);
+	}
 
-		request->files = g_list_prepend (request->files, g_object_ref (f));
+	/* We reset this because now it is possible we have limit - 1 */
+	if (files)
+		priv->monitor_limit_warned = FALSE;
 
-		g_object_unref (f);
-		g_free (old_path);
-		items_moved++;
-	}
+	g_list_free (files);
 
 	/* Add a new monitor for the top level directory */
 	tracker_monitor_glib_add (monitor, new_file);
 
 	/* Add new monitors for all subdirectories */
-	monitor_request_queue (TRACKER_MONITOR_GLIB (monitor), request);
+	monitor_request_queue (TRACKER_MONITOR_GLIB (monitor), add_request);
 
-	/* Remove the monitor for the old top level directory hierarchy */
-	tracker_monitor_glib_remove_recursively (monitor, old_file, FALSE);
-
-	g_free (old_prefix);
+	/* Remove the monitors for the old top level directory hierarchy */
+	monitor_request_queue (TRACKER_MONITOR_GLIB (monitor), remove_request);
 
 	block_for_requests (TRACKER_MONITOR_GLIB (monitor));
 
@@ -660,7 +659,7 @@ tracker_monitor_glib_move (TrackerMonitor *monitor,
 }
 
 /* Executed in main thread */
-static gboolean
+static void
 emit_signal_for_event (MonitorEvent *event)
 {
 	TrackerMonitor *monitor = TRACKER_MONITOR (event->monitor);
@@ -689,6 +688,102 @@ emit_signal_for_event (MonitorEvent *event)
 		           event->event_type);
 		break;
 	}
+}
+
+/* Returns TRUE if @event adds nothing to @prev, an earlier event
+ * on the same file in the same batch. @prev may be upgraded in place.
+ */
+static gboolean
+coalesce_event (MonitorEvent *prev,
+                MonitorEvent *event)
+{
+	if (event->event_type == G_FILE_MONITOR_EVENT_CHANGED) {
+		if (prev->event_type == G_FILE_MONITOR_EVENT_CREATED ||
+		    prev->event_type == G_FILE_MONITOR_EVENT_CHANGED)
+			return TRUE;
+
+		if (prev->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
+			/* Content updates also refresh attributes */
+			prev->event_type = G_FILE_MONITOR_EVENT_CHANGED;
+			return TRUE;
+		}
+	} else if (event->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
+		if (prev->event_type == G_FILE_MONITOR_EVENT_CREATED ||
+		    prev->event_type == G_FILE_MONITOR_EVENT_CHANGED ||
+		    prev->event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Executed in main thread */
+static gboolean
+flush_pending_events (TrackerMonitorGlib *monitor)
+{
+	TrackerMonitorGlibPrivate *priv;
+	GHashTable *last_events;
+	MonitorEvent *event, *prev;
+	GQueue batch;
+	GList *l, *next;
+
+	priv = tracker_monitor_glib_get_instance_private (monitor);
+
+	g_mutex_lock (&priv->thread.events_mutex);
+	batch = priv->thread.pending_events;
+	g_queue_init (&priv->thread.pending_events);
+	priv->thread.flush_scheduled = FALSE;
+	g_mutex_unlock (&priv->thread.events_mutex);
+
+	/* Merge updates on the same file within the batch, any
+	 * deletion or move ends the merging window for the files
+	 * involved. Directory deletes and moves end it for all files,
+	 * as they affect everything below.
+	 */
+	last_events = g_hash_table_new (g_file_hash,
+	                                (GEqualFunc) g_file_equal);
+
+	for (l = batch.head; l; l = next) {
+		next = l->next;
+		event = l->data;
+
+		switch (event->event_type) {
+		case G_FILE_MONITOR_EVENT_CHANGED:
+		case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+			prev = g_hash_table_lookup (last_events, event->file);
+
+			if (prev && coalesce_event (prev, event)) {
+				g_queue_delete_link (&batch, l);
+				monitor_event_free (event);
+				continue;
+			}
+
+			/* Fall through */
+		case G_FILE_MONITOR_EVENT_CREATED:
+			g_hash_table_insert (last_events, event->file, event);
+			break;
+		default:
+			if (event->is_directory) {
+				g_hash_table_remove_all (last_events);
+			} else {
+				g_hash_table_remove (last_events, event->file);
+				if (event->other_file)
+					g_hash_table_remove (last_events, event->other_file);
+			}
+			break;
+		}
+	}
+
+	g_hash_table_unref (last_events);
+
+	TRACKER_NOTE (MONITORS,
+	              g_message ("Emitting batch of %d monitor events",
+	                         batch.length));
+
+	while ((event = g_queue_pop_head (&batch)) != NULL) {
+		emit_signal_for_event (event);
+		monitor_event_free (event);
+	}
 
 	return G_SOURCE_REMOVE;
 }
@@ -703,17 +798,29 @@ queue_signal_for_event (TrackerMonitorGlib *monitor,
 {
 	TrackerMonitorGlibPrivate *priv;
 	MonitorEvent *event;
+	gboolean schedule;
 
 	priv = tracker_monitor_glib_get_instance_private (monitor);
 
 	event = monitor_event_new (monitor, file, other_file,
 	                           type, is_directory);
 
-	g_main_context_invoke_full (priv->thread.owner_context,
-	                            G_PRIORITY_HIGH,
-	                            (GSourceFunc) emit_signal_for_event,
-	                            event,
-	                            (GDestroyNotify) monitor_event_free);
+	/* Events are accumulated and delivered in batches, only
+	 * the first event after a flush wakes up the owner context.
+	 */
+	g_mutex_lock (&priv->thread.events_mutex);
+	g_queue_push_tail (&priv->thread.pending_events, event);
+	schedule = !priv->thread.flush_scheduled;
+	priv->thread.flush_scheduled = TRUE;
+	g_mutex_unlock (&priv->thread.events_mutex);
+
+	if (schedule) {
+		g_main_context_invoke_full (priv->thread.owner_context,
+		                            G_PRIORITY_HIGH,
+		                            (GSourceFunc) flush_pending_events,
+		                            g_object_ref (monitor),
+		                            g_object_unref);
+	}
 }
 
 /* Executed in monitor thread */
@@ -1080,6 +1187,7 @@ tracker_monitor_glib_add (TrackerMonitor *monitor,
 	}
 
 	g_hash_table_add (priv->monitored_dirs, g_object_ref (file));
+	tracker_monitor_dir_tree_add (priv->dirs_tree, file);
 
 	TRACKER_NOTE (MONITORS, g_message ("Added monitor for path:'%s', total monitors:%d",
 	                                   uri,
@@ -1104,6 +1212,8 @@ tracker_monitor_glib_remove (TrackerMonitor *monitor,
 		MonitorRequest *request;
 		gchar *uri;
 
+		tracker_monitor_dir_tree_remove (priv->dirs_tree, file);
+
 		request = g_new0 (MonitorRequest, 1);
 		request->monitor = TRACKER_MONITOR_GLIB (monitor);
 		request->files = g_list_prepend (NULL, g_object_ref (file));
@@ -1123,28 +1233,15 @@ tracker_monitor_glib_remove (TrackerMonitor *monitor,
 	return removed;
 }
 
-/* If @is_strict is %TRUE, return %TRUE iff @file is a child of @prefix.
- * If @is_strict is %FALSE, additionally return %TRUE if @file equals @prefix.
- */
-static gboolean
-file_has_maybe_strict_prefix (GFile    *file,
-                              GFile    *prefix,
-                              gboolean  is_strict)
-{
-	return (g_file_has_prefix (file, prefix) ||
-	        (!is_strict && g_file_equal (file, prefix)));
-}
-
 static gboolean
 remove_recursively (TrackerMonitorGlib *monitor,
                     GFile              *file,
                     gboolean            remove_top_level)
 {
 	TrackerMonitorGlibPrivate *priv;
-	GHashTableIter iter;
 	MonitorRequest *request;
-	gpointer iter_file;
 	guint items_removed = 0;
+	GList *l;
 	gchar *uri;
 
 	g_return_val_if_fail (TRACKER_IS_MONITOR (monitor), FALSE);
@@ -1155,16 +1252,12 @@ remove_recursively (TrackerMonitorGlib *monitor,
 	request = g_new0 (MonitorRequest, 1);
 	request->monitor = monitor;
 	request->type = MONITOR_REQUEST_REMOVE;
+	request->files = tracker_monitor_dir_tree_steal_subtree (priv->dirs_tree,
+	                                                         file,
+	                                                         remove_top_level);
 
-	g_hash_table_iter_init (&iter, priv->monitored_dirs);
-	while (g_hash_table_iter_next (&iter, &iter_file, NULL)) {
-		if (!file_has_maybe_strict_prefix (iter_file, file,
-		                                   !remove_top_level)) {
-			continue;
-		}
-
-		request->files = g_list_prepend (request->files, g_object_ref (file));
-		g_hash_table_iter_remove (&iter);
+	for (l = request->files; l; l = l->next) {
+		g_hash_table_remove (priv->monitored_dirs, l->data);
 		items_removed++;
 	}
 
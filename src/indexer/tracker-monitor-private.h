@@ -39,3 +39,17 @@ void tracker_monitor_emit_moved (TrackerMonitor *monitor,
                                  GFile          *file,
                                  GFile          *other_file,
                                  gboolean        is_directory);
+
+/* Watched folders sorted by URI, so subtrees can be looked up
+ * without walking all monitored folders.
+ */
+GTree * tracker_monitor_dir_tree_new (void);
+
+void tracker_monitor_dir_tree_add (GTree *tree,
+                                   GFile *file);
+void tracker_monitor_dir_tree_remove (GTree *tree,
+                                      GFile *file);
+
+GList * tracker_monitor_dir_tree_steal_subtree (GTree    *tree,
+                                                GFile    *file,
+                                                gboolean  include_top);
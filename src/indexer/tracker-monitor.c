@@ -21,8 +21,11 @@
 
 #include "config-miners.h"
 
+#include <string.h>
+
 #include "tracker-monitor.h"
 #include "tracker-monitor-private.h"
+#include "tracker-utils.h"
 
 #include "tracker-monitor-glib.h"
 #include "tracker-monitor-fanotify.h"
@@ -292,6 +295,73 @@ tracker_monitor_emit_moved (TrackerMonitor *monitor,
 	               is_directory, TRUE);
 }
 
+GTree *
+tracker_monitor_dir_tree_new (void)
+{
+	return g_tree_new_full (tracker_uri_compare, NULL,
+	                        g_free, g_object_unref);
+}
+
+void
+tracker_monitor_dir_tree_add (GTree *tree,
+                              GFile *file)
+{
+	g_tree_replace (tree, g_file_get_uri (file), g_object_ref (file));
+}
+
+void
+tracker_monitor_dir_tree_remove (GTree *tree,
+                                 GFile *file)
+{
+	g_autofree gchar *uri = NULL;
+
+	uri = g_file_get_uri (file);
+	g_tree_remove (tree, uri);
+}
+
+/* Removes @file and all folders below it from @tree, and returns
+ * those in a list, along with a reference. If @include_top is %FALSE,
+ * @file itself stays in the tree.
+ */
+GList *
+tracker_monitor_dir_tree_steal_subtree (GTree    *tree,
+                                        GFile    *file,
+                                        gboolean  include_top)
+{
+	g_autofree gchar *uri = NULL;
+	g_autoptr (GPtrArray) keys = NULL;
+	GTreeNode *node;
+	GList *files = NULL;
+	gsize len;
+	guint i;
+
+	uri = g_file_get_uri (file);
+	len = strlen (uri);
+	keys = g_ptr_array_new ();
+
+	for (node = g_tree_lower_bound (tree, uri);
+	     node && tracker_uri_is_nested (g_tree_node_key (node), uri, len);
+	     node = g_tree_node_next (node)) {
+		const gchar *key = g_tree_node_key (node);
+
+		if (!include_top && key[len] == '\0')
+			continue;
+
+		g_ptr_array_add (keys, (gpointer) key);
+		files = g_list_prepend (files, g_tree_node_value (node));
+	}
+
+	/* Steal the nodes so the references are passed on */
+	for (i = 0; i < keys->len; i++) {
+		gchar *key = g_ptr_array_index (keys, i);
+
+		g_tree_steal (tree, key);
+		g_free (key);
+	}
+
+	return files;
+}
+
 TrackerMonitor *
 tracker_monitor_new (GError **error)
 {
@@ -21,6 +21,8 @@
 
 #include "config-miners.h"
 
+#include <string.h>
+
 #include "tracker-sparql-buffer.h"
 
 #include <tracker-common.h>
@@ -28,6 +30,12 @@
 #include "tracker-utils.h"
 
 #define DEFAULT_GRAPH "tracker:FileSystem"
+#define EXTRACTION_QUEUE_GRAPH "tracker:ExtractionQueue"
+
+/* Bounds for the adaptive batch limit, and commit time it aims at */
+#define MIN_LIMIT 50
+#define MAX_LIMIT_FACTOR 8
+#define DEFAULT_TARGET_LATENCY_MS 500
 
 typedef struct _SparqlTaskData SparqlTaskData;
 typedef struct _UpdateBatchData UpdateBatchData;
@@ -37,6 +45,8 @@ enum {
 	PROP_CONNECTION,
 	PROP_ROOT,
 	PROP_LIMIT,
+	PROP_MAX_BATCHES,
+	PROP_TARGET_LATENCY,
 	N_PROPS,
 };
 
@@ -48,13 +58,37 @@ struct _TrackerSparqlBuffer
 
 	TrackerSparqlConnection *connection;
 	GPtrArray *tasks;
-	gint n_updates;
 	unsigned int limit;
+	unsigned int batch_limit; /* Adaptive limit, starts at limit */
+	unsigned int max_limit;
+	unsigned int max_batches;
+	unsigned int target_latency_ms;
 	TrackerBatch *batch;
 
+	/* Serialized size (in properties) of the tasks in the current batch */
+	unsigned int size;
+
+	/* Commit statistics */
+	gint64 last_commit_time;
+	gdouble usec_per_unit;
+	gdouble units_per_task;
+	guint64 n_batches;
+	guint64 n_committed_tasks;
+	gdouble total_commit_time;
+
+	/* Batches being executed, in flushing order */
+	GQueue in_flight;
+	/* Files in the batches being executed, and the subset of
+	 * those being deleted or moved. Both map URIs to a count,
+	 * sorted so subtrees can be looked up.
+	 */
+	GTree *in_flight_files;
+	GTree *in_flight_removals;
+
 	TrackerSparqlStatement *delete_file;
 	TrackerSparqlStatement *delete_file_content;
 	TrackerSparqlStatement *delete_content;
+	TrackerSparqlStatement *dequeue_file;
 	TrackerSparqlStatement *move_file;
 	TrackerSparqlStatement *move_content;
 	TrackerSparqlStatement *cleanup_audio_album_discs;
@@ -72,6 +106,7 @@ enum {
 struct _SparqlTaskData
 {
 	guint type;
+	guint size;
 	GFile *file;
 
 	union {
@@ -81,6 +116,7 @@ struct _SparqlTaskData
 		} resource;
 		struct {
 			TrackerSparqlStatement *stmt;
+			GFile *source;
 		} stmt;
 	} d;
 };
@@ -89,6 +125,10 @@ struct _UpdateBatchData {
 	TrackerSparqlBuffer *buffer;
 	GPtrArray *tasks;
 	TrackerBatch *batch;
+	GError *error;
+	gint64 flush_time;
+	unsigned int size;
+	guint finished : 1;
 };
 
 static void sparql_task_data_free (SparqlTaskData *data);
@@ -103,10 +143,13 @@ tracker_sparql_buffer_finalize (GObject *object)
 	g_object_unref (sparql_buffer->delete_file);
 	g_object_unref (sparql_buffer->delete_file_content);
 	g_object_unref (sparql_buffer->delete_content);
+	g_object_unref (sparql_buffer->dequeue_file);
 	g_object_unref (sparql_buffer->move_file);
 	g_object_unref (sparql_buffer->move_content);
 	g_object_unref (sparql_buffer->connection);
 	g_clear_object (&sparql_buffer->root);
+	g_tree_unref (sparql_buffer->in_flight_files);
+	g_tree_unref (sparql_buffer->in_flight_removals);
 	g_clear_object (&sparql_buffer->cleanup_audio_album_discs);
 	g_clear_object (&sparql_buffer->cleanup_audio_albums);
 	g_clear_object (&sparql_buffer->cleanup_audio_artists);
@@ -132,6 +175,33 @@ tracker_sparql_buffer_set_property (GObject      *object,
 	case PROP_LIMIT:
 		sparql_buffer->limit = g_value_get_uint (value);
 		break;
+	case PROP_MAX_BATCHES:
+		sparql_buffer->max_batches = g_value_get_uint (value);
+		break;
+	case PROP_TARGET_LATENCY:
+		sparql_buffer->target_latency_ms = g_value_get_uint (value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
+		break;
+	}
+}
+
+static void
+tracker_sparql_buffer_get_property (GObject    *object,
+                                    guint       param_id,
+                                    GValue     *value,
+                                    GParamSpec *pspec)
+{
+	TrackerSparqlBuffer *sparql_buffer = TRACKER_SPARQL_BUFFER (object);
+
+	switch (param_id) {
+	case PROP_MAX_BATCHES:
+		g_value_set_uint (value, sparql_buffer->max_batches);
+		break;
+	case PROP_TARGET_LATENCY:
+		g_value_set_uint (value, sparql_buffer->target_latency_ms);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, param_id, pspec);
 		break;
@@ -143,12 +213,21 @@ tracker_sparql_buffer_constructed (GObject *object)
 {
 	TrackerSparqlBuffer *sparql_buffer = TRACKER_SPARQL_BUFFER (object);
 
+	/* The initial limit is a starting point, the adaptive
+	 * limit can grow up to a few times that.
+	 */
+	sparql_buffer->max_limit =
+		MAX (sparql_buffer->limit * MAX_LIMIT_FACTOR, MIN_LIMIT);
+	sparql_buffer->batch_limit = sparql_buffer->limit;
+
 	sparql_buffer->delete_file =
 		tracker_load_statement (sparql_buffer->connection, "delete-file.rq", NULL);
 	sparql_buffer->delete_file_content =
 		tracker_load_statement (sparql_buffer->connection, "delete-file-content.rq", NULL);
 	sparql_buffer->delete_content =
 		tracker_load_statement (sparql_buffer->connection, "delete-folder-contents.rq", NULL);
+	sparql_buffer->dequeue_file =
+		tracker_load_statement (sparql_buffer->connection, "dequeue-file.rq", NULL);
 	sparql_buffer->move_file =
 		tracker_load_statement (sparql_buffer->connection, "move-file.rq", NULL);
 	sparql_buffer->move_content =
@@ -170,6 +249,7 @@ tracker_sparql_buffer_class_init (TrackerSparqlBufferClass *klass)
 
 	object_class->finalize = tracker_sparql_buffer_finalize;
 	object_class->set_property = tracker_sparql_buffer_set_property;
+	object_class->get_property = tracker_sparql_buffer_get_property;
 	object_class->constructed = tracker_sparql_buffer_constructed;
 
 	props[PROP_CONNECTION] =
@@ -190,6 +270,18 @@ tracker_sparql_buffer_class_init (TrackerSparqlBufferClass *klass)
 		                   G_PARAM_WRITABLE |
 		                   G_PARAM_CONSTRUCT_ONLY |
 		                   G_PARAM_STATIC_STRINGS);
+	props[PROP_MAX_BATCHES] =
+		g_param_spec_uint ("max-batches", NULL, NULL,
+		                   1, G_MAXUINT, 1,
+		                   G_PARAM_READWRITE |
+		                   G_PARAM_CONSTRUCT_ONLY |
+		                   G_PARAM_STATIC_STRINGS);
+	props[PROP_TARGET_LATENCY] =
+		g_param_spec_uint ("target-latency", NULL, NULL,
+		                   1, G_MAXUINT, DEFAULT_TARGET_LATENCY_MS,
+		                   G_PARAM_READWRITE |
+		                   G_PARAM_CONSTRUCT |
+		                   G_PARAM_STATIC_STRINGS);
 
 	g_object_class_install_properties (object_class, N_PROPS, props);
 }
@@ -197,16 +289,23 @@ tracker_sparql_buffer_class_init (TrackerSparqlBufferClass *klass)
 static void
 tracker_sparql_buffer_init (TrackerSparqlBuffer *buffer)
 {
+	g_queue_init (&buffer->in_flight);
+	buffer->in_flight_files =
+		g_tree_new_full (tracker_uri_compare, NULL, g_free, NULL);
+	buffer->in_flight_removals =
+		g_tree_new_full (tracker_uri_compare, NULL, g_free, NULL);
 }
 
 TrackerSparqlBuffer *
 tracker_sparql_buffer_new (TrackerSparqlConnection *connection,
                            guint                    limit,
+                           guint                    max_batches,
                            GFile                   *root)
 {
 	return g_object_new (TRACKER_TYPE_SPARQL_BUFFER,
 	                     "connection", connection,
 	                     "limit", limit,
+	                     "max-batches", max_batches,
 	                     "root", root,
 	                     NULL);
 }
@@ -217,36 +316,308 @@ update_batch_data_free (UpdateBatchData *batch_data)
 	g_object_unref (batch_data->batch);
 
 	g_ptr_array_unref (batch_data->tasks);
+	g_clear_error (&batch_data->error);
 
 	g_slice_free (UpdateBatchData, batch_data);
 }
 
+static void
+file_count_add (GTree *tree,
+                GFile *file)
+{
+	gchar *uri;
+	guint count;
+
+	uri = g_file_get_uri (file);
+	count = GPOINTER_TO_UINT (g_tree_lookup (tree, uri));
+	g_tree_replace (tree, uri, GUINT_TO_POINTER (count + 1));
+}
+
+static void
+file_count_remove (GTree *tree,
+                   GFile *file)
+{
+	gchar *uri;
+	guint count;
+
+	uri = g_file_get_uri (file);
+	count = GPOINTER_TO_UINT (g_tree_lookup (tree, uri));
+
+	if (count <= 1) {
+		g_tree_remove (tree, uri);
+		g_free (uri);
+	} else {
+		g_tree_replace (tree, uri, GUINT_TO_POINTER (count - 1));
+	}
+}
+
+static gboolean
+file_tree_contains (GTree *tree,
+                    GFile *file)
+{
+	g_autofree gchar *uri = NULL;
+
+	uri = g_file_get_uri (file);
+
+	return g_tree_lookup_extended (tree, uri, NULL, NULL);
+}
+
+static gboolean
+sparql_task_is_removal (SparqlTaskData *task)
+{
+	/* Statements on files delete or move data around */
+	return task->type == TASK_TYPE_STMT && task->file != NULL;
+}
+
+static gboolean
+sparql_task_is_folder_removal (TrackerSparqlBuffer *buffer,
+                               SparqlTaskData      *task)
+{
+	return (task->type == TASK_TYPE_STMT &&
+	        (task->d.stmt.stmt == buffer->delete_content ||
+	         task->d.stmt.stmt == buffer->move_content));
+}
+
+static void
+sparql_buffer_track_tasks (TrackerSparqlBuffer *buffer,
+                           GPtrArray           *tasks,
+                           gboolean             track)
+{
+	void (* func) (GTree *, GFile *);
+	guint i;
+
+	func = track ? file_count_add : file_count_remove;
+
+	for (i = 0; i < tasks->len; i++) {
+		SparqlTaskData *task = g_ptr_array_index (tasks, i);
+
+		if (!task->file)
+			continue;
+
+		func (buffer->in_flight_files, task->file);
+
+		if (sparql_task_is_removal (task)) {
+			func (buffer->in_flight_removals, task->file);
+
+			if (task->d.stmt.source) {
+				func (buffer->in_flight_files, task->d.stmt.source);
+				func (buffer->in_flight_removals, task->d.stmt.source);
+			}
+		}
+	}
+}
+
+static gboolean
+file_tree_has_descendant (GTree *tree,
+                          GFile *folder)
+{
+	g_autofree gchar *uri = NULL;
+	GTreeNode *node;
+	gsize len;
+
+	uri = g_file_get_uri (folder);
+	len = strlen (uri);
+
+	/* The folder subtree comes right after the folder itself */
+	for (node = g_tree_lower_bound (tree, uri);
+	     node && tracker_uri_is_nested (g_tree_node_key (node), uri, len);
+	     node = g_tree_node_next (node)) {
+		const gchar *key = g_tree_node_key (node);
+
+		if (key[len] != '\0')
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+file_tree_has_ancestor (GTree *tree,
+                        GFile *file)
+{
+	g_autofree gchar *uri = NULL;
+	gchar *sep, saved;
+
+	uri = g_file_get_uri (file);
+
+	if (g_tree_lookup_extended (tree, uri, NULL, NULL))
+		return TRUE;
+
+	/* Look up every parent folder, from the top */
+	for (sep = strchr (uri, '/'); sep; sep = strchr (sep + 1, '/')) {
+		gchar *end = sep;
+
+		/* Keep the separator on root URIs, e.g. file:/// */
+		if (sep > uri && sep[-1] == '/')
+			end = sep + 1;
+
+		if (*end == '\0')
+			break;
+
+		saved = *end;
+		*end = '\0';
+
+		if (g_tree_lookup_extended (tree, uri, NULL, NULL))
+			return TRUE;
+
+		*end = saved;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+sparql_buffer_depends_on_in_flight (TrackerSparqlBuffer *buffer)
+{
+	guint i;
+
+	if (g_queue_is_empty (&buffer->in_flight))
+		return FALSE;
+
+	/* Deletes and moves must not overtake pending changes on the
+	 * same files, and changes must not overtake pending deletes
+	 * and moves on the same files (or their parent folders).
+	 */
+	for (i = 0; i < buffer->tasks->len; i++) {
+		SparqlTaskData *task = g_ptr_array_index (buffer->tasks, i);
+
+		if (!task->file)
+			continue;
+
+		if (sparql_task_is_removal (task)) {
+			GFile *folder;
+
+			if (file_tree_contains (buffer->in_flight_files, task->file))
+				return TRUE;
+			if (task->d.stmt.source &&
+			    file_tree_contains (buffer->in_flight_files, task->d.stmt.source))
+				return TRUE;
+
+			if (sparql_task_is_folder_removal (buffer, task)) {
+				folder = task->d.stmt.source ? task->d.stmt.source : task->file;
+
+				if (file_tree_has_descendant (buffer->in_flight_files, folder))
+					return TRUE;
+			}
+		} else if (g_tree_nnodes (buffer->in_flight_removals) > 0 &&
+		           file_tree_has_ancestor (buffer->in_flight_removals, task->file)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+sparql_buffer_return_finished_batches (TrackerSparqlBuffer *buffer)
+{
+	GTask *task;
+
+	/* Batches are returned in the same order they were flushed */
+	while ((task = g_queue_peek_head (&buffer->in_flight)) != NULL) {
+		UpdateBatchData *update_data;
+
+		update_data = g_task_get_task_data (task);
+		if (!update_data->finished)
+			break;
+
+		g_queue_pop_head (&buffer->in_flight);
+		sparql_buffer_track_tasks (buffer, update_data->tasks, FALSE);
+
+		if (update_data->error)
+			g_task_return_error (task, g_steal_pointer (&update_data->error));
+		else
+			g_task_return_boolean (task, TRUE);
+
+		g_object_unref (task);
+	}
+}
+
+static void
+sparql_buffer_set_batch_limit (TrackerSparqlBuffer *buffer,
+                               unsigned int         batch_limit)
+{
+	buffer->batch_limit = CLAMP (batch_limit, MIN_LIMIT, buffer->max_limit);
+}
+
+static void
+sparql_buffer_update_limit (TrackerSparqlBuffer *buffer,
+                            UpdateBatchData     *update_data)
+{
+	gint64 now, start;
+	gdouble elapsed, units_per_task, usec_per_unit, ideal;
+	unsigned int n_tasks, size;
+
+	n_tasks = update_data->tasks->len;
+	size = MAX (update_data->size, 1);
+
+	/* Batches are committed one after another, so do not account
+	 * for the time spent waiting on the previous batch.
+	 */
+	now = g_get_monotonic_time ();
+	start = MAX (update_data->flush_time, buffer->last_commit_time);
+	buffer->last_commit_time = now;
+	elapsed = MAX (now - start, 1);
+
+	buffer->n_batches++;
+	buffer->n_committed_tasks += n_tasks;
+	buffer->total_commit_time += elapsed / G_USEC_PER_SEC;
+
+	/* Keep a moving average of the cost of each serialized unit,
+	 * and the average size of tasks.
+	 */
+	usec_per_unit = elapsed / size;
+	units_per_task = (gdouble) size / n_tasks;
+
+	if (buffer->usec_per_unit == 0) {
+		buffer->usec_per_unit = usec_per_unit;
+		buffer->units_per_task = units_per_task;
+	} else {
+		buffer->usec_per_unit = (3 * buffer->usec_per_unit + usec_per_unit) / 4;
+		buffer->units_per_task = (3 * buffer->units_per_task + units_per_task) / 4;
+	}
+
+	/* Move the limit towards the amount of tasks that can be
+	 * committed within the target latency.
+	 */
+	ideal = (buffer->target_latency_ms * 1000.0) /
+		(buffer->usec_per_unit * buffer->units_per_task);
+	ideal = MIN (ideal, buffer->max_limit);
+	sparql_buffer_set_batch_limit (buffer, (buffer->batch_limit + ideal) / 2);
+
+	TRACKER_NOTE (STATISTICS,
+	              g_message ("(Sparql buffer) Committed %u tasks (%u properties) in %.3fs, limit is now %u",
+	                         n_tasks, update_data->size,
+	                         elapsed / G_USEC_PER_SEC, buffer->batch_limit));
+}
+
 static void
 batch_execute_cb (GObject      *object,
                   GAsyncResult *result,
                   gpointer      user_data)
 {
 	TrackerSparqlBuffer *buffer;
-	GError *error = NULL;
 	UpdateBatchData *update_data;
-	g_autoptr (GTask) task = NULL;
+	GTask *task;
 
 	task = user_data;
 	update_data = g_task_get_task_data (task);
 	buffer = TRACKER_SPARQL_BUFFER (update_data->buffer);
-	buffer->n_updates--;
 
 	TRACKER_NOTE (MINER_FS_EVENTS,
 	              g_message ("(Sparql buffer) Finished array-update with %u tasks",
 	                         update_data->tasks->len));
 
-	if (!tracker_batch_execute_finish (TRACKER_BATCH (object),
-	                                   result,
-	                                   &error)) {
-		g_task_return_error (task, error);
-	} else {
-		g_task_return_boolean (task, TRUE);
-	}
+	if (tracker_batch_execute_finish (TRACKER_BATCH (object),
+	                                  result,
+	                                  &update_data->error))
+		sparql_buffer_update_limit (buffer, update_data);
+	else
+		buffer->last_commit_time = g_get_monotonic_time ();
+
+	update_data->finished = TRUE;
+
+	sparql_buffer_return_finished_batches (buffer);
 }
 
 gboolean
@@ -258,7 +629,7 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 	UpdateBatchData *update_data;
 	GTask *task;
 
-	if (buffer->n_updates > 0) {
+	if (g_queue_get_length (&buffer->in_flight) >= buffer->max_batches) {
 		return FALSE;
 	}
 
@@ -267,17 +638,27 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 		return FALSE;
 	}
 
+	if (sparql_buffer_depends_on_in_flight (buffer)) {
+		TRACKER_NOTE (MINER_FS_EVENTS,
+		              g_message ("Delaying SPARQL buffer flush, depends on batches in flight"));
+		return FALSE;
+	}
+
 	TRACKER_NOTE (MINER_FS_EVENTS, g_message ("Flushing SPARQL buffer, reason: %s", reason));
 
 	update_data = g_slice_new0 (UpdateBatchData);
 	update_data->buffer = buffer;
 	update_data->tasks = g_steal_pointer (&buffer->tasks);
 	update_data->batch = g_steal_pointer (&buffer->batch);
+	update_data->size = buffer->size;
+	update_data->flush_time = g_get_monotonic_time ();
+	buffer->size = 0;
 
 	task = g_task_new (buffer, NULL, cb, user_data);
 	g_task_set_task_data (task, update_data, (GDestroyNotify) update_batch_data_free);
 
-	buffer->n_updates++;
+	sparql_buffer_track_tasks (buffer, update_data->tasks, TRUE);
+	g_queue_push_tail (&buffer->in_flight, task);
 
 	tracker_batch_execute_async (update_data->batch,
 	                             NULL,
@@ -294,6 +675,7 @@ sparql_buffer_push_task (TrackerSparqlBuffer *buffer,
 		buffer->tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) sparql_task_data_free);
 
 	g_ptr_array_add (buffer->tasks, task);
+	buffer->size += task->size;
 }
 
 static TrackerBatch *
@@ -307,6 +689,47 @@ tracker_sparql_buffer_get_current_batch (TrackerSparqlBuffer *buffer)
 	return buffer->batch;
 }
 
+static guint
+sparql_resource_get_size (TrackerResource *resource)
+{
+	GList *properties, *l;
+	guint size = 1;
+
+	/* Approximate the serialized size by the number of properties,
+	 * including those of nested resources.
+	 */
+	properties = tracker_resource_get_properties (resource);
+
+	for (l = properties; l; l = l->next) {
+		GList *values, *v;
+
+		values = tracker_resource_get_values (resource, l->data);
+
+		for (v = values; v; v = v->next) {
+			GValue *value = v->data;
+			TrackerResource *child;
+
+			if (G_VALUE_HOLDS (value, TRACKER_TYPE_RESOURCE)) {
+				child = g_value_get_object (value);
+
+				/* Blank nodes are serialized inline */
+				if (child && tracker_resource_is_blank_node (child)) {
+					size += sparql_resource_get_size (child);
+					continue;
+				}
+			}
+
+			size++;
+		}
+
+		g_list_free (values);
+	}
+
+	g_list_free (properties);
+
+	return size;
+}
+
 static SparqlTaskData *
 sparql_task_data_new_resource (GFile           *file,
                                const gchar     *graph,
@@ -319,20 +742,24 @@ sparql_task_data_new_resource (GFile           *file,
 	task_data->type = TASK_TYPE_RESOURCE;
 	task_data->d.resource.resource = g_object_ref (resource);
 	task_data->d.resource.graph = g_strdup (graph);
+	task_data->size = sparql_resource_get_size (resource);
 
 	return task_data;
 }
 
 static SparqlTaskData *
 sparql_task_data_new_stmt (GFile                  *file,
+                           GFile                  *source,
                            TrackerSparqlStatement *stmt)
 {
 	SparqlTaskData *task_data;
 
 	task_data = g_slice_new0 (SparqlTaskData);
 	g_set_object (&task_data->file, file);
+	task_data->size = 1;
 	task_data->type = TASK_TYPE_STMT;
 	task_data->d.stmt.stmt = stmt;
+	g_set_object (&task_data->d.stmt.source, source);
 
 	return task_data;
 }
@@ -343,6 +770,8 @@ sparql_task_data_free (SparqlTaskData *data)
 	if (data->type == TASK_TYPE_RESOURCE) {
 		g_clear_object (&data->d.resource.resource);
 		g_free (data->d.resource.graph);
+	} else if (data->type == TASK_TYPE_STMT) {
+		g_clear_object (&data->d.stmt.source);
 	}
 
 	g_clear_object (&data->file);
@@ -439,11 +868,12 @@ tracker_sparql_buffer_flush_finish (TrackerSparqlBuffer  *buffer,
 static void
 push_stmt_task (TrackerSparqlBuffer    *buffer,
                 TrackerSparqlStatement *stmt,
-                GFile                  *file)
+                GFile                  *file,
+                GFile                  *source)
 {
 	SparqlTaskData *task;
 
-	task = sparql_task_data_new_stmt (file, stmt);
+	task = sparql_task_data_new_stmt (file, source, stmt);
 	sparql_buffer_push_task (buffer, task);
 }
 
@@ -460,7 +890,7 @@ tracker_sparql_buffer_log_statement (TrackerSparqlBuffer    *buffer,
 	batch = tracker_sparql_buffer_get_current_batch (buffer);
 	tracker_batch_add_statement (batch, stmt, NULL);
 
-	push_stmt_task (buffer, stmt, file);
+	push_stmt_task (buffer, stmt, file, NULL);
 }
 
 void
@@ -516,7 +946,7 @@ tracker_sparql_buffer_log_delete (TrackerSparqlBuffer *buffer,
 	tracker_batch_add_statement (batch, buffer->delete_file,
 	                             "uri", G_TYPE_STRING, uri,
 	                             NULL);
-	push_stmt_task (buffer, buffer->delete_file, file);
+	push_stmt_task (buffer, buffer->delete_file, file, NULL);
 }
 
 void
@@ -534,7 +964,7 @@ tracker_sparql_buffer_log_delete_content (TrackerSparqlBuffer *buffer,
 	tracker_batch_add_statement (batch, buffer->delete_content,
 	                             "uri", G_TYPE_STRING, uri,
 	                             NULL);
-	push_stmt_task (buffer, buffer->delete_content, file);
+	push_stmt_task (buffer, buffer->delete_content, file, NULL);
 }
 
 void
@@ -568,7 +998,7 @@ tracker_sparql_buffer_log_move (TrackerSparqlBuffer *buffer,
 	                             "newDataSource", G_TYPE_STRING, dest_data_source,
 	                             NULL);
 
-	push_stmt_task (buffer, buffer->move_file, dest);
+	push_stmt_task (buffer, buffer->move_file, dest, source);
 }
 
 void
@@ -592,7 +1022,7 @@ tracker_sparql_buffer_log_move_content (TrackerSparqlBuffer *buffer,
 	                             "destUri", G_TYPE_STRING, dest_uri,
 	                             NULL);
 
-	push_stmt_task (buffer, buffer->move_content, dest);
+	push_stmt_task (buffer, buffer->move_content, dest, source);
 }
 
 void
@@ -611,7 +1041,30 @@ tracker_sparql_buffer_log_clear_content (TrackerSparqlBuffer *buffer,
 	                             "uri", G_TYPE_STRING, uri,
 	                             NULL);
 
-	push_stmt_task (buffer, buffer->delete_file_content, file);
+	push_stmt_task (buffer, buffer->delete_file_content, file, NULL);
+}
+
+static void
+sparql_buffer_push_file (TrackerSparqlBuffer *buffer,
+                         GFile               *file,
+                         TrackerResource     *file_resource)
+{
+	tracker_sparql_buffer_push (buffer, file, DEFAULT_GRAPH, file_resource);
+
+	/* Files with an extractor hash need no extraction, these
+	 * might have been queued before.
+	 */
+	if (tracker_resource_get_first_string (file_resource,
+	                                       "tracker:extractorHash")) {
+		TrackerBatch *batch;
+
+		batch = tracker_sparql_buffer_get_current_batch (buffer);
+		tracker_batch_add_statement (batch, buffer->dequeue_file,
+		                             "uri", G_TYPE_STRING,
+		                             tracker_resource_get_identifier (file_resource),
+		                             NULL);
+		push_stmt_task (buffer, buffer->dequeue_file, NULL, NULL);
+	}
 }
 
 void
@@ -628,10 +1081,23 @@ tracker_sparql_buffer_log_file (TrackerSparqlBuffer *buffer,
 	g_return_if_fail (TRACKER_IS_RESOURCE (file_resource));
 	g_return_if_fail (!graph_resource || TRACKER_IS_RESOURCE (graph_resource));
 
-	tracker_sparql_buffer_push (buffer, file, DEFAULT_GRAPH, file_resource);
+	sparql_buffer_push_file (buffer, file, file_resource);
 
-	if (content_graph && graph_resource)
+	if (content_graph && graph_resource) {
 		tracker_sparql_buffer_push (buffer, file, content_graph, graph_resource);
+
+		/* Content without an extractor hash is pending extraction,
+		 * add it to the queue the extractor consumes.
+		 */
+		if (!tracker_resource_get_first_string (file_resource,
+		                                        "tracker:extractorHash")) {
+			g_autoptr (TrackerResource) queued = NULL;
+
+			queued = tracker_resource_new (tracker_resource_get_identifier (file_resource));
+			tracker_resource_add_uri (queued, "rdf:type", "nfo:FileDataObject");
+			tracker_sparql_buffer_push (buffer, file, EXTRACTION_QUEUE_GRAPH, queued);
+		}
+	}
 }
 
 void
@@ -664,7 +1130,7 @@ tracker_sparql_buffer_log_folder (TrackerSparqlBuffer *buffer,
 		}
 	}
 
-	tracker_sparql_buffer_push (buffer, file, DEFAULT_GRAPH, file_resource);
+	sparql_buffer_push_file (buffer, file, file_resource);
 	tracker_sparql_buffer_push (buffer, file, DEFAULT_GRAPH, folder_resource);
 }
 
@@ -683,7 +1149,7 @@ tracker_sparql_buffer_log_attributes_update (TrackerSparqlBuffer *buffer,
 	if (content_graph && graph_resource)
 		tracker_sparql_buffer_push (buffer, file, content_graph, graph_resource);
 
-	tracker_sparql_buffer_push (buffer, file, DEFAULT_GRAPH, file_resource);
+	sparql_buffer_push_file (buffer, file, file_resource);
 }
 
 gboolean
@@ -692,7 +1158,33 @@ tracker_sparql_buffer_limit_reached (TrackerSparqlBuffer *buffer)
 	if (!buffer->tasks)
 		return FALSE;
 
-	return buffer->tasks->len >= buffer->limit;
+	if (buffer->tasks->len >= buffer->batch_limit)
+		return TRUE;
+
+	/* Flush early if tasks are unusually large */
+	if (buffer->units_per_task > 0 &&
+	    buffer->size >= 2 * buffer->batch_limit * buffer->units_per_task)
+		return TRUE;
+
+	return FALSE;
+}
+
+unsigned int
+tracker_sparql_buffer_get_limit (TrackerSparqlBuffer *buffer)
+{
+	return buffer->batch_limit;
+}
+
+void
+tracker_sparql_buffer_log_statistics (TrackerSparqlBuffer *buffer)
+{
+	TRACKER_NOTE (STATISTICS,
+	              g_message ("SPARQL buffer: limit %u (%u-%u), %" G_GUINT64_FORMAT " batches, "
+	                         "%" G_GUINT64_FORMAT " tasks, %.2fs commit time, %.1f properties/task, %.1fus/property",
+	                         buffer->batch_limit, MIN_LIMIT, buffer->max_limit,
+	                         buffer->n_batches, buffer->n_committed_tasks,
+	                         buffer->total_commit_time,
+	                         buffer->units_per_task, buffer->usec_per_unit));
 }
 
 unsigned int
@@ -703,3 +1195,9 @@ tracker_sparql_buffer_get_size (TrackerSparqlBuffer *buffer)
 
 	return buffer->tasks->len;
 }
+
+unsigned int
+tracker_sparql_buffer_get_n_flushing (TrackerSparqlBuffer *buffer)
+{
+	return g_queue_get_length (&buffer->in_flight);
+}
@@ -40,6 +40,7 @@ G_DECLARE_FINAL_TYPE (TrackerSparqlBuffer,
 
 TrackerSparqlBuffer *tracker_sparql_buffer_new   (TrackerSparqlConnection *connection,
                                                   guint                    limit,
+                                                  guint                    max_batches,
                                                   GFile                   *root);
 
 gboolean             tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
@@ -92,8 +93,14 @@ void tracker_sparql_buffer_log_cleanup (TrackerSparqlBuffer        *buffer,
 
 gboolean tracker_sparql_buffer_limit_reached (TrackerSparqlBuffer *buffer);
 
+unsigned int tracker_sparql_buffer_get_limit (TrackerSparqlBuffer *buffer);
+
+void tracker_sparql_buffer_log_statistics (TrackerSparqlBuffer *buffer);
+
 unsigned int tracker_sparql_buffer_get_size (TrackerSparqlBuffer *buffer);
 
+unsigned int tracker_sparql_buffer_get_n_flushing (TrackerSparqlBuffer *buffer);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_MINER_SPARQL_BUFFER_H__ */
@@ -19,6 +19,8 @@
 
 #include "config-miners.h"
 
+#include <string.h>
+
 #include "tracker-utils.h"
 
 #define QUERY_RESOURCE "/org/freedesktop/Tracker3/Miner/Files/queries/"
@@ -37,3 +39,48 @@ tracker_load_statement (TrackerSparqlConnection  *conn,
 	                                                                NULL,
 	                                                                error);
 }
+
+static inline gint
+uri_char_rank (guchar c)
+{
+	/* Sort '/' right after the string end, so the contents
+	 * of a folder come right after the folder itself.
+	 */
+	if (c == '\0')
+		return 0;
+	else if (c == '/')
+		return 1;
+	else
+		return c + 1;
+}
+
+/* Sorts URIs so that every folder is followed by its whole subtree,
+ * usable as a GCompareDataFunc.
+ */
+gint
+tracker_uri_compare (gconstpointer a,
+                     gconstpointer b,
+                     gpointer      user_data)
+{
+	const guchar *str1 = a, *str2 = b;
+
+	while (*str1 && *str1 == *str2) {
+		str1++;
+		str2++;
+	}
+
+	return uri_char_rank (*str1) - uri_char_rank (*str2);
+}
+
+gboolean
+tracker_uri_is_nested (const gchar *uri,
+                       const gchar *prefix,
+                       gsize        prefix_len)
+{
+	if (strncmp (uri, prefix, prefix_len) != 0)
+		return FALSE;
+
+	return (uri[prefix_len] == '\0' ||
+	        uri[prefix_len] == '/' ||
+	        (prefix_len > 0 && prefix[prefix_len - 1] == '/'));
+}
@@ -29,6 +29,14 @@ TrackerSparqlStatement * tracker_load_statement (TrackerSparqlConnection  *conn,
                                                  const gchar              *query_filename,
                                                  GError                  **error);
 
+gint tracker_uri_compare (gconstpointer a,
+                          gconstpointer b,
+                          gpointer      user_data);
+
+gboolean tracker_uri_is_nested (const gchar *uri,
+                                const gchar *prefix,
+                                gsize        prefix_len);
+
 G_END_DECLS
 
 #endif /* __LIBTRACKER_MINER_UTILS_H__ */
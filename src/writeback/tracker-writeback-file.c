@@ -19,9 +19,18 @@
 
 #include "config-miners.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <fcntl.h> /* O_WRONLY */
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#ifdef HAVE_FICLONE
+#include <linux/fs.h>
+#endif
+
+#include <gio/gunixinputstream.h>
 #include <gio/gunixoutputstream.h>
 
 #include <tracker-common.h>
@@ -48,17 +57,140 @@ tracker_writeback_file_init (TrackerWritebackFile *writeback_file)
 {
 }
 
+typedef enum {
+	COPY_METHOD_CLONE,
+	COPY_METHOD_COPY_FILE_RANGE,
+	COPY_METHOD_STREAM,
+} CopyMethod;
+
+static const gchar *copy_method_names[] = {
+	"reflink",
+	"copy_file_range",
+	"stream copy",
+};
+
+/* Returns FALSE with no error set if copy_file_range() is not
+ * supported for these files, so the caller may fall back.
+ */
+static gboolean
+copy_file_range_all (int      in_fd,
+                     int      out_fd,
+                     GError **error)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+	struct stat st;
+	gsize copied = 0;
+
+	if (fstat (in_fd, &st) < 0)
+		return FALSE;
+
+	while (copied < (gsize) st.st_size) {
+		gssize n;
+
+		n = copy_file_range (in_fd, NULL, out_fd, NULL,
+		                     st.st_size - copied, 0);
+
+		if (n < 0) {
+			int saved_errno = errno;
+
+			if (saved_errno == EINTR)
+				continue;
+
+			/* Nothing was copied yet, fall back to other methods */
+			if (copied == 0 &&
+			    (saved_errno == EXDEV || saved_errno == ENOSYS ||
+			     saved_errno == EOPNOTSUPP || saved_errno == EINVAL ||
+			     saved_errno == EPERM))
+				return FALSE;
+
+			g_set_error (error,
+			             G_IO_ERROR,
+			             g_io_error_from_errno (saved_errno),
+			             "Could not copy file contents: %s",
+			             g_strerror (saved_errno));
+			return FALSE;
+		} else if (n == 0) {
+			/* Some filesystems report no data to copy, fall back
+			 * to other methods if nothing was copied yet.
+			 */
+			if (copied == 0)
+				return FALSE;
+
+			g_set_error (error,
+			             G_IO_ERROR,
+			             G_IO_ERROR_FAILED,
+			             "Could not copy file contents: short copy");
+			return FALSE;
+		}
+
+		copied += n;
+	}
+
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+static gboolean
+copy_file_contents (int          in_fd,
+                    int          out_fd,
+                    CopyMethod  *method_used,
+                    GError     **error)
+{
+	GInputStream *input_stream;
+	GOutputStream *output_stream;
+	GError *inner_error = NULL;
+
+#ifdef HAVE_FICLONE
+	/* Share the extents with the original file on CoW filesystems */
+	if (ioctl (out_fd, FICLONE, in_fd) == 0) {
+		*method_used = COPY_METHOD_CLONE;
+		return TRUE;
+	}
+#endif
+
+	/* Copy in the kernel, which may still reflink or do server-side copies */
+	if (copy_file_range_all (in_fd, out_fd, &inner_error)) {
+		*method_used = COPY_METHOD_COPY_FILE_RANGE;
+		return TRUE;
+	} else if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	*method_used = COPY_METHOD_STREAM;
+
+	input_stream = g_unix_input_stream_new (in_fd, FALSE);
+	output_stream = g_unix_output_stream_new (out_fd, FALSE);
+
+	/* Splice the original file into the tmp file */
+	g_output_stream_splice (output_stream,
+	                        input_stream,
+	                        G_OUTPUT_STREAM_SPLICE_NONE,
+	                        NULL, &inner_error);
+
+	g_object_unref (output_stream);
+	g_object_unref (input_stream);
+
+	if (inner_error) {
+		g_propagate_error (error, inner_error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static GFile *
 create_temporary_file (GFile      *file,
                        GFileInfo  *file_info,
                        GError    **in_error)
 {
-	GInputStream *input_stream;
-	GOutputStream *output_stream;
 	GFile *tmp_file, *parent;
-	gchar *dir, *name, *tmp_path;
+	gchar *dir, *name, *path, *tmp_path;
+	CopyMethod method;
 	guint32 mode;
-	gint fd;
+	gint in_fd, out_fd;
 	GError *error = NULL;
 
 	if (!g_file_is_native (file)) {
@@ -77,16 +209,25 @@ create_temporary_file (GFile      *file,
 		return NULL;
 	}
 
-	/* Create input stream */
-	input_stream = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+	/* Open the original file */
+	path = g_file_get_path (file);
+	in_fd = open (path, O_RDONLY | O_CLOEXEC);
 
-	if (error) {
+	if (in_fd < 0) {
+		int saved_errno = errno;
+
+		g_set_error (&error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (saved_errno),
+		             "Error opening file '%s': %s",
+		             path, g_strerror (saved_errno));
 		g_critical ("Could not create temporary file, %s", error->message);
 		g_propagate_error (in_error, error);
+		g_free (path);
 		return NULL;
 	}
 
-	/* Create output stream in a tmp file */
+	/* Create the tmp file */
 	parent = g_file_get_parent (file);
 	dir = g_file_get_path (parent);
 	g_object_unref (parent);
@@ -99,19 +240,39 @@ create_temporary_file (GFile      *file,
 
 	mode = g_file_info_get_attribute_uint32 (file_info,
 	                                         G_FILE_ATTRIBUTE_UNIX_MODE);
-	fd = g_mkstemp_full (tmp_path, O_WRONLY, mode);
+	out_fd = g_mkstemp_full (tmp_path, O_WRONLY, mode);
 
-	output_stream = g_unix_output_stream_new (fd, TRUE);
+	if (out_fd < 0) {
+		int saved_errno = errno;
 
-	/* Splice the original file into the tmp file */
-	g_output_stream_splice (output_stream,
-	                        input_stream,
-	                        G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
-	                        G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
-	                        NULL, &error);
+		g_set_error (&error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (saved_errno),
+		             "Error creating '%s': %s",
+		             tmp_path, g_strerror (saved_errno));
+		g_critical ("Could not create temporary file, %s", error->message);
+		g_propagate_error (in_error, error);
+		close (in_fd);
+		g_free (tmp_path);
+		g_free (path);
+		return NULL;
+	}
 
-	g_object_unref (output_stream);
-	g_object_unref (input_stream);
+	if (copy_file_contents (in_fd, out_fd, &method, &error))
+		g_debug ("Copied '%s' to temporary file using %s", path, copy_method_names[method]);
+
+	if (close (out_fd) < 0 && !error) {
+		int saved_errno = errno;
+
+		g_set_error (&error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (saved_errno),
+		             "Error closing '%s': %s",
+		             tmp_path, g_strerror (saved_errno));
+	}
+
+	close (in_fd);
+	g_free (path);
 
 	tmp_file = g_file_new_for_path (tmp_path);
 	g_free (tmp_path);
@@ -52,10 +52,14 @@ typedef struct {
 
 	guint expire_timeout_id;
 	gboolean expect_finished;
+	gint expect_priority;
 
 	FilesystemOperation *expect_results;
 	guint expect_n_results;
 
+	/* Folder to delete on the first update within it */
+	const gchar *delete_folder;
+
 	GList *ops;
 } TestCommonContext;
 
@@ -124,6 +128,17 @@ perform_file_operation (TestCommonContext *fixture,
 #define DELETE_FILE(fixture,p) perform_file_operation((fixture),"rm",(p),NULL)
 #define DELETE_FOLDER(fixture,p) perform_file_operation((fixture),"rm -rf",(p),NULL)
 
+static void
+check_event_priority (TestCommonContext   *fixture,
+                      TrackerFileNotifier *notifier)
+{
+	if (fixture->expect_priority < 0)
+		return;
+
+	g_assert_cmpint (tracker_file_notifier_get_event_priority (notifier),
+	                 ==, fixture->expect_priority);
+}
+
 static void
 file_notifier_file_created_cb (TrackerFileNotifier *notifier,
                                GFile               *file,
@@ -133,6 +148,8 @@ file_notifier_file_created_cb (TrackerFileNotifier *notifier,
 	TestCommonContext *fixture = user_data;
 	FilesystemOperation *op;
 
+	check_event_priority (fixture, notifier);
+
 	op = g_new0 (FilesystemOperation, 1);
 	op->op = OPERATION_CREATE;
 	op->path = g_file_get_relative_path (fixture->test_file , file);
@@ -155,12 +172,20 @@ file_notifier_file_updated_cb (TrackerFileNotifier *notifier,
 	TestCommonContext *fixture = user_data;
 	FilesystemOperation *op;
 
+	check_event_priority (fixture, notifier);
+
 	op = g_new0 (FilesystemOperation, 1);
 	op->op = OPERATION_UPDATE;
 	op->path = g_file_get_relative_path (fixture->test_file , file);
 
 	fixture->ops = g_list_prepend (fixture->ops, op);
 
+	if (fixture->delete_folder &&
+	    g_str_has_prefix (op->path, fixture->delete_folder)) {
+		DELETE_FOLDER (fixture, (gchar *) fixture->delete_folder);
+		fixture->delete_folder = NULL;
+	}
+
 	if (!fixture->expect_finished &&
 	    fixture->expect_n_results == g_list_length (fixture->ops)) {
 		g_main_loop_quit (fixture->main_loop);
@@ -177,6 +202,8 @@ file_notifier_file_deleted_cb (TrackerFileNotifier *notifier,
 	FilesystemOperation *op;
 	guint i;
 
+	check_event_priority (fixture, notifier);
+
 	op = g_new0 (FilesystemOperation, 1);
 	op->op = OPERATION_DELETE;
 	op->path = g_file_get_relative_path (fixture->test_file , file);
@@ -211,6 +238,8 @@ file_notifier_file_moved_cb (TrackerFileNotifier *notifier,
 	TestCommonContext *fixture = user_data;
 	FilesystemOperation *op;
 
+	check_event_priority (fixture, notifier);
+
 	op = g_new0 (FilesystemOperation, 1);
 	op->op = OPERATION_MOVE;
 	op->path = g_file_get_relative_path (fixture->test_file , file);
@@ -293,6 +322,7 @@ test_common_context_setup (TestCommonContext *fixture,
 	g_assert_no_error (error);
 
 	fixture->ops = NULL;
+	fixture->expect_priority = -1;
 
 	/* Create basic folders within the test location */
 	CREATE_FOLDER (fixture, "recursive");
@@ -795,6 +825,7 @@ test_file_notifier_monitor_updates_non_recursive (TestCommonContext *fixture,
 	test_common_context_index_dir (fixture, "non-recursive",
 	                               TRACKER_DIRECTORY_FLAG_NONE);
 
+	fixture->expect_priority = TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL;
 	tracker_file_notifier_start (fixture->notifier);
 	test_common_context_expect_results (fixture, expected_results,
 	                                    G_N_ELEMENTS (expected_results),
@@ -802,6 +833,7 @@ test_file_notifier_monitor_updates_non_recursive (TestCommonContext *fixture,
 	tracker_file_notifier_stop (fixture->notifier);
 
 	/* Perform file updates */
+	fixture->expect_priority = TRACKER_FILE_NOTIFIER_PRIORITY_LIVE;
 	tracker_file_notifier_start (fixture->notifier);
 	CREATE_UPDATE_FILE (fixture, "non-recursive/folder/aaa");
 	CREATE_UPDATE_FILE (fixture, "non-recursive/bbb");
@@ -865,6 +897,81 @@ test_file_notifier_monitor_updates_recursive (TestCommonContext *fixture,
 	tracker_file_notifier_stop (fixture->notifier);
 }
 
+static void
+test_file_notifier_crawling_delete_during_stat (TestCommonContext *fixture,
+                                                gconstpointer      data)
+{
+	GString *sparql;
+	GError *error = NULL;
+	gchar *root_uri, *name, *uri;
+	guint i;
+
+	CREATE_FOLDER (fixture, "recursive/folder");
+	CREATE_FOLDER (fixture, "recursive/other");
+
+	root_uri = g_strdup_printf ("file://%s/recursive", fixture->test_path);
+
+	/* Prefill the store with outdated content, so the crawl goes
+	 * through several batches of file info queries.
+	 */
+	sparql = g_string_new ("INSERT DATA { GRAPH tracker:FileSystem { ");
+	g_string_append_printf (sparql,
+	                        "<%s> a nfo:FileDataObject ; "
+	                        "  nie:url \"%s\" ; "
+	                        "  nfo:fileLastModified \"2000-01-01T00:00:00Z\" ; "
+	                        "  nie:dataSource <urn:test:root> ; "
+	                        "  nie:interpretedAs <urn:test:root> . "
+	                        "<urn:test:root> a nie:InformationElement, nfo:Folder, tracker:IndexedFolder ; "
+	                        "  nie:rootElementOf <urn:test:root> . ",
+	                        root_uri, root_uri);
+
+	for (i = 0; i < 1000; i++) {
+		name = g_strdup_printf ("recursive/%s/file%.4d",
+		                        i % 2 == 0 ? "folder" : "other", i);
+		CREATE_UPDATE_FILE (fixture, name);
+
+		uri = g_strdup_printf ("file://%s/%s", fixture->test_path, name);
+		g_string_append_printf (sparql,
+		                        "<%s> a nfo:FileDataObject ; "
+		                        "  nie:url \"%s\" ; "
+		                        "  nfo:fileLastModified \"2000-01-01T00:00:00Z\" ; "
+		                        "  nie:dataSource <urn:test:root> . ",
+		                        uri, uri);
+		g_free (uri);
+		g_free (name);
+	}
+
+	g_string_append (sparql, "} }");
+	tracker_sparql_connection_update (fixture->connection, sparql->str,
+	                                  NULL, &error);
+	g_assert_no_error (error);
+	g_string_free (sparql, TRUE);
+	g_free (root_uri);
+
+	test_common_context_index_dir (fixture, "recursive",
+	                               TRACKER_DIRECTORY_FLAG_RECURSE);
+
+	/* Delete the folder while its contents are being checked,
+	 * the crawl must still finish.
+	 */
+	fixture->delete_folder = "recursive/folder";
+	fixture->expect_finished = TRUE;
+	fixture->expire_timeout_id =
+		g_timeout_add_seconds (10, (GSourceFunc) timeout_expired_cb, fixture);
+
+	tracker_file_notifier_start (fixture->notifier);
+	g_main_loop_run (fixture->main_loop);
+
+	g_assert_cmpuint (fixture->expire_timeout_id, !=, 0);
+	g_source_remove (fixture->expire_timeout_id);
+	g_assert_null (fixture->delete_folder);
+
+	/* Events depend on the timing of the deletion, these are
+	 * dropped on teardown.
+	 */
+	tracker_file_notifier_stop (fixture->notifier);
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -888,6 +995,8 @@ main (gint    argc,
 	          test_file_notifier_crawling_root_removal1);
 	test_add ("/libtracker-miner/file-notifier/crawling-root-removal2",
 	          test_file_notifier_crawling_root_removal2);
+	test_add ("/libtracker-miner/file-notifier/crawling-delete-during-stat",
+	          test_file_notifier_crawling_delete_during_stat);
 
 	/* Config changes */
 	test_add ("/libtracker-miner/file-notifier/changes-remove-non-recursive",
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2011, Nokia <ivan.frade@nokia.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include "config-miners.h"
+
+#include <stdlib.h>
+#include <locale.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <tracker-indexer-private.h>
+
+/* Fixture struct */
+typedef struct {
+	GFile *test_file;
+	gchar *test_path;
+	gchar *rules_path;
+
+	TrackerSparqlConnection *connection;
+	TrackerIndexingTree *indexing_tree;
+
+	/* The indexer to test */
+	TrackerIndexer *indexer;
+} TestCommonContext;
+
+#define test_add(path,fun)	  \
+	g_test_add (path, \
+	            TestCommonContext, \
+	            NULL, \
+	            test_common_context_setup, \
+	            fun, \
+	            test_common_context_teardown)
+
+static void
+test_common_context_setup (TestCommonContext *fixture,
+                           gconstpointer      data)
+{
+	TrackerMonitor *monitor;
+	GFile *data_loc, *ontology;
+	GError *error = NULL;
+
+	fixture->test_path = g_build_filename (g_get_tmp_dir (),
+	                                       "tracker-test-XXXXXX",
+	                                       NULL);
+	fixture->test_path = g_mkdtemp (fixture->test_path);
+	fixture->test_file = g_file_new_for_path (fixture->test_path);
+
+	/* No extractor rules are needed to queue events */
+	fixture->rules_path = g_build_filename (fixture->test_path, "rules", NULL);
+	g_assert_cmpint (g_mkdir (fixture->rules_path, 0700), ==, 0);
+	g_setenv ("TRACKER_EXTRACTOR_RULES_DIR", fixture->rules_path, TRUE);
+
+	data_loc = g_file_get_child (fixture->test_file, ".data");
+	ontology = tracker_sparql_get_ontology_nepomuk ();
+	fixture->connection = tracker_sparql_connection_new (0, data_loc, ontology, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (data_loc);
+	g_object_unref (ontology);
+
+	fixture->indexing_tree = tracker_indexing_tree_new ();
+	monitor = tracker_monitor_new (NULL);
+
+	fixture->indexer = tracker_indexer_new (fixture->connection,
+	                                        fixture->indexing_tree,
+	                                        monitor,
+	                                        NULL,
+	                                        NULL,
+	                                        FALSE);
+
+	/* Keep events queued, so they are only handed out
+	 * through tracker_indexer_pop_next_file().
+	 */
+	tracker_miner_pause (TRACKER_MINER (fixture->indexer));
+
+	g_clear_object (&monitor);
+}
+
+static void
+test_common_context_teardown (TestCommonContext *fixture,
+                              gconstpointer      data)
+{
+	gchar *call;
+
+	g_clear_object (&fixture->indexer);
+	g_clear_object (&fixture->indexing_tree);
+	g_clear_object (&fixture->connection);
+
+	g_unsetenv ("TRACKER_EXTRACTOR_RULES_DIR");
+	g_free (fixture->rules_path);
+
+	call = g_strdup_printf ("rm -rf %s", fixture->test_path);
+	system (call);
+	g_free (call);
+
+	g_object_unref (fixture->test_file);
+	g_free (fixture->test_path);
+}
+
+static void
+queue_file (TestCommonContext           *fixture,
+            const gchar                 *name,
+            gboolean                     update,
+            TrackerFileNotifierPriority  priority)
+{
+	GFile *file;
+
+	file = g_file_get_child (fixture->test_file, name);
+	tracker_indexer_queue_file (fixture->indexer, file, update, priority);
+	g_object_unref (file);
+}
+
+static void
+expect_files (TestCommonContext *fixture,
+              const gchar       *names[],
+              guint              n_names)
+{
+	GFile *file;
+	guint i;
+
+	for (i = 0; i < n_names; i++) {
+		gchar *name;
+
+		file = tracker_indexer_pop_next_file (fixture->indexer);
+		g_assert_nonnull (file);
+
+		name = g_file_get_relative_path (fixture->test_file, file);
+		g_assert_cmpstr (name, ==, names[i]);
+
+		g_free (name);
+		g_object_unref (file);
+	}
+
+	file = tracker_indexer_pop_next_file (fixture->indexer);
+	g_assert_null (file);
+}
+
+static void
+test_indexer_crawl_order (TestCommonContext *fixture,
+                          gconstpointer      data)
+{
+	const gchar *expected[] = { "a", "b", "c", "d" };
+
+	queue_file (fixture, "a", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "b", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "c", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "d", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+
+	expect_files (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+static void
+test_indexer_crawled_update_promoted (TestCommonContext *fixture,
+                                      gconstpointer      data)
+{
+	const gchar *expected[] = { "c", "a", "b", "d" };
+
+	queue_file (fixture, "a", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "b", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "c", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "d", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+
+	/* Monitor update on a file still waiting to be crawled,
+	 * it is coalesced into the queued event.
+	 */
+	queue_file (fixture, "c", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_LIVE);
+
+	expect_files (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+static void
+test_indexer_crawled_create_promoted (TestCommonContext *fixture,
+                                      gconstpointer      data)
+{
+	const gchar *expected[] = { "c", "a", "b", "d" };
+
+	queue_file (fixture, "a", FALSE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "b", FALSE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "c", FALSE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+	queue_file (fixture, "d", FALSE, TRACKER_FILE_NOTIFIER_PRIORITY_CRAWL);
+
+	/* Monitor update on a file still waiting to be crawled,
+	 * it replaces the queued event.
+	 */
+	queue_file (fixture, "c", TRUE, TRACKER_FILE_NOTIFIER_PRIORITY_LIVE);
+
+	expect_files (fixture, expected, G_N_ELEMENTS (expected));
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+	setlocale (LC_ALL, "");
+
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_message ("Testing indexer");
+
+	test_add ("/libtracker-miner/indexer/crawl-order",
+	          test_indexer_crawl_order);
+	test_add ("/libtracker-miner/indexer/crawled-update-promoted",
+	          test_indexer_crawled_update_promoted);
+	test_add ("/libtracker-miner/indexer/crawled-create-promoted",
+	          test_indexer_crawled_create_promoted);
+
+	return g_test_run ();
+}
@@ -501,6 +501,138 @@ test_indexing_tree_030 (TestCommonContext *fixture,
 	ASSERT_INDEXABLE (fixture, TEST_DIRECTORY_ABA);
 }
 
+/* Roots are matched on whole path components, and the deepest
+ * root containing a file is returned.
+ */
+static void
+test_indexing_tree_get_root (TestCommonContext *fixture,
+                             gconstpointer      data)
+{
+	g_autoptr (GFile) sibling = NULL, root = NULL;
+	TrackerDirectoryFlags flags;
+	GFile *found;
+
+	root = g_file_new_for_path ("/");
+	sibling = g_file_new_for_path ("/A/AA");
+
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_A],
+	                           TRACKER_DIRECTORY_FLAG_RECURSE);
+	tracker_indexing_tree_add (fixture->tree,
+	                           fixture->test_dir[TEST_DIRECTORY_AA],
+	                           TRACKER_DIRECTORY_FLAG_NONE);
+
+	found = tracker_indexing_tree_get_root (fixture->tree,
+	                                        fixture->test_dir[TEST_DIRECTORY_AAA],
+	                                        NULL, &flags);
+	g_assert_true (g_file_equal (found, fixture->test_dir[TEST_DIRECTORY_AA]));
+	g_assert_cmpint (flags, ==, TRACKER_DIRECTORY_FLAG_NONE);
+
+	found = tracker_indexing_tree_get_root (fixture->tree, sibling, NULL, &flags);
+	g_assert_true (g_file_equal (found, fixture->test_dir[TEST_DIRECTORY_A]));
+	g_assert_cmpint (flags, ==, TRACKER_DIRECTORY_FLAG_RECURSE);
+
+	g_assert_null (tracker_indexing_tree_get_root (fixture->tree, root, NULL, NULL));
+	g_assert_true (tracker_indexing_tree_file_is_root (fixture->tree,
+	                                                   fixture->test_dir[TEST_DIRECTORY_AA]));
+	g_assert_false (tracker_indexing_tree_file_is_root (fixture->tree, sibling));
+
+	tracker_indexing_tree_add (fixture->tree, root, TRACKER_DIRECTORY_FLAG_NONE);
+	found = tracker_indexing_tree_get_root (fixture->tree, root, NULL, NULL);
+	g_assert_true (g_file_equal (found, root));
+
+	tracker_indexing_tree_remove (fixture->tree,
+	                              fixture->test_dir[TEST_DIRECTORY_AA]);
+	found = tracker_indexing_tree_get_root (fixture->tree,
+	                                        fixture->test_dir[TEST_DIRECTORY_AAA],
+	                                        NULL, NULL);
+	g_assert_true (g_file_equal (found, fixture->test_dir[TEST_DIRECTORY_A]));
+}
+
+static gboolean
+matches_filter (TrackerIndexingTree *tree,
+                TrackerFilterType    type,
+                const gchar         *path)
+{
+	g_autoptr (GFile) file = NULL;
+
+	file = g_file_new_for_path (path);
+
+	return tracker_indexing_tree_file_matches_filter (tree, type, file);
+}
+
+static void
+test_indexing_tree_filters (TestCommonContext *fixture,
+                            gconstpointer      data)
+{
+	TrackerIndexingTree *tree = fixture->tree;
+
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_FILE, "core");
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_FILE, "*.o");
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_FILE, "*~");
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_FILE, "tmp*");
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_FILE, "#*#");
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_FILE, "file?.txt");
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_DIRECTORY, "node_modules");
+
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/core"));
+	g_assert_false (matches_filter (tree, TRACKER_FILTER_FILE, "/A/core.c"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/main.o"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/.o"));
+	g_assert_false (matches_filter (tree, TRACKER_FILTER_FILE, "/A/main.oo"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/notes.txt~"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/tmp"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/tmpfile"));
+	g_assert_false (matches_filter (tree, TRACKER_FILTER_FILE, "/A/a-tmpfile"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/#notes#"));
+	g_assert_false (matches_filter (tree, TRACKER_FILTER_FILE, "/A/#notes"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/file1.txt"));
+	g_assert_false (matches_filter (tree, TRACKER_FILTER_FILE, "/A/file12.txt"));
+	g_assert_false (matches_filter (tree, TRACKER_FILTER_FILE, "/A/node_modules"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_DIRECTORY, "/A/node_modules"));
+	g_assert_false (matches_filter (tree, TRACKER_FILTER_DIRECTORY, "/A/main.o"));
+
+	tracker_indexing_tree_clear_filters (tree, TRACKER_FILTER_FILE);
+	g_assert_false (matches_filter (tree, TRACKER_FILTER_FILE, "/A/main.o"));
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_DIRECTORY, "/A/node_modules"));
+
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_FILE, "*");
+	g_assert_true (matches_filter (tree, TRACKER_FILTER_FILE, "/A/main.c"));
+}
+
+static void
+test_indexing_tree_parent_cache (TestCommonContext *fixture,
+                                 gconstpointer      data)
+{
+	TrackerIndexingTree *tree = fixture->tree;
+	g_autoptr (GFile) parent = NULL, child = NULL;
+
+	parent = g_file_new_for_path ("/nonexistent-indexing-tree-test/A");
+	child = g_file_get_child (parent, "B");
+
+	tracker_indexing_tree_set_parent_is_indexable (tree, child, FALSE);
+	/* Without content filters, everything is indexable */
+	g_assert_true (tracker_indexing_tree_parent_is_indexable (tree, child));
+
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_PARENT_DIRECTORY, ".nomedia");
+	g_assert_true (tracker_indexing_tree_basename_matches_filter (tree, TRACKER_FILTER_PARENT_DIRECTORY, ".nomedia"));
+	g_assert_false (tracker_indexing_tree_basename_matches_filter (tree, TRACKER_FILTER_PARENT_DIRECTORY, "nomedia"));
+	g_assert_true (tracker_indexing_tree_parent_is_indexable (tree, child));
+
+	tracker_indexing_tree_set_parent_is_indexable (tree, child, FALSE);
+	g_assert_false (tracker_indexing_tree_parent_is_indexable (tree, child));
+	g_assert_true (tracker_indexing_tree_parent_is_indexable (tree, parent));
+
+	/* Invalidation applies to the folders inside too */
+	tracker_indexing_tree_invalidate_parent (tree, parent);
+	g_assert_true (tracker_indexing_tree_parent_is_indexable (tree, child));
+
+	tracker_indexing_tree_set_parent_is_indexable (tree, child, FALSE);
+	tracker_indexing_tree_clear_filters (tree, TRACKER_FILTER_PARENT_DIRECTORY);
+	tracker_indexing_tree_add_filter (tree, TRACKER_FILTER_PARENT_DIRECTORY, ".trackerignore");
+	g_assert_true (tracker_indexing_tree_parent_is_indexable (tree, child));
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -523,6 +655,9 @@ main (gint    argc,
 	test_add ("/libtracker-miner/indexing-tree/028", test_indexing_tree_028);
 	test_add ("/libtracker-miner/indexing-tree/029", test_indexing_tree_029);
 	test_add ("/libtracker-miner/indexing-tree/030", test_indexing_tree_030);
+	test_add ("/libtracker-miner/indexing-tree/get-root", test_indexing_tree_get_root);
+	test_add ("/libtracker-miner/indexing-tree/filters", test_indexing_tree_filters);
+	test_add ("/libtracker-miner/indexing-tree/parent-cache", test_indexing_tree_parent_cache);
 
 	return g_test_run ();
 }
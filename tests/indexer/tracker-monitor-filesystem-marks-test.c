@@ -0,0 +1,3 @@
+/* Make the Fanotify TrackerMonitor implementation use filesystem marks */
+#define USE_FILESYSTEM_MARKS
+#include "tracker-monitor-test.c"
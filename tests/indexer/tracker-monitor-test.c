@@ -389,6 +389,11 @@ create_monitor (void)
 	TrackerMonitor *monitor;
 	GError *error = NULL;
 
+#ifdef USE_FILESYSTEM_MARKS
+	/* Falls back to per-directory marks if not permitted */
+	g_setenv ("TRACKER_MONITOR_FILESYSTEM_MARKS", "1", TRUE);
+#endif
+
 #ifndef USE_GLIB
 	monitor = tracker_monitor_new (&error);
 #else